@@ -1,45 +1,60 @@
 #include <stdint.h>
-#include "esp32c3/rom/ets_sys.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
 
-#define GPIO_BASE        0x60004000
-#define GPIO_OUT_W1TS    (GPIO_BASE + 0x08)
-#define GPIO_OUT_W1TC    (GPIO_BASE + 0x0C)
-#define GPIO_ENABLE_W1TS (GPIO_BASE + 0x20)
+#include "led_fade.h"
 
-#define LED_PIN 2       
-#define PWM_RES 256     // resolución 8 bits
-#define PWM_DELAY_US 50 // microsegundos por paso 
+static const char *TAG = "PWM_LED";
 
-// registros GPIO
-volatile uint32_t* gpio_out_w1ts = (volatile uint32_t*) GPIO_OUT_W1TS;
-volatile uint32_t* gpio_out_w1tc = (volatile uint32_t*) GPIO_OUT_W1TC;
-volatile uint32_t* gpio_enable_w1ts = (volatile uint32_t*) GPIO_ENABLE_W1TS;
+#define LED_PIN 2
+#define PWM_RES 256     // niveles de brillo (8 bits)
+#define PWM_FREQ_HZ 5000
+#define PWM_BITS LEDC_TIMER_13_BIT
+#define PWM_GAMMA 2.2f  // brillo percibido ~ duty^(1/2.2)
+#define RAMPA_MS 3277   // lo que duraba cada rampa software (256 x 256 x 50 us)
 
-void app_main(void) {
-    // Configurar LED como salida
-    *gpio_enable_w1ts = (1 << LED_PIN);
+// nivel de brillo -> duty del LEDC, calculada una vez al arrancar
+static uint16_t gamma_led[PWM_RES];
+static led_out_t led;
+static TaskHandle_t rampa_task_handle;
+
+// Fin de cada fundido (tarea del motor de fundidos): despierta a la rampa
+static void fundido_hecho(led_out_t *o, uint16_t level, void *arg)
+{
+    xTaskNotifyGive(rampa_task_handle);
+}
 
+static void rampa_task(void *arg)
+{
     while (1) {
         //sube brillo
-        for (int duty = 0; duty < PWM_RES; duty++) {
-            for (int i = 0; i < PWM_RES; i++) {
-                if (i < duty)
-                    *gpio_out_w1ts = (1 << LED_PIN); // LED encendido
-                else
-                    *gpio_out_w1tc = (1 << LED_PIN); // LED apagado
-                ets_delay_us(PWM_DELAY_US);
-            }
-        }
+        led_out_fade(&led, PWM_RES - 1, RAMPA_MS);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
 
         // baja brillo
-        for (int duty = PWM_RES - 1; duty >= 0; duty--) {
-            for (int i = 0; i < PWM_RES; i++) {
-                if (i < duty)
-                    *gpio_out_w1ts = (1 << LED_PIN);
-                else
-                    *gpio_out_w1tc = (1 << LED_PIN);
-                ets_delay_us(PWM_DELAY_US);
-            }
-        }
+        led_out_fade(&led, 0, RAMPA_MS);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
     }
 }
+
+void app_main(void) {
+    led_gamma_build(gamma_led, PWM_RES, LED_FADE_DUTY_MAX(PWM_BITS), PWM_GAMMA);
+
+    ESP_ERROR_CHECK(led_fade_start(5));
+    ESP_ERROR_CHECK(led_fade_timer_init(LEDC_TIMER_0, PWM_FREQ_HZ, PWM_BITS));
+
+    led_out_config_t cfg = {
+        .gpio = LED_PIN,
+        .ch = LEDC_CHANNEL_0,
+        .timer = LEDC_TIMER_0,
+        .curve = gamma_led,
+        .nlevels = PWM_RES,
+        .segments = LED_FADE_SEGMENTS,
+        .done = fundido_hecho,
+    };
+    ESP_ERROR_CHECK(led_out_init(&led, &cfg));
+
+    xTaskCreate(rampa_task, "rampa", 2048, NULL, 4, &rampa_task_handle);
+    ESP_LOGI(TAG, "Rampa de brillo por hardware: %d ms por sentido, gamma %.1f", RAMPA_MS, PWM_GAMMA);
+}
@@ -1,27 +1,19 @@
-
 #include <stdint.h>
-#include <string.h>
-#include "esp32c3/rom/ets_sys.h"
-// direcciones base de los GPIOs
-#define GPIO_BASE        0x60004000
-#define GPIO_OUT_W1TS    (GPIO_BASE + 0x08)
-#define GPIO_OUT_W1TC    (GPIO_BASE + 0x0C)
-#define GPIO_ENABLE_W1TS (GPIO_BASE + 0x20)
+#include "esp_log.h"
+
+#include "tone_seq.h"
 
-#define ZUMBADOR 2 
+static const char *TAG = "MELODIA";
 
-// registros GPIO
-volatile uint32_t* gpio_out_w1ts = (volatile uint32_t*) GPIO_OUT_W1TS;
-volatile uint32_t* gpio_out_w1tc = (volatile uint32_t*) GPIO_OUT_W1TC;
-volatile uint32_t* gpio_enable_w1ts = (volatile uint32_t*) GPIO_ENABLE_W1TS;
+#define ZUMBADOR 2
+#define ZUMBADOR_CANAL  LEDC_CHANNEL_0
+#define ZUMBADOR_TIMER  LEDC_TIMER_0
 
-// ESTRUCTURA: nombre y frecuencia fundamental de las notas
-typedef struct {
-    const char *nombre;
-    int freq;   // frecuencia en Hz
-} Nota;
+#define PAUSA_NOTA_MS    50     // pausa entre notas
+#define PAUSA_CANCION_MS 200    // pausa entre repetición de la canción
 
-Nota notas[] = {
+// Escala: nombre y frecuencia fundamental de las notas
+static const tone_note_t notas[] = {
     {"DO", 261},
     {"RE", 294},
     {"MI", 329},
@@ -32,68 +24,32 @@ Nota notas[] = {
     {"DO5", 523}
 };
 
-// Estructura: nombre y duración de la nota 
-typedef struct {
-    const char *nombre;
-    int duracion_ms;
-} NotaPartitura;
-
-NotaPartitura partitura[] = {
+// Partitura: nombre y duración de la nota
+static const tone_score_note_t partitura[] = {
     {"DO", 400}, {"DO", 400}, {"SOL", 400}, {"SOL", 400},
     {"LA", 400}, {"LA", 400}, {"SOL", 800},
     {"FA", 400}, {"FA", 400}, {"MI", 400}, {"MI", 400},
     {"RE", 400}, {"MI", 400}, {"DO", 800}
 };
 
-int longPartitura = sizeof(partitura)/sizeof(NotaPartitura);
-int numNotas = sizeof(notas)/sizeof(Nota);
-
-// Busca índice de nota
-int Indice(const char *nombre) {
-    for (int i = 0; i < numNotas; i++) {
-        if (strcmp(nombre, notas[i].nombre) == 0) return i;
-    }
-    return -1;
-}
-
-// Retardo en milisegundos para las pausas
-void delay_ms(int t) {
-    ets_delay_us(t * 1000);
-}
-
-// Genera las notas en función de la frecuencia
-void play_nota(const char *nota, int duracion_ms) {
-    int freq = notas[Indice(nota)].freq;
-    if (freq <= 0) return;
-
-    int periodo_us = 1000000 / freq;  // periodo de la onda
-    int mitad_periodo = periodo_us / 2; // 50% duty cycle
-    int repeticiones = (duracion_ms * 1000) / periodo_us;
-
-    for (int i = 0; i < repeticiones; i++) {
-        // Encender pin
-        *gpio_out_w1ts = (1 << ZUMBADOR);
-        ets_delay_us(mitad_periodo);
-
-        // Apagar pin
-        *gpio_out_w1tc = (1 << ZUMBADOR);
-        ets_delay_us(mitad_periodo);
-    }
+#define NUM_NOTAS       (sizeof(notas) / sizeof(notas[0]))
+#define LONG_PARTITURA  (sizeof(partitura) / sizeof(partitura[0]))
 
-    // pausa entre notas
-    delay_ms(50);
-}
+// Partitura compilada (frecuencia, duración, pausa): se toca desde el LEDC
+static tone_step_t pasos[LONG_PARTITURA];
+static tone_voice_t voz;
 
 void app_main(void) {
-    // Configurar pin como salida
-    *gpio_enable_w1ts = (1 << BUZZER_PIN);
+    int n = tone_compile(notas, NUM_NOTAS, partitura, LONG_PARTITURA, PAUSA_NOTA_MS, pasos);
+    if (n < 0) {
+        ESP_LOGE(TAG, "Nota %d desconocida: '%s'", -n - 1, partitura[-n - 1].name);
+        return;
+    }
+    pasos[n - 1].gap_ms += PAUSA_CANCION_MS;
 
-    while (1) {
-        for (int i = 0; i < longPartitura; i++) {
-            play_nota(partitura[i].nombre, partitura[i].duracion_ms);
-        }
+    ESP_ERROR_CHECK(tone_voice_init(&voz, ZUMBADOR, ZUMBADOR_CANAL, ZUMBADOR_TIMER));
+    ESP_ERROR_CHECK(tone_voice_play(&voz, pasos, n, true, 0));
 
-        // pausa entre repetición de la canción
-        delay_ms(200);
-    }
+    // La melodía la avanza un esp_timer: app_main termina y la CPU queda libre
+    ESP_LOGI(TAG, "Tocando %d notas en bucle (%lu ms por vuelta)", n, (unsigned long)tone_length_ms(pasos, n));
 }
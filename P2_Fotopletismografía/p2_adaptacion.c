@@ -1,89 +1,111 @@
 #include <stdio.h>
 #include <stdint.h>
+#include <inttypes.h>
 
-#include "esp32c3/rom/ets_sys.h"
-#include "esp_adc/adc_oneshot.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 
-// dirección base GPIOs
-#define GPIO_BASE       0x60004000
-#define GPIO_OUT_W1TS   (GPIO_BASE + 0x08)
-#define GPIO_OUT_W1TC   (GPIO_BASE + 0x0C)
-#define GPIO_ENABLE_W1TS (GPIO_BASE + 0x20)
+#include "telemetry.h"
+#include "led_fade.h"
+#include "adc_stream.h"
 
 #define GPIO_PWM 2
 
-// ADC
-#define ADC_CH ADC_CHANNEL_0
-adc_oneshot_unit_handle_t adc;
+// PWM del LED por LEDC: 5 kHz, cinco periodos por muestra del ADC (1 ms),
+// así el fotodiodo ve la luz media y no el rizado de un PWM lento; duty
+// lineal en pasos del 5 % (el PPG necesita el duty real, sin gamma)
+#define PWM_FREQ_HZ     5000
+#define PWM_BITS        LEDC_TIMER_13_BIT
+#define PWM_NIVELES     21              // 0 %, 5 %, ..., 100 %
+#define PWM_PASO_PERMIL 50
+#define NIVEL_MS        500             // tiempo en cada nivel
 
-//inicializar GPIO
-void gpio_init(int pin)
-{
-    volatile uint32_t* enable = (uint32_t*) GPIO_ENABLE_W1TS;
-    *enable = (1 << pin);
-}
-
-// Función para inicializar el ADC
-void adc_init(void)
-{
-    adc_oneshot_unit_init_cfg_t init = {
-        .unit_id = ADC_UNIT_1
-    };
-    adc_oneshot_new_unit(&init, &adc);
+// ADC continuo por DMA: 1 kHz promediado de 4 en 4 -> 250 Hz, en bloques de 100 ms
+#define ADC_CH          ADC_CHANNEL_0
+#define ADC_FREQ_HZ     1000
+#define ADC_DECIM       4
+#define ADC_BLOQUE      25
+#define BLOQUES_NIVEL   (NIVEL_MS * (ADC_FREQ_HZ / ADC_DECIM) / 1000 / ADC_BLOQUE)     // 5
 
-    adc_oneshot_chan_cfg_t cfg = {
-        .atten = ADC_ATTEN_DB_11,
-        .bitwidth = ADC_BITWIDTH_12
-    };
-    adc_oneshot_config_channel(adc, ADC_CH, &cfg);
-}
-
-// Función para generar el PWM 
-void pwm(int pin, float duty, int periodo_us)
-{
-    int ton  = periodo_us * duty;
-    int toff = periodo_us - ton;
+// Salida: 1 = bloques binarios TELEM_ADC_BLOCK (tools/telem_csv.c), 0 = printf
+#define TELEM_BINARY 1
 
-    volatile uint32_t* set = (uint32_t*) GPIO_OUT_W1TS;
-    volatile uint32_t* clr = (uint32_t*) GPIO_OUT_W1TC;
-
-    *set = (1 << pin);
-    ets_delay_us(ton);
-
-    *clr = (1 << pin);
-    ets_delay_us(toff);
-}
+static adc_stream_t ppg;
 
+// nivel -> duty del LEDC
+static uint16_t duty_lineal[PWM_NIVELES];
+static led_out_t led;
 
 void app_main(void)
 {
     //se inicializa el PWM y ADC
-    gpio_init(GPIO_PWM);
-    adc_init();
+    led_gamma_build(duty_lineal, PWM_NIVELES, LED_FADE_DUTY_MAX(PWM_BITS), 1.0f);
+    ESP_ERROR_CHECK(led_fade_start(5));
+    ESP_ERROR_CHECK(led_fade_timer_init(LEDC_TIMER_0, PWM_FREQ_HZ, PWM_BITS));
+    led_out_config_t cfg = {
+        .gpio = GPIO_PWM,
+        .ch = LEDC_CHANNEL_0,
+        .timer = LEDC_TIMER_0,
+        .curve = duty_lineal,
+        .nlevels = PWM_NIVELES,
+        .segments = 1,
+    };
+    ESP_ERROR_CHECK(led_out_init(&led, &cfg));
+#if TELEM_BINARY
+    telem_start(4096, 2);
+#endif
+    adc_stream_config_t adc_cfg = {
+        .channel = ADC_CH,
+        .atten = ADC_ATTEN_DB_11,
+        .sample_hz = ADC_FREQ_HZ,
+        .decim = ADC_DECIM,
+        .block = ADC_BLOQUE,
+    };
+    ESP_ERROR_CHECK(adc_stream_start(&ppg, &adc_cfg, 6));
+
+    // Las marcas de tiempo salen del índice de muestra (frecuencia fija)
+    uint32_t t_base_us = telem_now_us();
+    uint32_t periodo_us = 1000000 / adc_stream_rate_hz(&ppg);
 
-    float duty = 0.0; // duty cycle inicial
+    int nivel = 0; // duty cycle inicial
     int dir = 1;
-    int adc_val;
+    uint16_t mv[ADC_BLOQUE];
+    uint32_t primera;
 
     while (1) {
-
-        // 
-        for (int i = 0; i < 50; i++) {
-            pwm(GPIO_PWM, duty, 1e4); 
+        // El LEDC mantiene el duty mientras llegan BLOQUES_NIVEL bloques del ADC
+        led_out_set(&led, nivel);
+
+        for (int b = 0; b < BLOQUES_NIVEL; b++) {
+            size_t n = adc_stream_read(&ppg, mv, ADC_BLOQUE, &primera, portMAX_DELAY);
+            if (n == 0) continue;
+#if TELEM_BINARY
+            // Se envía el bloque como un registro binario (sin formatear floats)
+            telem_rec_t rec;
+            telem_begin(&rec, TELEM_ADC_BLOCK);
+            telem_put_u32(&rec, t_base_us + (primera + (uint32_t)n - 1) * periodo_us);
+            telem_put_u16(&rec, (uint16_t)periodo_us);
+            telem_put_u8(&rec, ADC_CH);
+            telem_put_u16(&rec, (uint16_t)(nivel * PWM_PASO_PERMIL));
+            telem_put_u8(&rec, (uint8_t)n);
+            for (size_t i = 0; i < n; i++) telem_put_u16(&rec, mv[i]);
+            telem_send(&rec);
+#else
+            // Se muestra por pantalla la media del bloque
+            uint32_t suma = 0;
+            for (size_t i = 0; i < n; i++) suma += mv[i];
+            printf("Duty: %d.%02d  ADC: %" PRIu32 " mV (%u muestras)\n", nivel * 5 / 100, nivel * 5 % 100,
+                   suma / (uint32_t)n, (unsigned)n);
+#endif
         }
 
-        // Lee el ADC
-        adc_oneshot_read(adc, ADC_CH, &adc_val);
-        // Se muestra por pantalla
-        printf("Duty: %.2f  ADC: %d\n", duty, adc_val);
-
-        // variación del duty cylce para generar un bucle 
-        duty += dir * 0.05;
-        if (duty >= 1.0) { 
-            duty = 1.0; dir = -1;
+        // variación del duty cylce para generar un bucle
+        nivel += dir;
+        if (nivel >= PWM_NIVELES - 1) {
+            nivel = PWM_NIVELES - 1; dir = -1;
         }
-        if (duty <= 0.0) { 
-            duty = 0.0; dir = 1; 
+        if (nivel <= 0) {
+            nivel = 0; dir = 1;
         }
     }
 }
@@ -2,11 +2,19 @@
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
+#include <inttypes.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "driver/uart.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+
+#include "nmea.h"
+#include "ubx.h"
+#include "gps_uart.h"
+#include "telemetry.h"
+#include "stepper.h"
 
 static const char *TAG = "GPS_STEPPER";
 
@@ -15,119 +23,50 @@ static const char *TAG = "GPS_STEPPER";
 #define GPS_TX_PIN          21  // ESP32 TX (GPS RX)
 #define GPS_RX_PIN          20  // ESP32 RX (GPS TX)
 #define GPS_BUF_SIZE        1024
+#define GPS_LINE_SIZE       128 // trama NMEA máx. 82 caracteres
+#define GPS_STATS_PERIOD_MS 10000
+
+// Modo UBX: NAV-PVT binario a alta velocidad (0 = NMEA a 9600 baudios)
+#define GPS_UBX_MODE        0
+#define GPS_UBX_BAUD        115200
+#define GPS_UBX_RATE_HZ     10
 
-// STEPPER MOTOR (ULN2003 / 28BYJ-48)
+// 1 = cada fix se envía también como registro binario TELEM_GPS (tools/telem_csv.c)
+#define TELEM_BINARY        1
+
+// STEPPER MOTOR (ULN2003 / 28BYJ-48), movido por la alarma de un gptimer (stepper.h)
 // Pines de control
 #define STEP_PIN_1          6
 #define STEP_PIN_2          7
 #define STEP_PIN_3          8
 #define STEP_PIN_4          9
-#define GPIO_STEPPER_MASK   ((1ULL<<STEP_PIN_1) | (1ULL<<STEP_PIN_2) | (1ULL<<STEP_PIN_3) | (1ULL<<STEP_PIN_4))
 
 // Características del motor
 // El 28BYJ-48 tiene aprox 2038 pasos por vuelta en modo half-step (8 pasos)
-#define STEPS_PER_REV       2038 
-
-// Variable global para comunicar el rumbo (protegida por simplicidad, idealmente usaríamos colas/mutex)
-volatile float g_target_heading = 0.0f;
-volatile int   g_current_stepper_pos = 0; // Posición actual en pasos (0 a STEPS_PER_REV)
-
-
-// Secuencia de 8 pasos (Half-step) para mayor suavidad
-const int step_sequence[8][4] = {
-    {1, 0, 0, 1}, 
-    {1, 0, 0, 0}, 
-    {1, 1, 0, 0}, 
-    {0, 1, 0, 0}, 
-    {0, 1, 1, 0}, 
-    {0, 0, 1, 0}, 
-    {0, 0, 1, 1}, 
-    {0, 0, 0, 1}  
-};
-
-void stepper_init() {
-    gpio_config_t io_conf = {
-        .pin_bit_mask = GPIO_STEPPER_MASK,
-        .mode = GPIO_MODE_OUTPUT,
-        .pull_up_en = 0,
-        .pull_down_en = 0,
-        .intr_type = GPIO_INTR_DISABLE
-    };
-    gpio_config(&io_conf);
-    ESP_LOGI(TAG, "Stepper inicializado en pines %d, %d, %d, %d", STEP_PIN_1, STEP_PIN_2, STEP_PIN_3, STEP_PIN_4);
-}
-
-// Mueve el motor un solo paso en la dirección indicada
-void stepper_step_once(int direction) {
-    static int step_index = 0;
-    
-    if (direction > 0) {
-        step_index++;
-        if (step_index > 7) step_index = 0;
-    } else {
-        step_index--;
-        if (step_index < 0) step_index = 7;
-    }
-
-    gpio_set_level(STEP_PIN_1, step_sequence[step_index][0]);
-    gpio_set_level(STEP_PIN_2, step_sequence[step_index][1]);
-    gpio_set_level(STEP_PIN_3, step_sequence[step_index][2]);
-    gpio_set_level(STEP_PIN_4, step_sequence[step_index][3]);
-
-    esp_rom_delay_us(1000); // 1ms entre pasos
-}
-
-
-void stepper_task(void *arg) {
-    while (1) {
-        // 1. Convertir el rumbo objetivo (grados) a pasos (0..2038)
-        int target_step = (int)((g_target_heading / 360.0f) * STEPS_PER_REV);
-
-        if (target_step >= STEPS_PER_REV) target_step = STEPS_PER_REV - 1;
-        
-        int diff = target_step - g_current_stepper_pos;
-
-        if (abs(diff) > 5) {
-            if (diff > 0) {
-                stepper_step_once(1);
-                g_current_stepper_pos++;
-            } else {
-                stepper_step_once(-1);
-                g_current_stepper_pos--;
-            }
-        } else {
-            vTaskDelay(pdMS_TO_TICKS(50));
-        }
-        
-        if (abs(diff) < 5) vTaskDelay(pdMS_TO_TICKS(10));
-    }
+#define STEPS_PER_REV       2038
+#define STEP_V_START        300     // pasos/s al arrancar y antes de invertir
+#define STEP_V_MAX          1000    // pasos/s (el antiguo 1 paso/ms)
+#define STEP_ACCEL          2000    // pasos/s²
+#define STEP_DEADBAND       5       // pasos (~0.9°) de ruido del rumbo ignorados en reposo
+
+static stepper_t g_stepper;
+
+
+#if TELEM_BINARY
+static void telem_send_fix(int32_t lat_e7, int32_t lon_e7, uint32_t speed_mms, uint16_t course_cdeg, uint8_t fix) {
+    telem_rec_t rec;
+    telem_begin(&rec, TELEM_GPS);
+    telem_put_u32(&rec, telem_now_us());
+    telem_put_u32(&rec, (uint32_t)lat_e7);
+    telem_put_u32(&rec, (uint32_t)lon_e7);
+    telem_put_u32(&rec, speed_mms);
+    telem_put_u16(&rec, course_cdeg);
+    telem_put_u8(&rec, fix);
+    telem_send(&rec);
 }
-
+#endif
 
 // LÓGICA DEL GPS
-char* get_nmea_field(char *line, int index) {
-    static char buffer[32];
-    char *p = line;
-    int current_idx = 0;
-    while(current_idx < index && p) {
-        p = strchr(p, ',');
-        if(p) {
-            p++;
-            current_idx++;
-        }
-    }
-
-    if (!p) return NULL;
-
-    int i = 0;
-    while(p[i] != ',' && p[i] != '*' && p[i] != '\0' && p[i] != '\r' && i < 31) {
-        buffer[i] = p[i];
-        i++;
-    }
-    buffer[i] = '\0';
-    return buffer;
-}
-
 void gps_task(void *arg) {
     uart_config_t uart_config = {
         .baud_rate = 9600,
@@ -137,54 +76,71 @@ void gps_task(void *arg) {
         .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
         .source_clk = UART_SCLK_APB,
     };
-    uart_driver_install(GPS_UART_NUM, GPS_BUF_SIZE * 2, 0, 0, NULL, 0);
-    uart_param_config(GPS_UART_NUM, &uart_config);
-    uart_set_pin(GPS_UART_NUM, GPS_TX_PIN, GPS_RX_PIN, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
-
-    uint8_t *data = (uint8_t *) malloc(GPS_BUF_SIZE);
-    char line_buffer[256];
-    int line_idx = 0;
+    gps_uart_t gps;
+    ESP_ERROR_CHECK(gps_uart_install(&gps, GPS_UART_NUM, &uart_config, GPS_TX_PIN, GPS_RX_PIN, GPS_BUF_SIZE * 2, GPS_UBX_MODE));
+
+    uint8_t data[GPS_LINE_SIZE];
+    int64_t t_stats = esp_timer_get_time();
+#if GPS_UBX_MODE
+    ubx_parser_t parser;
+    ubx_nav_pvt_t pvt;
+    ubx_init(&parser);
+    ubx_neo7_configure(GPS_UART_NUM, GPS_UBX_BAUD, GPS_UBX_RATE_HZ);
+    ESP_LOGI(TAG, "GPS en modo UBX: NAV-PVT a %d baudios, %d Hz", GPS_UBX_BAUD, GPS_UBX_RATE_HZ);
+#else
+    nmea_parser_t parser;
+    nmea_msg_t msg;
+    nmea_init(&parser);
+#endif
 
     ESP_LOGI(TAG, "Esperando datos GPS...");
 
     while (1) {
-        // Leer bytes de la UART
-        int len = uart_read_bytes(GPS_UART_NUM, data, GPS_BUF_SIZE, 100 / portTICK_PERIOD_MS);
-        
-        if (len > 0) {
-            for (int i = 0; i < len; i++) {
-                char c = (char)data[i];
-                
-                // Acumular linea hasta encontrar salto de línea
-                if (c == '\n') {
-                    line_buffer[line_idx] = 0;
-                    
-                    // Buscar trama $GNRMC o $GPRMC
-                    if (strstr(line_buffer, "RMC")) {
-                        // Campos RMC: 
-                        // 0:ID, 1:Time, 2:Status(A/V), 3:Lat, 4:N/S, 5:Lon, 6:E/W, 7:Speed, 8:Course
-                        
-                        char *status = get_nmea_field(line_buffer, 2);
-                        char *course = get_nmea_field(line_buffer, 8);
-
-                        if (status && status[0] == 'A') {
-                            if (course && strlen(course) > 0) {
-                                float heading = atof(course);
-                                ESP_LOGI(TAG, "Rumbo: %.2f deg", heading);
-                                g_target_heading = heading;
-                            }
-                        } else {
-                             // ESP_LOGW(TAG, "Esperando FIX...");
-                        }
-                    }
-
-                    line_idx = 0;
-                } else if (c != '\r') {
-                    if (line_idx < 255) {
-                        line_buffer[line_idx++] = c;
+        // Trama completa (o bloque UBX) en cuanto la UART la detecta
+        int len = gps_uart_read(&gps, data, sizeof(data), pdMS_TO_TICKS(GPS_STATS_PERIOD_MS));
+
+        for (int i = 0; i < len; i++) {
+#if GPS_UBX_MODE
+            if (!ubx_feed(&parser, data[i]) || !ubx_decode_nav_pvt(&parser, &pvt)) continue;
+#if TELEM_BINARY
+            telem_send_fix(pvt.lat_e7, pvt.lon_e7, pvt.gspeed_mms > 0 ? (uint32_t)pvt.gspeed_mms : 0,
+                           (uint16_t)(pvt.head_e5 / 1000), pvt.fix_ok ? pvt.fix_type : 0);
+#endif
+
+            if (pvt.fix_ok && pvt.fix_type >= 2) {
+                uint32_t cdeg = (uint32_t)(pvt.head_e5 / 1000);
+                ESP_LOGI(TAG, "Rumbo: %" PRIu32 ".%02" PRIu32 " deg", cdeg / 100, cdeg % 100);
+                stepper_post_heading(&g_stepper, cdeg);
+            }
+#else
+            if (!nmea_feed(&parser, data[i], &msg)) continue;
+
+            // Trama $GNRMC o $GPRMC con checksum correcto
+            if (msg.type == NMEA_RMC) {
+#if TELEM_BINARY
+                telem_send_fix(msg.rmc.lat_e7, msg.rmc.lon_e7, msg.rmc.speed_mms, msg.rmc.course_cdeg,
+                               msg.rmc.valid ? 1 : 0);
+#endif
+                if (msg.rmc.valid) {
+                    if (msg.rmc.has_course) {
+                        ESP_LOGI(TAG, "Rumbo: %u.%02u deg", msg.rmc.course_cdeg / 100, msg.rmc.course_cdeg % 100);
+                        stepper_post_heading(&g_stepper, msg.rmc.course_cdeg);
                     }
+                } else {
+                     // ESP_LOGW(TAG, "Esperando FIX...");
                 }
             }
+#endif
+        }
+
+        if (esp_timer_get_time() - t_stats >= GPS_STATS_PERIOD_MS * 1000LL) {
+            t_stats = esp_timer_get_time();
+            ESP_LOGI(TAG, "UART GPS: %" PRIu32 " tramas, lat media %" PRIu32 " us (max %" PRIu32 "), ovf fifo=%" PRIu32
+                     " buf=%" PRIu32 " patron=%" PRIu32 " linea=%" PRIu32,
+                     gps.stats.sentences, gps_uart_lat_avg_us(&gps.stats), gps.stats.lat_max_us,
+                     gps.stats.fifo_ovf, gps.stats.buffer_full, gps.stats.pattern_ovf, gps.stats.line_ovf);
+            ESP_LOGI(TAG, "Stepper: rumbo %" PRIu32 " c°, %" PRIu32 " pasos, %" PRIu32 " inversiones",
+                     stepper_heading_cdeg(&g_stepper), g_stepper.m.steps, g_stepper.m.reversals);
         }
     }
 }
@@ -193,8 +149,18 @@ void gps_task(void *arg) {
 void app_main(void) {
     ESP_LOGI(TAG, "Iniciando Practica 3 Adaptada (GPS + Stepper)");
 
-    stepper_init();
+    stepper_config_t step_cfg = {
+        .pins = { STEP_PIN_1, STEP_PIN_2, STEP_PIN_3, STEP_PIN_4 },
+        .steps_per_rev = STEPS_PER_REV,
+        .v_start = STEP_V_START,
+        .v_max = STEP_V_MAX,
+        .accel = STEP_ACCEL,
+        .deadband = STEP_DEADBAND,
+    };
+    ESP_ERROR_CHECK(stepper_start(&g_stepper, &step_cfg, 5));
+#if TELEM_BINARY
+    telem_start(4096, 2);
+#endif
 
-    xTaskCreate(stepper_task, "stepper_task", 2048, NULL, 5, NULL);
     xTaskCreate(gps_task, "gps_task", 4096, NULL, 5, NULL);
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -8,9 +10,17 @@
 #include "esp_err.h"
 #include "esp_log.h"
 #include "esp_timer.h"
+#include "esp_cpu.h"
+#include "nvs_flash.h"
 
-#include "driver/i2c.h"
 #include "driver/ledc.h" 
+#include "driver/gpio.h"
+
+#include "i2c_bus.h"
+#include "ahrs.h"
+#include "imu_cal.h"
+#include "telemetry.h"
+#include "lsm6_fifo.h"
 
 static const char *TAG = "P3_FINAL";
 
@@ -38,84 +48,226 @@ static const char *TAG = "P3_FINAL";
 #define REG_CTRL2_G         0x11
 #define REG_CTRL3_C         0x12
 #define REG_OUT_TEMP_L      0x20
+#define REG_INT1_CTRL       0x0D
+#define REG_FIFO_CTRL1      0x06
+#define REG_FIFO_CTRL2      0x07
+#define REG_FIFO_CTRL3      0x08
+#define REG_FIFO_CTRL5      0x0A
+#define REG_FIFO_STATUS1    0x3A
+#define REG_FIFO_DATA_OUT_L 0x3E
+
+// FIFO: ODR común para acelerómetro, giroscopio y FIFO (104/208/416/833/1660 Hz)
+// y decimación del FIFO (1, 2, 3, 4, 8, 16 o 32)
+#define IMU_ODR_HZ          416
+#define IMU_FIFO_DEC        1
+#define IMU_SAMPLE_HZ       (IMU_ODR_HZ / IMU_FIFO_DEC)
+#define IMU_POLL_MS         100                                 // periodo de vaciado del FIFO
+#define IMU_FIFO_WTM        (IMU_SAMPLE_HZ * IMU_POLL_MS / 1000) // watermark en muestras
+#define IMU_BATCH_MAX       (2 * IMU_FIFO_WTM)
+#define IMU_BURST_SAMPLES   32                                  // muestras por lectura I2C
+#define FIFO_MODE_BYPASS    0x00
+#define FIFO_MODE_CONTINUOUS 0x06
+#define INT1_FTH            0x08    // INT1_CTRL: umbral (watermark) del FIFO
+
+// Línea INT1 del LSM6DS33 -> GPIO con interrupción por flanco de subida
+#define IMU_INT1_GPIO       GPIO_NUM_3
+#define IMU_JITTER_PERIOD_S 5
+
+// Salida: 1 = telemetría binaria a tasa completa (tools/telem_csv.c),
+// 0 = una línea de texto por lote
+#define TELEM_BINARY        1
+#define TELEM_BUF_SIZE      8192
 
 // Configuración de Filtros
 #define GYRO_DEADZONE       1.0f 
+
+// Motor de fusión: complementario en float (referencia) o Mahony en punto fijo
+#define AHRS_COMPLEMENTARY  0
+#define AHRS_MAHONY_Q30     1
+#define AHRS_ENGINE         AHRS_MAHONY_Q30
+#define MAHONY_KP           0.5f    // 1/s (constante de tiempo ~2 s)
+#define MAHONY_KI           0.0f    // 1/s^2 (0 = sin estimación de sesgo)
 const float accel_g_per_lsb = 0.061f / 1000.0f;
 const float gyro_dps_per_lsb = 8.75f / 1000.0f;
+#define ACC_LSB_PER_G       16393   // ±2 g
+#define GYRO_LSB_PER_DPS    114     // 245 dps
+#define IMU_CAL_SAVE_MIN_S  60      // intervalo mínimo entre escrituras en NVS
 
 float offset_ax = 0, offset_ay = 0, offset_az = 0;
 float offset_gx = 0, offset_gy = 0, offset_gz = 0;
 
-// Funciones I2C
-static esp_err_t i2c_write_u8(uint8_t addr, uint8_t reg, uint8_t val) {
-    uint8_t buf[2] = { reg, val };
-    return i2c_master_write_to_device(I2C_PORT, addr, buf, sizeof(buf), pdMS_TO_TICKS(I2C_TIMEOUT_MS));
+// Interrupción INT1: marca de tiempo y aviso directo a la tarea de adquisición
+static TaskHandle_t imu_task_handle = NULL;
+static volatile int64_t imu_isr_time_us = 0;
+static volatile uint32_t imu_isr_count = 0;
+
+static void IRAM_ATTR imu_int1_isr(void *arg) {
+    BaseType_t woken = pdFALSE;
+    imu_isr_time_us = esp_timer_get_time();
+    imu_isr_count++;
+    vTaskNotifyGiveFromISR(imu_task_handle, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+static void imu_int1_init(void) {
+    gpio_config_t io_conf = {
+        .pin_bit_mask = 1ULL << IMU_INT1_GPIO,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = 0,
+        .pull_down_en = 1,
+        .intr_type = GPIO_INTR_POSEDGE
+    };
+    ESP_ERROR_CHECK(gpio_config(&io_conf));
+    ESP_ERROR_CHECK(gpio_install_isr_service(0));
+    ESP_ERROR_CHECK(gpio_isr_handler_add(IMU_INT1_GPIO, imu_int1_isr, NULL));
 }
 
-static esp_err_t i2c_read(uint8_t addr, uint8_t reg, uint8_t *data, size_t len) {
-    return i2c_master_write_read_device(I2C_PORT, addr, &reg, 1, data, len, pdMS_TO_TICKS(I2C_TIMEOUT_MS));
+// Estadísticas del intervalo entre interrupciones (jitter de muestreo)
+typedef struct {
+    uint32_t n;
+    int64_t  sum_us;
+    int64_t  sum_sq_us;     // suma de cuadrados de la desviación respecto al nominal
+    int32_t  min_us;
+    int32_t  max_us;
+    uint32_t timeouts;      // esperas sin interrupción (se vacía el FIFO igualmente)
+    uint64_t fusion_cycles; // ciclos de CPU del filtro de fusión
+    uint32_t fusion_updates;
+} imu_jitter_t;
+
+static void jitter_reset(imu_jitter_t *j) {
+    *j = (imu_jitter_t){ .min_us = INT32_MAX, .max_us = 0 };
 }
 
-static uint8_t detect_lsm6_addr(void) {
-    uint8_t who = 0x00;
-    if (i2c_read(LSM6_ADDR_6B, REG_WHO_AM_I, &who, 1) == ESP_OK && who == WHO_AM_I_EXPECTED) return LSM6_ADDR_6B;
-    if (i2c_read(LSM6_ADDR_6A, REG_WHO_AM_I, &who, 1) == ESP_OK && who == WHO_AM_I_EXPECTED) return LSM6_ADDR_6A;
-    return 0;
+static void jitter_add(imu_jitter_t *j, int32_t interval_us, int32_t nominal_us) {
+    int32_t dev = interval_us - nominal_us;
+    j->n++;
+    j->sum_us += interval_us;
+    j->sum_sq_us += (int64_t)dev * dev;
+    if (interval_us < j->min_us) j->min_us = interval_us;
+    if (interval_us > j->max_us) j->max_us = interval_us;
 }
 
-static esp_err_t lsm6_init(uint8_t addr) {
-    ESP_ERROR_CHECK(i2c_write_u8(addr, REG_CTRL3_C, 0x44));   
-    ESP_ERROR_CHECK(i2c_write_u8(addr, REG_CTRL1_XL, 0x40));  
-    ESP_ERROR_CHECK(i2c_write_u8(addr, REG_CTRL2_G, 0x40));   
-    return ESP_OK;
+static void jitter_print(const imu_jitter_t *j, int32_t nominal_us) {
+    if (j->n == 0) {
+        ESP_LOGW(TAG, "INT1: sin interrupciones (%lu timeouts)", (unsigned long)j->timeouts);
+        return;
+    }
+    ESP_LOGI(TAG, "INT1: %lu irq, periodo medio %lld us (nominal %ld), min %ld, max %ld, jitter rms %.1f us, timeouts %lu",
+             (unsigned long)j->n, j->sum_us / j->n, (long)nominal_us, (long)j->min_us, (long)j->max_us,
+             sqrtf((float)(j->sum_sq_us / j->n)), (unsigned long)j->timeouts);
+    if (j->fusion_updates > 0) {
+        ESP_LOGI(TAG, "Fusion (%s): %lu ciclos/muestra",
+                 AHRS_ENGINE == AHRS_MAHONY_Q30 ? "Mahony Q30" : "complementario",
+                 (unsigned long)(j->fusion_cycles / j->fusion_updates));
+    }
 }
 
-static inline int16_t le16(const uint8_t *p) {
-    return (int16_t)((uint16_t)p[0] | ((uint16_t)p[1] << 8));
+// Bus I2C compartido (common/i2c_bus.h): el IMU va en la cola de prioridad alta
+static i2c_bus_t i2c_bus;
+static i2c_bus_dev_t imu_dev;
+
+static esp_err_t i2c_write_u8(i2c_bus_dev_t *dev, uint8_t reg, uint8_t val) {
+    return i2c_bus_write_u8(dev, reg, val);
 }
 
-// CALIBRACIÓN INICIAL
-void calibrate_sensor(uint8_t addr) {
-    const int num_samples = 200;
-    float sum_ax = 0, sum_ay = 0, sum_az = 0;
-    float sum_gx = 0, sum_gy = 0, sum_gz = 0;
-    uint8_t b[14];
+static esp_err_t i2c_read(i2c_bus_dev_t *dev, uint8_t reg, uint8_t *data, size_t len) {
+    return i2c_bus_read_reg(dev, reg, data, len);
+}
 
-    printf("\nINICIANDO CALIBRACION (5s) - NO TOCAR EL SENSOR\n");
-    for (int i = 5; i > 0; i--) {
-        printf("%d...\n", i);
-        vTaskDelay(pdMS_TO_TICKS(1000));
+// Registra el LSM6DS33 en la dirección que responda con el WHO_AM_I esperado
+static esp_err_t detect_lsm6(i2c_bus_dev_t *dev) {
+    const uint8_t candidates[2] = { LSM6_ADDR_6B, LSM6_ADDR_6A };
+    for (int i = 0; i < 2; i++) {
+        uint8_t who = 0x00;
+        if (i2c_bus_probe(&i2c_bus, candidates[i]) != ESP_OK) continue;
+        if (i2c_bus_add_device(&i2c_bus, dev, "lsm6", candidates[i], I2C_FREQ_HZ, I2C_BUS_PRIO_HIGH) != ESP_OK) continue;
+        if (i2c_read(dev, REG_WHO_AM_I, &who, 1) == ESP_OK && who == WHO_AM_I_EXPECTED) return ESP_OK;
+        i2c_bus_rm_device(dev);
     }
-    printf("Leyendo muestras...\n");
-
-    for (int i = 0; i < num_samples; i++) {
-        if (i2c_read(addr, REG_OUT_TEMP_L, b, sizeof(b)) == ESP_OK) {
-            int16_t raw_gx = le16(&b[2]);
-            int16_t raw_gy = le16(&b[4]);
-            int16_t raw_gz = le16(&b[6]);
-            int16_t raw_ax = le16(&b[8]);
-            int16_t raw_ay = le16(&b[10]);
-            int16_t raw_az = le16(&b[12]);
-
-            sum_ax += (raw_ax * accel_g_per_lsb);
-            sum_ay += (raw_ay * accel_g_per_lsb);
-            sum_az += (raw_az * accel_g_per_lsb);
-            sum_gx += (raw_gx * gyro_dps_per_lsb);
-            sum_gy += (raw_gy * gyro_dps_per_lsb);
-            sum_gz += (raw_gz * gyro_dps_per_lsb);
-        }
-        vTaskDelay(pdMS_TO_TICKS(5));
+    return ESP_ERR_NOT_FOUND;
+}
+
+static esp_err_t lsm6_init(i2c_bus_dev_t *dev) {
+    ESP_ERROR_CHECK(i2c_write_u8(dev, REG_CTRL3_C, 0x44));   
+    ESP_ERROR_CHECK(i2c_write_u8(dev, REG_CTRL1_XL, 0x40));  
+    ESP_ERROR_CHECK(i2c_write_u8(dev, REG_CTRL2_G, 0x40));   
+    return ESP_OK;
+}
+
+// FIFO HARDWARE (common/lsm6_fifo.h)
+
+static uint8_t lsm6_odr_code(int odr_hz) {
+    switch (odr_hz) {
+    case 104:  return 0x4;
+    case 208:  return 0x5;
+    case 416:  return 0x6;
+    case 833:  return 0x7;
+    case 1660: return 0x8;
+    default:   return 0x4;
     }
+}
 
-    offset_ax = sum_ax / num_samples;
-    offset_ay = sum_ay / num_samples;
-    offset_az = (sum_az / num_samples) - 1.0f;
-    offset_gx = sum_gx / num_samples;
-    offset_gy = sum_gy / num_samples;
-    offset_gz = sum_gz / num_samples;
+static uint8_t lsm6_dec_code(int dec) {
+    switch (dec) {
+    case 1:  return 0x1;
+    case 2:  return 0x2;
+    case 3:  return 0x3;
+    case 4:  return 0x4;
+    case 8:  return 0x5;
+    case 16: return 0x6;
+    case 32: return 0x7;
+    default: return 0x1;
+    }
+}
+
+// ODR de los sensores, watermark y FIFO en modo continuo (vacía el contenido previo)
+static esp_err_t lsm6_fifo_init(i2c_bus_dev_t *dev, int odr_hz, int dec, int wtm_samples) {
+    uint8_t odr = lsm6_odr_code(odr_hz);
+    uint16_t wtm = (uint16_t)(wtm_samples * LSM6_FIFO_WORDS_PER_SAMPLE);
+    uint8_t d = lsm6_dec_code(dec);
+
+    ESP_ERROR_CHECK(i2c_write_u8(dev, REG_CTRL1_XL, odr << 4));      // ±2 g
+    ESP_ERROR_CHECK(i2c_write_u8(dev, REG_CTRL2_G, odr << 4));       // 245 dps
+    ESP_ERROR_CHECK(i2c_write_u8(dev, REG_FIFO_CTRL5, FIFO_MODE_BYPASS));
+    ESP_ERROR_CHECK(i2c_write_u8(dev, REG_FIFO_CTRL1, wtm & 0xFF));
+    ESP_ERROR_CHECK(i2c_write_u8(dev, REG_FIFO_CTRL2, (wtm >> 8) & 0x0F));
+    ESP_ERROR_CHECK(i2c_write_u8(dev, REG_FIFO_CTRL3, (d << 3) | d));
+    ESP_ERROR_CHECK(i2c_write_u8(dev, REG_FIFO_CTRL5, (odr << 3) | FIFO_MODE_CONTINUOUS));
+    ESP_ERROR_CHECK(i2c_write_u8(dev, REG_INT1_CTRL, INT1_FTH));
+    return ESP_OK;
+}
 
-    printf("CALIBRACION COMPLETA.\n\n");
+static bool lsm6_fifo_read_burst(void *ctx, uint8_t *buf, size_t len) {
+    return i2c_read(ctx, REG_FIFO_DATA_OUT_L, buf, len) == ESP_OK;
+}
+
+// Vacía el FIFO en out (máx. max muestras). Cada bloque se lee con una sola
+// transacción I2C: con IF_INC la dirección vuelve de 0x3F a 0x3E al leer
+// FIFO_DATA_OUT en ráfaga. Devuelve el número de muestras o -1 si falla.
+static int lsm6_fifo_read(i2c_bus_dev_t *dev, lsm6_sample_t *out, int max, bool *overrun) {
+    uint8_t st[4];
+    if (i2c_read(dev, REG_FIFO_STATUS1, st, sizeof(st)) != ESP_OK) return -1;
+
+    static uint8_t raw[IMU_BURST_SAMPLES * LSM6_FIFO_SAMPLE_BYTES];
+    return lsm6_fifo_drain(st, lsm6_fifo_read_burst, dev, raw, IMU_BURST_SAMPLES, out, max, overrun);
+}
+
+// CALIBRACIÓN EN LÍNEA (common/imu_cal.h): offsets en LSB -> unidades físicas
+static void apply_calibration(const imu_cal_t *c) {
+    offset_gx = c->off[0] * gyro_dps_per_lsb;
+    offset_gy = c->off[1] * gyro_dps_per_lsb;
+    offset_gz = c->off[2] * gyro_dps_per_lsb;
+    offset_ax = c->off[3] * accel_g_per_lsb;
+    offset_ay = c->off[4] * accel_g_per_lsb;
+    offset_az = c->off[5] * accel_g_per_lsb;
+}
+
+// Temperatura interna (no va al FIFO) en centésimas de grado
+static esp_err_t read_temp_c100(i2c_bus_dev_t *dev, int16_t *t_c100) {
+    uint8_t tb[2];
+    esp_err_t err = i2c_read(dev, REG_OUT_TEMP_L, tb, sizeof(tb));
+    if (err == ESP_OK) *t_c100 = (int16_t)(2500 + lsm6_le16(tb) * 100 / 16);
+    return err;
 }
 
 
@@ -155,100 +307,241 @@ static void servo_stop_hard(void) {
 
 
 void app_main(void) {
-    i2c_config_t conf = {
-        .mode = I2C_MODE_MASTER,
-        .sda_io_num = I2C_SDA,
-        .scl_io_num = I2C_SCL,
-        .sda_pullup_en = GPIO_PULLUP_ENABLE,
-        .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .master.clk_speed = I2C_FREQ_HZ,
-        .clk_flags = 0,
-    };
-    ESP_ERROR_CHECK(i2c_param_config(I2C_PORT, &conf));
-    ESP_ERROR_CHECK(i2c_driver_install(I2C_PORT, conf.mode, 0, 0, 0));
+    ESP_ERROR_CHECK(i2c_bus_init(&i2c_bus, I2C_PORT, I2C_SDA, I2C_SCL, I2C_TIMEOUT_MS));
     
-    uint8_t addr = detect_lsm6_addr();
-    if (addr == 0) return;
-    ESP_ERROR_CHECK(lsm6_init(addr));
+    if (detect_lsm6(&imu_dev) != ESP_OK) return;
+    i2c_bus_dev_t *dev = &imu_dev;
+    ESP_ERROR_CHECK(lsm6_init(dev));
 
     servo_init();
 
-    calibrate_sensor(addr);
+    // Offsets guardados del arranque anterior: la fusión empieza sin esperar.
+    // Sin ellos se arranca con offsets nulos hasta el primer segundo quieto.
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(ret);
+
+    int16_t temp_c100 = 2500;
+    read_temp_c100(dev, &temp_c100);
+    static imu_cal_t cal;
+    imu_cal_init(&cal, IMU_SAMPLE_HZ, ACC_LSB_PER_G, GYRO_LSB_PER_DPS);
+    if (imu_cal_load(&cal, temp_c100) == ESP_OK) {
+        apply_calibration(&cal);
+        ESP_LOGI(TAG, "Calibracion cargada de NVS (%.1f C, ahora %.1f C%s)", cal.temp_c100 / 100.0f,
+                 temp_c100 / 100.0f, cal.stale ? ", se rehara" : "");
+    } else {
+        ESP_LOGW(TAG, "Sin calibracion guardada: dejar el sensor quieto y horizontal unos segundos");
+    }
+    int64_t t_cal_saved = 0;
+
+    imu_task_handle = xTaskGetCurrentTaskHandle();
+    imu_int1_init();
+    ESP_ERROR_CHECK(lsm6_fifo_init(dev, IMU_ODR_HZ, IMU_FIFO_DEC, IMU_FIFO_WTM));
+#if TELEM_BINARY
+    ESP_ERROR_CHECK(telem_start(TELEM_BUF_SIZE, 2));
+#endif
+    ESP_LOGI(TAG, "FIFO: ODR %d Hz, decimacion %d, watermark %d muestras", IMU_ODR_HZ, IMU_FIFO_DEC, IMU_FIFO_WTM);
+
+    static lsm6_sample_t batch[IMU_BATCH_MAX];
 
     float pitch = 0, roll = 0, yaw = 0; 
+    const float dt_nom = 1.0f / IMU_SAMPLE_HZ;
+#if AHRS_ENGINE == AHRS_MAHONY_Q30
+    // Offsets y zona muerta en LSB para no convertir a float en el bucle
+    int32_t off_g[3], off_a[3];
+    for (int k = 0; k < 3; k++) {
+        off_g[k] = lroundf(cal.off[k]);
+        off_a[k] = lroundf(cal.off[3 + k]);
+    }
+    const int32_t dead_lsb = lroundf(GYRO_DEADZONE / gyro_dps_per_lsb);
+    // rad/s por LSB en Q30: g_q16 = (lsb * k) >> 14
+    const int32_t gyro_rad_q30 = AHRS_Q30(gyro_dps_per_lsb * AHRS_PI / 180.0f);
+    ahrs_mahony_t ahrs;
+    ahrs_mahony_init(&ahrs, AHRS_Q16(MAHONY_KP), AHRS_Q16(MAHONY_KI));
+#else
     float pitch_acc_f = 0, roll_acc_f = 0;
-    const float alpha_lp = 0.10f;
-    const float beta_cf  = 0.98f;
-    int64_t t_prev = esp_timer_get_time();
+    // Mismas constantes de tiempo que con el muestreo original a 10 Hz
+    // (paso bajo ~0.9 s, complementario ~4.9 s), ahora a la tasa del FIFO
+    const float alpha_lp = dt_nom / (0.9f + dt_nom);
+    const float beta_cf  = 4.9f / (4.9f + dt_nom);
+#endif
+    const int32_t period_nom_us = IMU_FIFO_WTM * 1000000 / IMU_SAMPLE_HZ;
+
+    imu_jitter_t jit;
+    jitter_reset(&jit);
+    int64_t t_isr_prev = 0;
+    int64_t t_report = esp_timer_get_time();
 
     while (1) {
-        uint8_t b[14];
-        if (i2c_read(addr, REG_OUT_TEMP_L, b, sizeof(b)) != ESP_OK) {
-            vTaskDelay(pdMS_TO_TICKS(100));
-            continue;
+        // Espera a la interrupción de watermark; el timeout cubre un flanco perdido
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(2 * IMU_POLL_MS)) == 0) jit.timeouts++;
+        int64_t t_isr = imu_isr_time_us;
+
+        bool overrun = false;
+        int n = lsm6_fifo_read(dev, batch, IMU_BATCH_MAX, &overrun);
+        if (n <= 0) continue;
+        if (overrun) ESP_LOGW(TAG, "FIFO desbordado: se han perdido muestras");
+        uint32_t t_read = (uint32_t)esp_timer_get_time();   // ~ marca de la última muestra
+
+        // dt real a partir de las marcas de la ISR (el reloj del sensor no es
+        // exacto), limitado a ±10 % del nominal
+        float dt = dt_nom;
+        if (t_isr_prev != 0 && t_isr != t_isr_prev) {
+            int32_t interval = (int32_t)(t_isr - t_isr_prev);
+            jitter_add(&jit, interval, period_nom_us);
+            dt = (float)interval / 1e6f / n;
+            if (dt < 0.9f * dt_nom) dt = 0.9f * dt_nom;
+            if (dt > 1.1f * dt_nom) dt = 1.1f * dt_nom;
         }
+        t_isr_prev = t_isr;
 
-        // Raw data
-        int16_t raw_temp = le16(&b[0]);
-        int16_t raw_gx = le16(&b[2]);
-        int16_t raw_gy = le16(&b[4]);
-        int16_t raw_gz = le16(&b[6]);
-        int16_t raw_ax = le16(&b[8]);
-        int16_t raw_ay = le16(&b[10]);
-        int16_t raw_az = le16(&b[12]);
-
-        // Conversión con Offset
-        float ax = (raw_ax * accel_g_per_lsb) - offset_ax;
-        float ay = (raw_ay * accel_g_per_lsb) - offset_ay;
-        float az = (raw_az * accel_g_per_lsb) - offset_az;
-        
-        float gx = (raw_gx * gyro_dps_per_lsb) - offset_gx;
-        float gy = (raw_gy * gyro_dps_per_lsb) - offset_gy;
-        float gz = (raw_gz * gyro_dps_per_lsb) - offset_gz;
-
-        // Temperatura
-        float temp_c = 25.0f + (raw_temp / 16.0f);
-
-        // Deadzone para el Drift
-        if (fabs(gx) < GYRO_DEADZONE) gx = 0;
-        if (fabs(gy) < GYRO_DEADZONE) gy = 0;
-        if (fabs(gz) < GYRO_DEADZONE) gz = 0;
-
-        // Tiempo delta
-        int64_t t_now = esp_timer_get_time();
-        float dt = (float)(t_now - t_prev) / 1e6f;
-        t_prev = t_now;
-        if (dt <= 0) dt = 0.01f;
-
-        // Fusión de Sensores
-        float roll_acc  = atan2f(ay, az) * 180.0f / (float)M_PI;
-        float pitch_acc = atan2f(-ax, sqrtf(ay*ay + az*az)) * 180.0f / (float)M_PI;
-
-        roll_acc_f  = alpha_lp * roll_acc  + (1.0f - alpha_lp) * roll_acc_f;
-        pitch_acc_f = alpha_lp * pitch_acc + (1.0f - alpha_lp) * pitch_acc_f;
-        
-        roll  = beta_cf * (roll  + gx * dt) + (1.0f - beta_cf) * roll_acc_f;
-        pitch = beta_cf * (pitch + gy * dt) + (1.0f - beta_cf) * pitch_acc_f;
-        yaw   = yaw + gz * dt; 
+        // Temperatura una vez por lote; las muestras alimentan la calibración
+        read_temp_c100(dev, &temp_c100);
+        bool cal_changed = false;
+        for (int i = 0; i < n; i++) {
+            if (imu_cal_add(&cal, batch[i].g, batch[i].a, temp_c100)) cal_changed = true;
+        }
+        if (cal_changed) {
+            apply_calibration(&cal);
+#if AHRS_ENGINE == AHRS_MAHONY_Q30
+            for (int k = 0; k < 3; k++) {
+                off_g[k] = lroundf(cal.off[k]);
+                off_a[k] = lroundf(cal.off[3 + k]);
+            }
+#endif
+            int64_t now = esp_timer_get_time();
+            if (imu_cal_should_save(&cal) &&
+                (!cal.saved || now - t_cal_saved >= IMU_CAL_SAVE_MIN_S * 1000000LL)) {
+                if (imu_cal_save(&cal) == ESP_OK) {
+                    t_cal_saved = now;
+                    ESP_LOGI(TAG, "Calibracion guardada: G %.2f %.2f %.2f dps a %.1f C", offset_gx, offset_gy,
+                             offset_gz, cal.temp_c100 / 100.0f);
+                }
+            }
+        }
 
-        char servo_status[20];
+        float ax = 0, ay = 0, az = 0, gx = 0, gy = 0, gz = 0;
+        uint32_t c0 = esp_cpu_get_cycle_count();
+
+#if AHRS_ENGINE == AHRS_MAHONY_Q30
+        const int32_t dt_q30 = AHRS_Q30(dt);
+        int32_t a_lsb[3], g_q16[3];
+
+        for (int i = 0; i < n; i++) {
+            for (int k = 0; k < 3; k++) {
+                int32_t g = batch[i].g[k] - off_g[k];
+                if (g > -dead_lsb && g < dead_lsb) g = 0;
+                g_q16[k] = (int32_t)(((int64_t)g * gyro_rad_q30) >> 14);
+                a_lsb[k] = batch[i].a[k] - off_a[k];
+            }
+            ahrs_mahony_update(&ahrs, g_q16, a_lsb, dt_q30);
+        }
+        jit.fusion_cycles += esp_cpu_get_cycle_count() - c0;
+        jit.fusion_updates += n;
+
+        // Conversión a float sólo para mostrar la última muestra y mover el servo
+        ahrs_mahony_euler_deg(&ahrs, &roll, &pitch, &yaw);
+        ax = a_lsb[0] * accel_g_per_lsb;
+        ay = a_lsb[1] * accel_g_per_lsb;
+        az = a_lsb[2] * accel_g_per_lsb;
+        gx = (batch[n - 1].g[0] - off_g[0]) * gyro_dps_per_lsb;
+        gy = (batch[n - 1].g[1] - off_g[1]) * gyro_dps_per_lsb;
+        gz = (batch[n - 1].g[2] - off_g[2]) * gyro_dps_per_lsb;
+#else
+        for (int i = 0; i < n; i++) {
+            // Conversión con Offset
+            ax = (batch[i].a[0] * accel_g_per_lsb) - offset_ax;
+            ay = (batch[i].a[1] * accel_g_per_lsb) - offset_ay;
+            az = (batch[i].a[2] * accel_g_per_lsb) - offset_az;
+
+            gx = (batch[i].g[0] * gyro_dps_per_lsb) - offset_gx;
+            gy = (batch[i].g[1] * gyro_dps_per_lsb) - offset_gy;
+            gz = (batch[i].g[2] * gyro_dps_per_lsb) - offset_gz;
+
+            // Deadzone para el Drift
+            if (fabs(gx) < GYRO_DEADZONE) gx = 0;
+            if (fabs(gy) < GYRO_DEADZONE) gy = 0;
+            if (fabs(gz) < GYRO_DEADZONE) gz = 0;
+
+            // Fusión de Sensores (dt medido con las marcas de INT1)
+            float roll_acc  = atan2f(ay, az) * 180.0f / (float)M_PI;
+            float pitch_acc = atan2f(-ax, sqrtf(ay*ay + az*az)) * 180.0f / (float)M_PI;
+
+            roll_acc_f  = alpha_lp * roll_acc  + (1.0f - alpha_lp) * roll_acc_f;
+            pitch_acc_f = alpha_lp * pitch_acc + (1.0f - alpha_lp) * pitch_acc_f;
+
+            roll  = beta_cf * (roll  + gx * dt) + (1.0f - beta_cf) * roll_acc_f;
+            pitch = beta_cf * (pitch + gy * dt) + (1.0f - beta_cf) * pitch_acc_f;
+            yaw   = yaw + gz * dt;
+        }
+        jit.fusion_cycles += esp_cpu_get_cycle_count() - c0;
+        jit.fusion_updates += n;
+#endif
+
+        uint8_t servo_state;
         
         if (pitch > 40.0f) {
             servo_write_us(PULSE_CW);
-            sprintf(servo_status, "GIRO DCHA");
+            servo_state = 1;
         } 
         else if (pitch < -40.0f) {
             servo_write_us(PULSE_CCW);
-            sprintf(servo_status, "GIRO IZQ");
+            servo_state = 2;
         } 
         else {
             servo_stop_hard(); // PWM = 0
-            sprintf(servo_status, "STOP");
+            servo_state = 0;
         }
 
-        printf("ACC: %5.2f %5.2f %5.2f | GYR: %6.1f %6.1f %6.1f | POS: R=%5.1f P=%5.1f Y=%5.1f | TMP: %.1f C | SRV: %s\n",
-               ax, ay, az, gx, gy, gz, roll, pitch, yaw, temp_c, servo_status);
+#if TELEM_BINARY
+        // Todas las muestras crudas del lote, en registros de hasta 32
+        uint16_t period_us = (uint16_t)(dt * 1e6f);
+        static telem_rec_t rec;
+        for (int done = 0; done < n; ) {
+            int k = n - done;
+            if (k > TELEM_IMU_MAX_SAMPLES) k = TELEM_IMU_MAX_SAMPLES;
+            telem_begin(&rec, TELEM_IMU_RAW);
+            telem_put_u32(&rec, t_read - (uint32_t)(n - done - k) * period_us);
+            telem_put_u16(&rec, period_us);
+            telem_put_u8(&rec, (uint8_t)k);
+            for (int i = done; i < done + k; i++) {
+                for (int j = 0; j < 3; j++) telem_put_u16(&rec, (uint16_t)batch[i].g[j]);
+                for (int j = 0; j < 3; j++) telem_put_u16(&rec, (uint16_t)batch[i].a[j]);
+            }
+            telem_send(&rec);
+            done += k;
+        }
 
-        vTaskDelay(pdMS_TO_TICKS(100)); 
+        telem_begin(&rec, TELEM_ATTITUDE);
+        telem_put_u32(&rec, t_read);
+        telem_put_u16(&rec, (uint16_t)(int16_t)lroundf(roll * 100.0f));
+        telem_put_u16(&rec, (uint16_t)(int16_t)lroundf(pitch * 100.0f));
+        telem_put_u16(&rec, (uint16_t)(int16_t)lroundf(remainderf(yaw, 360.0f) * 100.0f));
+        telem_put_u16(&rec, (uint16_t)temp_c100);
+        telem_put_u8(&rec, servo_state);
+        telem_send(&rec);
+        (void)ax; (void)ay; (void)az; (void)gx; (void)gy; (void)gz;   // sólo en modo texto
+#else
+        static const char *const servo_names[] = { "STOP", "GIRO DCHA", "GIRO IZQ" };
+        float temp_c = temp_c100 / 100.0f;
+        printf("ACC: %5.2f %5.2f %5.2f | GYR: %6.1f %6.1f %6.1f | POS: R=%5.1f P=%5.1f Y=%5.1f | TMP: %.1f C | SRV: %s | N=%d\n",
+               ax, ay, az, gx, gy, gz, roll, pitch, yaw, temp_c, servo_names[servo_state], n);
+#endif
+
+        if (esp_timer_get_time() - t_report >= IMU_JITTER_PERIOD_S * 1000000LL) {
+            t_report = esp_timer_get_time();
+            jitter_print(&jit, period_nom_us);
+            ESP_LOGI(TAG, "I2C %s: %lu trans, %lu errores, lat media %lu us (max %lu)", dev->name,
+                     (unsigned long)dev->stats.transactions, (unsigned long)dev->stats.errors,
+                     (unsigned long)i2c_bus_lat_avg_us(&dev->stats), (unsigned long)dev->stats.lat_max_us);
+#if TELEM_BINARY
+            ESP_LOGI(TAG, "Telemetria: %lu tramas, %lu descartadas", (unsigned long)s_telem.frames,
+                     (unsigned long)s_telem.dropped);
+#endif
+            jitter_reset(&jit);
+        }
     }
 }
\ No newline at end of file
@@ -2,10 +2,14 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stddef.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <sys/time.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/queue.h"
 
 #include "esp_log.h"
 #include "esp_err.h"
@@ -14,6 +18,10 @@
 #include "esp_event.h"
 #include "nvs_flash.h"
 #include "esp_netif.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_mac.h"
+#include "esp_netif_sntp.h"
 
 #include "lwip/sockets.h"
 #include "lwip/dns.h"
@@ -21,10 +29,20 @@
 
 #include "driver/uart.h"
 #include "driver/gpio.h"
-#include "driver/i2c.h"
 
 #include "mqtt_client.h"
 
+#include "nmea.h"
+#include "ubx.h"
+#include "gps_uart.h"
+#include "bmp280.h"
+#include "i2c_bus.h"
+#include "sensor_msg.h"
+#include "flash_log.h"
+#include "deadband.h"
+#include "node_cfg.h"
+#include "track.h"
+
 static const char *TAG = "GPS+BMP+MQTT";
 
 // ===================== CONFIGURACIÓN WIFI Y MQTT =====================
@@ -32,6 +50,45 @@ static const char *TAG = "GPS+BMP+MQTT";
 #define WIFI_PASS      "1234567890"
 #define MQTT_BROKER_URI "mqtt://192.168.1.10:1883" // Tu broker MQTT
 #define MQTT_TOPIC     "test/gps"
+#define MQTT_TOPIC_TRACK MQTT_TOPIC "/track"   // segmentos de recorrido comprimidos
+#define MQTT_TOPIC_CFG   MQTT_TOPIC "/cfg/"    // + id del nodo: configuración en marcha (node_cfg.h)
+#define SNTP_SERVER    "pool.ntp.org"          // hora de publicación para medir latencias
+
+// Payload de MQTT_TOPIC: 1 = lotes binarios (sensor_msg.h), 0 = JSON.
+// PAYLOAD_BENCH = 1 compara ambos codificadores una vez al arrancar el
+// publicador; sólo para medir, no en el uso normal.
+#define PAYLOAD_BINARY  1
+#define PAYLOAD_BENCH   0
+#define PAYLOAD_BENCH_N 100
+
+// Los valores DB_*, BATCH_*, MQTT_QOS y BMP_* de aquí en adelante son los
+// de fábrica: se cambian en marcha por MQTT_TOPIC_CFG y se guardan en NVS.
+//
+// Publicación por cambios: cada productor sólo entrega (y notifica) una
+// muestra si algún canal sale de su banda muerta o tras DB_MAX_SILENCE_MS
+// sin publicar (deadband.h). Todas esperan en el lote hasta
+// BATCH_MAX_LATENCY_MS salvo el primer cambio tras un periodo en reposo
+// (DEADBAND_ONSET), que publica el lote en el acto.
+#define DB_TEMP_C100            5       // 0.05 °C
+#define DB_PRESS_PA             12      // ~1 m de altitud
+#define DB_GPS_E7               270     // ~3 m
+#define DB_SPEED_MMS            500
+#define DB_MAX_SILENCE_MS       60000
+
+// Publicación por lotes: las muestras se guardan con su marca de tiempo y el
+// lote se publica al llegar a BATCH_MAX_SAMPLES muestras o
+// BATCH_MAX_LATENCY_MS después de la primera, lo que ocurra antes
+#define BATCH_MAX_SAMPLES       24      // <= SENSOR_BATCH_MAX_SAMPLES
+#define BATCH_MAX_LATENCY_MS    10000   // < 32768 (dt de 16 bits con signo)
+#define MQTT_QOS                1
+#define BMP_QUEUE_LEN           8
+
+// Store-and-forward: sin broker, los lotes van a la partición STORE_PARTITION
+// (flash_log.h, ver data/partitions.csv) y al reconectar se reenvían con QoS 1,
+// uno cada STORE_REPLAY_INTERVAL_MS y de uno en uno (el siguiente tras el PUBACK)
+#define STORE_PARTITION         "storefwd"
+#define STORE_REPLAY_INTERVAL_MS 200
+#define STORE_REPLAY_TIMEOUT_MS 5000    // sin PUBACK: se vuelve a enviar
 
 // ===================== GPS (UART) =====================
 #define GPS_UART   UART_NUM_1
@@ -39,218 +96,258 @@ static const char *TAG = "GPS+BMP+MQTT";
 #define GPS_TXD    GPIO_NUM_21   // ESP TX  -> GPS RX (opcional)
 #define GPS_BAUD   9600
 
+// Modo UBX: NAV-PVT binario a alta velocidad (0 = NMEA a GPS_BAUD)
+#define GPS_UBX_MODE     0
+#define GPS_UBX_BAUD     115200
+#define GPS_UBX_RATE_HZ  5
+
+#define GPS_STATS_PERIOD_MS 10000
+
+// Recorrido: se cierra un segmento al llenarse (TRACK_SEG_MAX_BYTES), tras
+// TRACK_SEG_MAX_MS o al perder el fix. TRACK_DEADBAND_M = 0 desactiva la
+// simplificación.
+#define TRACK_SEG_MAX_MS     60000
+#define TRACK_DEADBAND_M     3
+
 // ===================== I2C (BMP/BME280) =====================
 #define I2C_PORT        I2C_NUM_0
 #define I2C_SDA         GPIO_NUM_8
 #define I2C_SCL         GPIO_NUM_10
-#define I2C_FREQ_HZ     100000
+#define I2C_FREQ_HZ     400000
+#define I2C_TIMEOUT_MS  100
 
 #define BMP_ADDR_1      0x76
 #define BMP_ADDR_2      0x77
 
+// Perfil de medida (bmp280.h) y periodo de lectura en modo forzado
+#define BMP_PROFILE     BMP280_PROFILE_STANDARD
+#define BMP_PERIOD_MS   1000
+
 #define REG_ID          0xD0
-#define REG_CTRL_MEAS   0xF4
-#define REG_CONFIG      0xF5
+#define REG_STATUS      BMP280_REG_STATUS
+#define REG_CTRL_MEAS   BMP280_REG_CTRL_MEAS
+#define REG_CONFIG      BMP280_REG_CONFIG
 #define REG_PRESS_MSB   0xF7
 #define REG_CALIB_00    0x88
 
 #define ID_BMP280       0x58
 #define ID_BME280       0x60
 
-static volatile float g_temp_c = 0.0f;
-static volatile float g_press_hpa = 0.0f;
-static volatile int   g_sensor_ok = 0;
+// Muestras del BMP280 hacia publisher_task, en enteros (bmp280.h)
+typedef struct {
+    uint32_t t_ms;          // ms desde el arranque
+    int32_t  temp_c100;     // 0.01 °C
+    uint32_t press_pa;
+    uint8_t  publish;       // deadband_result_t
+} bmp_sample_t;
+
+static QueueHandle_t g_bmp_queue;
+static uint32_t g_bmp_dropped;
+static TaskHandle_t g_publisher;    // los productores le avisan de cada muestra
+static TaskHandle_t g_bmp_task;     // se le avisa de los cambios de configuración
+
+// Configuración en marcha: la escribe sólo mqtt_event_handler; las tareas
+// toman una copia cuando cambia la versión
+static node_cfg_t   g_cfg;
+static portMUX_TYPE g_cfg_mux = portMUX_INITIALIZER_UNLOCKED;
+static atomic_uint  g_cfg_version;
+static uint32_t     g_node_id;      // 4 últimos bytes de la MAC
+static char         g_cfg_topic[48];
+static char         g_cfg_state_topic[56];
+
+static unsigned cfg_get(node_cfg_t *c)
+{
+    taskENTER_CRITICAL(&g_cfg_mux);
+    *c = g_cfg;
+    unsigned ver = atomic_load(&g_cfg_version);
+    taskEXIT_CRITICAL(&g_cfg_mux);
+    return ver;
+}
 
-static char g_last_nmea[256] = {0};
-static volatile int g_gps_updated = 0;
-static portMUX_TYPE g_gps_mux = portMUX_INITIALIZER_UNLOCKED;
+// Actualiza la copia c si la configuración ha cambiado desde *ver
+static bool cfg_refresh(node_cfg_t *c, unsigned *ver)
+{
+    if (atomic_load(&g_cfg_version) == *ver) return false;
+    *ver = cfg_get(c);
+    return true;
+}
+
+static gps_uart_t g_gps;        // ingesta por eventos UART + contadores
 
 // Cliente MQTT
 static esp_mqtt_client_handle_t mqtt_client = NULL;
 static bool mqtt_connected = false;
 
+// Reenvío desde flash en curso: lo confirma mqtt_event_handler con el PUBACK
+static atomic_int  g_replay_msg_id = -1;
+static atomic_bool g_replay_acked;
+
 // --------------------- BMP/BME calibration ---------------------
+// Términos de compensación precalculados tras leer la calibración (bmp280.h)
+static bmp280_comp_t bmp_comp;
+static const bmp280_profile_t *bmp_prof;
+// Bus I2C compartido (common/i2c_bus.h): el BMP280 va en la cola de prioridad
+// baja para no retrasar a sensores más rápidos en el mismo bus
+static i2c_bus_t i2c_bus;
+static i2c_bus_dev_t bmp_dev;
+
+// ===================== Cola SPSC GPS -> publisher =====================
+// Un único productor (gps_uart_task) y un único consumidor (publisher_task):
+// basta con índices atómicos con semántica acquire/release, sin secciones
+// críticas. Sólo se usan load/store atómicos de 32 bits, que el RV32IMC de la
+// ESP32-C3 ejecuta sin extensión A.
+#define GPS_RING_SIZE   32      // potencia de 2
+
+// Posición en punto fijo: se decodifica sin coma flotante y se publica tal cual
 typedef struct {
-    uint16_t dig_T1;
-    int16_t  dig_T2;
-    int16_t  dig_T3;
-
-    uint16_t dig_P1;
-    int16_t  dig_P2;
-    int16_t  dig_P3;
-    int16_t  dig_P4;
-    int16_t  dig_P5;
-    int16_t  dig_P6;
-    int16_t  dig_P7;
-    int16_t  dig_P8;
-    int16_t  dig_P9;
-
-    int32_t  t_fine;
-} bmp_calib_t;
-
-static bmp_calib_t cal;
-static uint8_t bmp_addr = 0;
+    uint32_t time_ms;       // hora UTC del fix, ms desde las 00:00
+    int32_t  lat_e7;        // grados * 1e7, + Norte
+    int32_t  lon_e7;        // grados * 1e7, + Este
+    uint32_t speed_mms;     // mm/s
+    uint16_t course_cdeg;   // grados * 100
+    uint8_t  valid;
+    uint32_t t_ms;          // ms desde el arranque al decodificarlo
+    uint8_t  publish;       // deadband_result_t; HOLD = sólo para el recorrido
+} gps_fix_t;
 
-// ===================== I2C helpers =====================
-static esp_err_t i2c_write_u8(uint8_t dev, uint8_t reg, uint8_t val)
-{
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (dev << 1) | I2C_MASTER_WRITE, true);
-    i2c_master_write_byte(cmd, reg, true);
-    i2c_master_write_byte(cmd, val, true);
-    i2c_master_stop(cmd);
-    esp_err_t err = i2c_master_cmd_begin(I2C_PORT, cmd, pdMS_TO_TICKS(1000));
-    i2c_cmd_link_delete(cmd);
-    return err;
-}
+typedef struct {
+    gps_fix_t    buf[GPS_RING_SIZE];
+    atomic_uint  head;      // escrito sólo por el productor
+    atomic_uint  tail;      // escrito sólo por el consumidor
+    uint32_t     pushed;
+    uint32_t     dropped;   // fixes descartados por cola llena
+} gps_ring_t;
+
+static gps_ring_t g_gps_ring;
 
-static esp_err_t i2c_read(uint8_t dev, uint8_t reg, uint8_t *data, size_t len)
+static bool gps_ring_push(gps_ring_t *r, const gps_fix_t *fix)
 {
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (dev << 1) | I2C_MASTER_WRITE, true);
-    i2c_master_write_byte(cmd, reg, true);
-
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (dev << 1) | I2C_MASTER_READ, true);
-    if (len > 1) i2c_master_read(cmd, data, len - 1, I2C_MASTER_ACK);
-    i2c_master_read_byte(cmd, data + len - 1, I2C_MASTER_NACK);
-    i2c_master_stop(cmd);
-
-    esp_err_t err = i2c_master_cmd_begin(I2C_PORT, cmd, pdMS_TO_TICKS(1000));
-    i2c_cmd_link_delete(cmd);
-    return err;
+    unsigned head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    if (head - tail >= GPS_RING_SIZE) {
+        r->dropped++;
+        return false;
+    }
+    r->buf[head & (GPS_RING_SIZE - 1)] = *fix;
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+    r->pushed++;
+    return true;
 }
 
-static esp_err_t i2c_probe(uint8_t dev)
+static unsigned gps_ring_count(gps_ring_t *r)
 {
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (dev << 1) | I2C_MASTER_WRITE, true);
-    i2c_master_stop(cmd);
-    esp_err_t err = i2c_master_cmd_begin(I2C_PORT, cmd, pdMS_TO_TICKS(200));
-    i2c_cmd_link_delete(cmd);
-    return err;
+    return atomic_load_explicit(&r->head, memory_order_relaxed) - atomic_load_explicit(&r->tail, memory_order_relaxed);
 }
 
-static esp_err_t i2c_init_simple(void)
+static bool gps_ring_pop(gps_ring_t *r, gps_fix_t *fix)
 {
-    i2c_config_t cfg = {
-        .mode = I2C_MODE_MASTER,
-        .sda_io_num = I2C_SDA,
-        .scl_io_num = I2C_SCL,
-        .sda_pullup_en = GPIO_PULLUP_ENABLE,
-        .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .master.clk_speed = I2C_FREQ_HZ,
-        .clk_flags = 0
-    };
-    ESP_ERROR_CHECK(i2c_param_config(I2C_PORT, &cfg));
-    return i2c_driver_install(I2C_PORT, cfg.mode, 0, 0, 0);
+    unsigned tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&r->head, memory_order_acquire);
+    if (tail == head) return false;
+    *fix = r->buf[tail & (GPS_RING_SIZE - 1)];
+    atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+    return true;
 }
 
-// ===================== BMP/BME =====================
-static int32_t bmp_comp_temp(int32_t adc_T)
+// ===================== Recorrido GPS comprimido =====================
+// Segmentos delta + varint (track.h) que se publican en MQTT_TOPIC_TRACK
+static track_seg_t g_track;
+
+// ===================== I2C helpers =====================
+static esp_err_t i2c_write_u8(i2c_bus_dev_t *dev, uint8_t reg, uint8_t val)
 {
-    int32_t var1, var2;
-    var1 = ((((adc_T >> 3) - ((int32_t)cal.dig_T1 << 1))) * ((int32_t)cal.dig_T2)) >> 11;
-    var2 = (((((adc_T >> 4) - ((int32_t)cal.dig_T1)) * ((adc_T >> 4) - ((int32_t)cal.dig_T1))) >> 12) *
-            ((int32_t)cal.dig_T3)) >> 14;
-    cal.t_fine = var1 + var2;
-    return (cal.t_fine * 5 + 128) >> 8; // 0.01 ºC
+    return i2c_bus_write_u8(dev, reg, val);
 }
 
-static uint32_t bmp_comp_press(int32_t adc_P)
+static esp_err_t i2c_read(i2c_bus_dev_t *dev, uint8_t reg, uint8_t *data, size_t len)
 {
-    int64_t var1, var2, p;
-    var1 = ((int64_t)cal.t_fine) - 128000;
-    var2 = var1 * var1 * (int64_t)cal.dig_P6;
-    var2 = var2 + ((var1 * (int64_t)cal.dig_P5) << 17);
-    var2 = var2 + (((int64_t)cal.dig_P4) << 35);
-    var1 = ((var1 * var1 * (int64_t)cal.dig_P3) >> 8) + ((var1 * (int64_t)cal.dig_P2) << 12);
-    var1 = (((((int64_t)1) << 47) + var1) * (int64_t)cal.dig_P1) >> 33;
-    if (var1 == 0) return 0;
-    p = 1048576 - adc_P;
-    p = (((p << 31) - var2) * 3125) / var1;
-    var1 = ((int64_t)cal.dig_P9 * (p >> 13) * (p >> 13)) >> 25;
-    var2 = ((int64_t)cal.dig_P8 * p) >> 19;
-    p = ((p + var1 + var2) >> 8) + (((int64_t)cal.dig_P7) << 4);
-    return (uint32_t)p; // Pa*256 (Q24.8)
+    return i2c_bus_read_reg(dev, reg, data, len);
 }
 
 // ===================== BMP/BME init/read =====================
-static esp_err_t bmp_read_calib(uint8_t dev)
+static esp_err_t bmp_read_calib(i2c_bus_dev_t *dev)
 {
-    uint8_t b[24];
+    uint8_t b[BMP280_CALIB_LEN];
+    bmp280_calib_t calib;
     esp_err_t err = i2c_read(dev, REG_CALIB_00, b, sizeof(b));
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "calib read failed: %s", esp_err_to_name(err));
         return err;
     }
 
-    cal.dig_T1 = (uint16_t)(b[1] << 8 | b[0]);
-    cal.dig_T2 = (int16_t)(b[3] << 8 | b[2]);
-    cal.dig_T3 = (int16_t)(b[5] << 8 | b[4]);
+    bmp280_parse_calib(b, &calib);
+    bmp280_comp_init(&bmp_comp, &calib);
+    return ESP_OK;
+}
 
-    cal.dig_P1 = (uint16_t)(b[7] << 8 | b[6]);
-    cal.dig_P2 = (int16_t)(b[9] << 8 | b[8]);
-    cal.dig_P3 = (int16_t)(b[11] << 8 | b[10]);
-    cal.dig_P4 = (int16_t)(b[13] << 8 | b[12]);
-    cal.dig_P5 = (int16_t)(b[15] << 8 | b[14]);
-    cal.dig_P6 = (int16_t)(b[17] << 8 | b[16]);
-    cal.dig_P7 = (int16_t)(b[19] << 8 | b[18]);
-    cal.dig_P8 = (int16_t)(b[21] << 8 | b[20]);
-    cal.dig_P9 = (int16_t)(b[23] << 8 | b[22]);
+// En reposo (sleep) hasta cada medida forzada; CONFIG sólo se acepta con
+// seguridad fuera del modo normal
+static esp_err_t bmp_set_profile(bmp280_profile_id_t id)
+{
+    const bmp280_profile_t *prof = bmp280_profile(id);
+    esp_err_t err = i2c_write_u8(&bmp_dev, REG_CTRL_MEAS, bmp280_ctrl_meas(prof, BMP280_MODE_SLEEP));
+    if (err != ESP_OK) return err;
 
+    err = i2c_write_u8(&bmp_dev, REG_CONFIG, bmp280_config(prof));
+    if (err != ESP_OK) return err;
+
+    bmp_prof = prof;
+    ESP_LOGI(TAG, "Perfil BMP %d: osrs_t x%d, osrs_p x%d, IIR %d, conversion max %" PRIu32 " us",
+             id, prof->osrs_t, prof->osrs_p, prof->filter, bmp280_meas_time_us(prof));
     return ESP_OK;
 }
 
-static esp_err_t bmp_init_detect(void)
+static esp_err_t bmp_init_detect(bmp280_profile_id_t profile)
 {
     uint8_t candidates[2] = {BMP_ADDR_1, BMP_ADDR_2};
 
     for (int i = 0; i < 2; i++) {
         uint8_t addr = candidates[i];
-        if (i2c_probe(addr) != ESP_OK) continue;
+        if (i2c_bus_probe(&i2c_bus, addr) != ESP_OK) continue;
+        if (i2c_bus_add_device(&i2c_bus, &bmp_dev, "bmp280", addr, I2C_FREQ_HZ, I2C_BUS_PRIO_LOW) != ESP_OK) continue;
 
         uint8_t id = 0;
-        if (i2c_read(addr, REG_ID, &id, 1) != ESP_OK) continue;
-
-        if (id == ID_BMP280 || id == ID_BME280) {
-            bmp_addr = addr;
-            ESP_LOGI(TAG, "Sensor encontrado en 0x%02X, ID=0x%02X", bmp_addr, id);
-
-            esp_err_t err = bmp_read_calib(bmp_addr);
-            if (err != ESP_OK) return err;
+        if (i2c_read(&bmp_dev, REG_ID, &id, 1) == ESP_OK && (id == ID_BMP280 || id == ID_BME280)) {
+            ESP_LOGI(TAG, "Sensor encontrado en 0x%02X, ID=0x%02X", addr, id);
 
-            // osrs_t=x1, osrs_p=x1, normal mode => 0x27
-            err = i2c_write_u8(bmp_addr, REG_CTRL_MEAS, 0x27);
+            esp_err_t err = bmp_read_calib(&bmp_dev);
             if (err != ESP_OK) return err;
-
-            err = i2c_write_u8(bmp_addr, REG_CONFIG, 0x00);
-            if (err != ESP_OK) return err;
-
-            return ESP_OK;
+            return bmp_set_profile(profile);
         }
+        // Otro chip en esa dirección: se libera el handle y se prueba la siguiente
+        i2c_bus_rm_device(&bmp_dev);
     }
     return ESP_ERR_NOT_FOUND;
 }
 
-static esp_err_t bmp_read_tp(float *temp_c, float *press_hpa)
+// Medida en modo forzado: dispara una conversión, espera el tiempo máximo
+// del datasheet para el perfil y lee el resultado
+static esp_err_t bmp_read_tp(int32_t *temp_c100, uint32_t *press_pa)
 {
+    const bmp280_profile_t *prof = bmp_prof;
+    esp_err_t err = i2c_write_u8(&bmp_dev, REG_CTRL_MEAS, bmp280_ctrl_meas(prof, BMP280_MODE_FORCED));
+    if (err != ESP_OK) return err;
+
+    // +1 tick: pdMS_TO_TICKS redondea hacia abajo (con 100 Hz, 6 ms serían 0 ticks)
+    vTaskDelay(pdMS_TO_TICKS((bmp280_meas_time_us(prof) + 999) / 1000) + 1);
+
+    uint8_t status = 0;
+    for (int tries = 0; tries < 3; tries++) {
+        err = i2c_read(&bmp_dev, REG_STATUS, &status, 1);
+        if (err != ESP_OK) return err;
+        if (!(status & BMP280_STATUS_MEASURING)) break;
+        vTaskDelay(1);
+    }
+    if (status & BMP280_STATUS_MEASURING) return ESP_ERR_TIMEOUT;
+
     uint8_t d[6];
-    esp_err_t err = i2c_read(bmp_addr, REG_PRESS_MSB, d, sizeof(d));
+    err = i2c_read(&bmp_dev, REG_PRESS_MSB, d, sizeof(d));
     if (err != ESP_OK) return err;
 
     int32_t adc_P = (int32_t)((d[0] << 12) | (d[1] << 4) | (d[2] >> 4));
     int32_t adc_T = (int32_t)((d[3] << 12) | (d[4] << 4) | (d[5] >> 4));
 
-    int32_t t100 = bmp_comp_temp(adc_T);   // 0.01°C
-    uint32_t p256 = bmp_comp_press(adc_P); // Pa*256
-
-    double pa = (double)p256 / 256.0;
-    *temp_c = (float)(t100 / 100.0);
-    *press_hpa = (float)(pa / 100.0);
+    bmp280_comp(&bmp_comp, adc_T, adc_P, temp_c100, press_pa);
     return ESP_OK;
 }
 
@@ -269,6 +366,49 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base,
     }
 }
 
+// Publica la configuración efectiva (retenida) o el motivo de un rechazo
+static void cfg_publish_state(const char *error)
+{
+    char out[256];
+    if (error != NULL) {
+        snprintf(out, sizeof(out), "error: %s", error);
+    } else {
+        node_cfg_t c;
+        cfg_get(&c);
+        node_cfg_format(&c, out, sizeof(out));
+    }
+    esp_mqtt_client_publish(mqtt_client, g_cfg_state_topic, out, 0, 1, error == NULL);
+}
+
+// Aplica un mensaje del topic de configuración, lo guarda en NVS y avisa a
+// las tareas afectadas para que no esperen a su siguiente ciclo
+static void cfg_apply(const char *txt, size_t len)
+{
+    node_cfg_t c;
+    char err[80];
+    cfg_get(&c);
+
+    int changed = node_cfg_parse(&c, txt, len, err, sizeof(err));
+    if (changed < 0) {
+        ESP_LOGW(TAG, "Configuración rechazada: %s", err);
+        cfg_publish_state(err);
+        return;
+    }
+    if (changed > 0) {
+        taskENTER_CRITICAL(&g_cfg_mux);
+        g_cfg = c;
+        atomic_fetch_add(&g_cfg_version, 1);
+        taskEXIT_CRITICAL(&g_cfg_mux);
+
+        esp_err_t e = node_cfg_save(&c);
+        if (e != ESP_OK) ESP_LOGW(TAG, "No se pudo guardar la configuración en NVS: %s", esp_err_to_name(e));
+        if (g_bmp_task) xTaskNotifyGive(g_bmp_task);
+        if (g_publisher) xTaskNotifyGive(g_publisher);
+    }
+    ESP_LOGI(TAG, "Configuración: %d campos cambiados", changed);
+    cfg_publish_state(NULL);
+}
+
 static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data)
 {
     ESP_LOGD(TAG, "Event dispatching base=%s, event_id=%" PRId32, base, event_id);
@@ -277,10 +417,29 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
     case MQTT_EVENT_CONNECTED:
         ESP_LOGI(TAG, "MQTT Connected");
         mqtt_connected = true;
+        esp_mqtt_client_subscribe(mqtt_client, g_cfg_topic, 1);
+        cfg_publish_state(NULL);
+        if (g_publisher) xTaskNotifyGive(g_publisher);     // empieza el reenvío
         break;
     case MQTT_EVENT_DISCONNECTED:
         ESP_LOGI(TAG, "MQTT Disconnected");
         mqtt_connected = false;
+        atomic_store(&g_replay_msg_id, -1);     // el reenvío en curso se repetirá
+        break;
+    case MQTT_EVENT_PUBLISHED:
+        if (event->msg_id == atomic_load(&g_replay_msg_id)) {
+            atomic_store(&g_replay_acked, true);
+            if (g_publisher) xTaskNotifyGive(g_publisher);
+        }
+        break;
+    case MQTT_EVENT_DATA:
+        if (event->topic_len == (int)strlen(g_cfg_topic) && memcmp(event->topic, g_cfg_topic, event->topic_len) == 0) {
+            if (event->data_len != event->total_data_len) {
+                ESP_LOGW(TAG, "Configuración fragmentada (%d bytes): ignorada", event->total_data_len);
+                break;
+            }
+            cfg_apply(event->data, event->data_len);
+        }
         break;
     case MQTT_EVENT_ERROR:
         ESP_LOGI(TAG, "MQTT Error");
@@ -330,109 +489,446 @@ static void mqtt_app_start(void)
 // ===================== TASKS =====================
 static void bmp_task(void *arg)
 {
-    if (i2c_init_simple() != ESP_OK) {
+    if (i2c_bus_init(&i2c_bus, I2C_PORT, I2C_SDA, I2C_SCL, I2C_TIMEOUT_MS) != ESP_OK) {
         ESP_LOGE(TAG, "Error init I2C");
         vTaskDelete(NULL);
     }
 
-    if (bmp_init_detect() != ESP_OK) {
+    node_cfg_t cfg;
+    unsigned cfg_ver = cfg_get(&cfg);
+
+    if (bmp_init_detect((bmp280_profile_id_t)cfg.bmp_profile) != ESP_OK) {
         ESP_LOGE(TAG, "No se encontró BMP/BME280 en 0x76/0x77");
-        g_sensor_ok = 0;
         vTaskDelete(NULL);
     }
 
-    g_sensor_ok = 1;
+    int32_t band[2] = { cfg.db_temp_c100, cfg.db_press_pa };
+    deadband_t db;
+    deadband_init(&db, 2, band, cfg.max_silence_ms);
 
+    // Periodo fijo: la espera de la conversión forma parte del ciclo. Se
+    // espera con una notificación para aplicar un cambio de configuración
+    // sin aguardar al final de un periodo largo.
+    TickType_t next_wake = xTaskGetTickCount();
+    int64_t t_stats = esp_timer_get_time();
     while (1) {
-        float t, p;
-        if (bmp_read_tp(&t, &p) == ESP_OK) {
-            g_temp_c = t;
-            g_press_hpa = p;
+        node_cfg_t old = cfg;
+        if (cfg_refresh(&cfg, &cfg_ver)) {
+            if (cfg.bmp_profile != old.bmp_profile) bmp_set_profile((bmp280_profile_id_t)cfg.bmp_profile);
+            if (cfg.db_temp_c100 != old.db_temp_c100 || cfg.db_press_pa != old.db_press_pa ||
+                cfg.max_silence_ms != old.max_silence_ms) {
+                band[0] = cfg.db_temp_c100;
+                band[1] = cfg.db_press_pa;
+                deadband_init(&db, 2, band, cfg.max_silence_ms);
+            }
+            ESP_LOGI(TAG, "BMP: cada %" PRId32 " ms, canal %s", cfg.bmp_period_ms,
+                     (cfg.channels & NODE_CFG_CH_BMP) ? "activo" : "desactivado");
+        }
+
+        bmp_sample_t smp;
+        if ((cfg.channels & NODE_CFG_CH_BMP) && bmp_read_tp(&smp.temp_c100, &smp.press_pa) == ESP_OK) {
+            smp.t_ms = (uint32_t)(esp_timer_get_time() / 1000);
+            int32_t v[2] = { smp.temp_c100, (int32_t)smp.press_pa };
+            smp.publish = deadband_check(&db, v, smp.t_ms);
+            if (smp.publish == DEADBAND_HOLD) {
+                // sin cambios: no se despierta al publicador
+            } else if (xQueueSend(g_bmp_queue, &smp, 0) == pdTRUE) {
+                xTaskNotifyGive(g_publisher);
+            } else {
+                g_bmp_dropped++;
+            }
+        }
+
+        if (esp_timer_get_time() - t_stats >= GPS_STATS_PERIOD_MS * 1000LL) {
+            const i2c_bus_dev_stats_t *st = &bmp_dev.stats;
+            t_stats = esp_timer_get_time();
+            ESP_LOGI(TAG, "I2C %s: %" PRIu32 " transacciones, %" PRIu32 " errores, lat media %" PRIu32 " us (max %" PRIu32 ")",
+                     bmp_dev.name, st->transactions, st->errors, i2c_bus_lat_avg_us(st), st->lat_max_us);
+            ESP_LOGI(TAG, "BMP: %" PRIu32 " cambios, %" PRIu32 " latidos, %" PRIu32 " sin publicar",
+                     db.changed, db.silence, db.held);
+        }
+
+        next_wake += pdMS_TO_TICKS(cfg.bmp_period_ms);
+        TickType_t now = xTaskGetTickCount();
+        if ((int32_t)(next_wake - now) > 0) {
+            if (ulTaskNotifyTake(pdTRUE, next_wake - now) > 0) next_wake = xTaskGetTickCount();
+        } else {
+            next_wake = now;    // el ciclo se ha pasado del periodo: se recoloca
         }
-        vTaskDelay(pdMS_TO_TICKS(1000));
     }
 }
 
-// Tarea GPS: lee UART y guarda última línea NMEA
+// Tarea GPS: lee UART y encola cada fix decodificado (RMC o NAV-PVT)
 static void gps_uart_task(void *arg)
 {
     uint8_t rxbuf[256];
-    char line[256];
-    int idx = 0;
+    int64_t t_stats = esp_timer_get_time();
+    gps_fix_t fix;
+    node_cfg_t cfg;
+    unsigned cfg_ver = cfg_get(&cfg);
+    int32_t band[4] = { cfg.db_gps_e7, cfg.db_gps_e7, cfg.db_speed_mms, 0 };
+    deadband_t db;
+    deadband_init(&db, 4, band, cfg.max_silence_ms);
+#if GPS_UBX_MODE
+    ubx_parser_t parser;
+    ubx_nav_pvt_t pvt;
+    ubx_init(&parser);
+#else
+    nmea_parser_t parser;
+    nmea_msg_t msg;
+    nmea_init(&parser);
+#endif
 
     while (1) {
-        int n = uart_read_bytes(GPS_UART, rxbuf, sizeof(rxbuf), pdMS_TO_TICKS(200));
-        if (n <= 0) continue;
+        node_cfg_t old = cfg;
+        if (cfg_refresh(&cfg, &cfg_ver) &&
+            (cfg.db_gps_e7 != old.db_gps_e7 || cfg.db_speed_mms != old.db_speed_mms ||
+             cfg.max_silence_ms != old.max_silence_ms)) {
+            band[0] = band[1] = cfg.db_gps_e7;
+            band[2] = cfg.db_speed_mms;
+            deadband_init(&db, 4, band, cfg.max_silence_ms);
+        }
+
+        // Trama completa (o bloque UBX) en cuanto la UART la detecta
+        int n = gps_uart_read(&g_gps, rxbuf, sizeof(rxbuf), pdMS_TO_TICKS(GPS_STATS_PERIOD_MS));
 
         for (int i = 0; i < n; i++) {
-            char c = (char)rxbuf[i];
-
-            if (c == '\n' || c == '\r') {
-                if (idx > 0) {
-                    line[idx] = '\0';
-                    idx = 0;
-
-                    if (line[0] == '$') {
-                        portENTER_CRITICAL(&g_gps_mux);
-                        strncpy(g_last_nmea, line, sizeof(g_last_nmea) - 1);
-                        g_last_nmea[sizeof(g_last_nmea) - 1] = '\0';
-                        g_gps_updated = 1;
-                        portEXIT_CRITICAL(&g_gps_mux);
-                    }
-                }
-                continue;
+#if GPS_UBX_MODE
+            if (!ubx_feed(&parser, rxbuf[i]) || !ubx_decode_nav_pvt(&parser, &pvt)) continue;
+
+            fix.time_ms     = ((pvt.hour * 60u + pvt.min) * 60u + pvt.sec) * 1000u;
+            fix.lat_e7      = pvt.lat_e7;
+            fix.lon_e7      = pvt.lon_e7;
+            fix.speed_mms   = pvt.gspeed_mms > 0 ? (uint32_t)pvt.gspeed_mms : 0;
+            fix.course_cdeg = (uint16_t)(pvt.head_e5 / 1000);
+            fix.valid       = pvt.fix_ok && pvt.fix_type >= 2;
+#else
+            if (!nmea_feed(&parser, rxbuf[i], &msg)) continue;
+            if (msg.type != NMEA_RMC) continue;
+
+            fix.time_ms     = msg.rmc.time_ms;
+            fix.lat_e7      = msg.rmc.lat_e7;
+            fix.lon_e7      = msg.rmc.lon_e7;
+            fix.speed_mms   = msg.rmc.speed_mms;
+            fix.course_cdeg = msg.rmc.course_cdeg;
+            fix.valid       = msg.rmc.valid;
+#endif
+            fix.t_ms = (uint32_t)(esp_timer_get_time() / 1000);
+            int32_t v[4] = { fix.lat_e7, fix.lon_e7, (int32_t)fix.speed_mms, fix.valid };
+            fix.publish = (cfg.channels & NODE_CFG_CH_GPS) ? deadband_check(&db, v, fix.t_ms) : DEADBAND_HOLD;
+
+            // Todos los fixes van a la cola (el recorrido los necesita), pero
+            // sólo se despierta al publicador por un cambio, un latido o si
+            // la cola va por la mitad
+            if (gps_ring_push(&g_gps_ring, &fix) &&
+                (fix.publish != DEADBAND_HOLD || gps_ring_count(&g_gps_ring) >= GPS_RING_SIZE / 2)) {
+                xTaskNotifyGive(g_publisher);
             }
+        }
+
+        if (esp_timer_get_time() - t_stats >= GPS_STATS_PERIOD_MS * 1000LL) {
+            const gps_uart_stats_t *st = &g_gps.stats;
+            t_stats = esp_timer_get_time();
+            ESP_LOGI(TAG, "UART GPS: %" PRIu32 " tramas, lat media %" PRIu32 " us (max %" PRIu32 "), ovf fifo=%" PRIu32
+                     " buf=%" PRIu32 " patron=%" PRIu32 " linea=%" PRIu32,
+                     st->sentences, gps_uart_lat_avg_us(st), st->lat_max_us,
+                     st->fifo_ovf, st->buffer_full, st->pattern_ovf, st->line_ovf);
+            ESP_LOGI(TAG, "GPS: %" PRIu32 " cambios, %" PRIu32 " latidos, %" PRIu32 " sin publicar",
+                     db.changed, db.silence, db.held);
+        }
+    }
+}
+
+// Publica el segmento de recorrido en curso como un único mensaje binario
+static void track_publish(track_seg_t *t)
+{
+    if (t->npoints == 0) return;
+
+    uint16_t len = track_close(t);
+    int msg_id = esp_mqtt_client_publish(mqtt_client, MQTT_TOPIC_TRACK, (const char *)t->data, len, 1, 0);
+    ESP_LOGI(TAG, "Segmento publicado, msg_id=%d: %u puntos (%" PRIu32 " descartados), %u bytes (%u en crudo)",
+             msg_id, t->npoints, t->skipped, len, t->npoints * 12u);
+    track_reset(t);
+}
 
-            if (idx < (int)sizeof(line) - 1) {
-                line[idx++] = c;
+// Formato antiguo, para PAYLOAD_BINARY 0 y como referencia del benchmark
+static int payload_json(const sensor_msg_t *m, char *out, size_t size)
+{
+    // lat/lon en 1e-7 grados, velocidad en mm/s, rumbo en 0.01 grados
+    int len;
+    if (m->flags & SENSOR_MSG_F_SENSOR) {
+        len = snprintf(out, size, "{\"temp\": %.2f, \"press\": %.2f",
+                       m->temp_c100 / 100.0, m->press_pa / 100.0);
+    } else {
+        len = snprintf(out, size, "{\"temp\": null, \"press\": null");
+    }
+    len += snprintf(out + len, size - len,
+                    ", \"lat\": %" PRId32 ", \"lon\": %" PRId32 ", \"spd\": %" PRIu32 ", \"crs\": %u, \"fix\": %d, \"n\": %d}",
+                    m->lat_e7, m->lon_e7, m->speed_mms, m->course_cdeg, (m->flags & SENSOR_MSG_F_FIX) != 0, m->nfix);
+    return len;
+}
+
+#if PAYLOAD_BENCH
+// Bytes y ciclos de CPU por muestra: JSON (una muestra por mensaje) frente al
+// lote v3 que publica batch_flush, lleno con BATCH_MAX_SAMPLES muestras
+// típicas (dos fixes por cada lectura del BMP) y sellado como al enviarlo
+static void payload_bench(void)
+{
+    sensor_msg_t m = {
+        .flags = SENSOR_MSG_F_SENSOR | SENSOR_MSG_F_FIX,
+        .temp_c100 = 2345, .press_pa = 101325,
+        .lat_e7 = 404167754, .lon_e7 = -37037902,
+        .speed_mms = 1389, .course_cdeg = 27015, .nfix = 1,
+    };
+    static sensor_batch_t b;
+    char json[512];
+    int json_len = 0;
+    size_t batch_len = 0;
+
+    uint32_t c0 = esp_cpu_get_cycle_count();
+    for (int i = 0; i < PAYLOAD_BENCH_N; i++) {
+        m.seq = (uint16_t)i;
+        json_len = payload_json(&m, json, sizeof(json));
+    }
+    uint32_t c1 = esp_cpu_get_cycle_count();
+    for (int i = 0; i < PAYLOAD_BENCH_N; i++) {
+        uint32_t t = 1000;
+        sensor_batch_reset(&b);
+        for (int k = 0; k < BATCH_MAX_SAMPLES; k++, t += 100) {
+            if (k % 3 == 2) {
+                sensor_batch_add_bmp(&b, t, m.temp_c100, m.press_pa + k);
             } else {
-                idx = 0;
+                sensor_batch_add_gps(&b, t, m.lat_e7 + k * 50, m.lon_e7 - k * 30, m.speed_mms, m.course_cdeg, true);
             }
         }
+        batch_len = sensor_batch_finish(&b, (uint16_t)i);
+        sensor_batch_stamp(b.buf, batch_len, t, 0);
+    }
+    uint32_t c2 = esp_cpu_get_cycle_count();
+
+    uint32_t batch_cyc = (c2 - c1) / PAYLOAD_BENCH_N;
+    ESP_LOGI(TAG, "Payload JSON: %d bytes, %" PRIu32 " ciclos por muestra (un mensaje cada una)",
+             json_len, (c1 - c0) / PAYLOAD_BENCH_N);
+    ESP_LOGI(TAG, "Payload lote v3: %u muestras en %u bytes (%u por muestra), %" PRIu32 " ciclos (%" PRIu32 " por muestra)",
+             b.n, (unsigned)batch_len, (unsigned)(batch_len / b.n), batch_cyc, batch_cyc / b.n);
+}
+#endif
+
+typedef struct {
+    sensor_batch_t batch;
+    sensor_msg_t   last;        // último valor de cada sensor (JSON y log)
+    uint16_t       seq;
+    uint32_t       messages;
+    uint32_t       samples;
+    uint32_t       lost;        // muestras de lotes que no se pudieron publicar ni guardar
+
+    flog_t         store;
+    bool           store_ok;
+    uint32_t       stored;      // mensajes guardados en flash
+    uint32_t       replayed;
+    int64_t        t_replay;    // último reenvío (µs)
+
+    node_cfg_t     cfg;         // copia de g_cfg
+    unsigned       cfg_ver;
+} publisher_t;
+
+static publisher_t g_pub;
+
+// Hora Unix en ms, o 0 si SNTP aún no la ha fijado
+static uint64_t wall_clock_ms(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    if (tv.tv_sec < 1600000000) return 0;
+    return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+static void store_message(publisher_t *p, const uint8_t *data, size_t len, uint8_t nsamples)
+{
+    if (p->store_ok && flog_append(&p->store, data, len) == FLOG_OK) {
+        p->stored++;
+        ESP_LOGW(TAG, "MQTT no disponible: mensaje de %u bytes guardado en flash (%" PRIu32 " pendientes)",
+                 (unsigned)len, p->store.pending);
+        return;
     }
+    p->lost += nsamples;
+    ESP_LOGW(TAG, "MQTT no disponible: lote de %u muestras descartado (%" PRIu32 " en total)", nsamples, p->lost);
 }
 
-// Tarea: Publica en MQTT cada 2 segundos
-static void publisher_task(void *arg)
+static void batch_flush(publisher_t *p)
 {
-    char local_nmea[256];
+    sensor_batch_t *b = &p->batch;
+    if (b->n == 0) return;
+
+#if PAYLOAD_BINARY
+    const uint8_t *data = b->buf;
+    size_t len = sensor_batch_finish(b, p->seq);
+#else
+    // JSON: sólo el último valor de cada sensor
     char payload[512];
+    p->last.seq = p->seq;
+    const uint8_t *data = (const uint8_t *)payload;
+    size_t len = payload_json(&p->last, payload, sizeof(payload));
+#endif
+
+    int msg_id = -1;
+    if (mqtt_connected) {
+#if PAYLOAD_BINARY
+        sensor_batch_stamp(b->buf, len, (uint32_t)(esp_timer_get_time() / 1000), wall_clock_ms());
+#endif
+        msg_id = esp_mqtt_client_publish(mqtt_client, MQTT_TOPIC, (const char *)data, len, p->cfg.qos, 0);
+    }
+    if (msg_id < 0) {
+        store_message(p, data, len, b->n);
+    } else {
+        ESP_LOGI(TAG, "Lote publicado, msg_id=%d, seq=%u: %u muestras, %u bytes", msg_id, p->seq, b->n, (unsigned)len);
+        p->messages++;
+        p->samples += b->n;
+    }
+    p->seq++;
+    p->last.nfix = 0;
+    sensor_batch_reset(b);
+}
 
-    while (1) {
-        if (!mqtt_connected) {
-             vTaskDelay(pdMS_TO_TICKS(2000));
-             continue;
-        }
+// Reenvía el mensaje guardado más antiguo, a ritmo limitado y de uno en uno
+static void store_replay(publisher_t *p)
+{
+    if (atomic_exchange(&g_replay_acked, false)) {
+        // FLOG_STALE: el registro se pisó al rotar mientras esperaba el PUBACK
+        if (flog_ack(&p->store) == FLOG_OK) p->replayed++;
+        atomic_store(&g_replay_msg_id, -1);
+        if (p->store.pending == 0) ESP_LOGI(TAG, "Reenvío completado: %" PRIu32 " mensajes", p->replayed);
+    }
+    if (!mqtt_connected || p->store.pending == 0) return;
 
-        int had_new = 0;
+    int64_t since = esp_timer_get_time() - p->t_replay;
+    if (atomic_load(&g_replay_msg_id) >= 0 && since < STORE_REPLAY_TIMEOUT_MS * 1000LL) return;
+    if (since < STORE_REPLAY_INTERVAL_MS * 1000LL) return;
 
-        portENTER_CRITICAL(&g_gps_mux);
-        had_new = g_gps_updated;
-        if (had_new) {
-            strncpy(local_nmea, g_last_nmea, sizeof(local_nmea) - 1);
-            local_nmea[sizeof(local_nmea) - 1] = '\0';
-        } else {
-             strcpy(local_nmea, "-");
+    static uint8_t buf[FLOG_MAX_REC];
+    size_t len;
+    if (flog_peek(&p->store, buf, sizeof(buf), &len) != FLOG_OK) return;
+
+    p->t_replay = esp_timer_get_time();
+    sensor_batch_stamp(buf, len, (uint32_t)(p->t_replay / 1000), wall_clock_ms());
+    int msg_id = esp_mqtt_client_publish(mqtt_client, MQTT_TOPIC, (const char *)buf, len, 1, 0);
+    if (msg_id > 0) atomic_store(&g_replay_msg_id, msg_id);
+}
+
+static void batch_add_gps(publisher_t *p, const gps_fix_t *fix)
+{
+    if (!sensor_batch_add_gps(&p->batch, fix->t_ms, fix->lat_e7, fix->lon_e7, fix->speed_mms, fix->course_cdeg,
+                              fix->valid)) {
+        batch_flush(p);
+        sensor_batch_add_gps(&p->batch, fix->t_ms, fix->lat_e7, fix->lon_e7, fix->speed_mms, fix->course_cdeg,
+                             fix->valid);
+    }
+    sensor_msg_t *m = &p->last;
+    m->flags = (m->flags & ~SENSOR_MSG_F_FIX) | (fix->valid ? SENSOR_MSG_F_FIX : 0);
+    m->lat_e7 = fix->lat_e7;
+    m->lon_e7 = fix->lon_e7;
+    m->speed_mms = fix->speed_mms;
+    m->course_cdeg = fix->course_cdeg;
+    if (m->nfix < UINT8_MAX) m->nfix++;
+}
+
+static void batch_add_bmp(publisher_t *p, const bmp_sample_t *smp)
+{
+    if (!sensor_batch_add_bmp(&p->batch, smp->t_ms, (int16_t)smp->temp_c100, smp->press_pa)) {
+        batch_flush(p);
+        sensor_batch_add_bmp(&p->batch, smp->t_ms, (int16_t)smp->temp_c100, smp->press_pa);
+    }
+    p->last.flags |= SENSOR_MSG_F_SENSOR;
+    p->last.temp_c100 = (int16_t)smp->temp_c100;
+    p->last.press_pa = smp->press_pa;
+}
+
+// Tarea: agrupa en un lote (sensor_batch) los fixes y las muestras del BMP
+// que pasan la banda muerta y lo publica al llenarse (batch_max_samples), al
+// cumplirse su plazo (batch_max_latency_ms) o cuando un canal en reposo
+// empieza a cambiar (DEADBAND_ONSET).
+// Sin broker el lote se guarda en flash y, al volver la conexión, se
+// reenvía de uno en uno (store_replay) hasta vaciar el registro. Los fixes
+// válidos alimentan además el segmento de recorrido comprimido.
+static void publisher_task(void *arg)
+{
+    publisher_t *p = &g_pub;
+    int64_t t_stats = esp_timer_get_time();
+
+    p->batch.node_id = g_node_id;
+    p->cfg_ver = cfg_get(&p->cfg);
+    track_init(&g_track, TRACK_DEADBAND_M);
+
+    esp_err_t err = flog_mount_partition(&p->store, STORE_PARTITION);
+    p->store_ok = err == ESP_OK;
+    if (p->store_ok) {
+        ESP_LOGI(TAG, "Store-and-forward: %" PRIu32 " sectores, %" PRIu32 " mensajes pendientes",
+                 p->store.nsect, p->store.pending);
+    } else {
+        ESP_LOGW(TAG, "Sin partición '%s' (%s): sin broker se perderán los datos", STORE_PARTITION, esp_err_to_name(err));
+    }
+
+#if PAYLOAD_BENCH
+    payload_bench();
+#endif
+
+    while (1) {
+        cfg_refresh(&p->cfg, &p->cfg_ver);
+
+        // Duerme hasta la siguiente muestra o hasta el plazo del lote en curso
+        TickType_t wait = portMAX_DELAY;
+        if (p->batch.n > 0) {
+            int32_t left = p->cfg.batch_max_latency_ms - (int32_t)((uint32_t)(esp_timer_get_time() / 1000) - p->batch.t0_ms);
+            wait = left > 0 ? pdMS_TO_TICKS(left) + 1 : 0;
         }
-        g_gps_updated = 0; // reset
-        portEXIT_CRITICAL(&g_gps_mux);
-
-        // Construir JSON
-        if (g_sensor_ok) {
-            snprintf(payload, sizeof(payload), 
-                "{\"temp\": %.2f, \"press\": %.2f, \"gps\": \"%s\"}",
-                g_temp_c, g_press_hpa, local_nmea);
-        } else {
-             snprintf(payload, sizeof(payload), 
-                "{\"temp\": null, \"press\": null, \"gps\": \"%s\"}",
-                local_nmea);
+        if (p->store.pending > 0 && mqtt_connected && wait > pdMS_TO_TICKS(STORE_REPLAY_INTERVAL_MS)) {
+            wait = pdMS_TO_TICKS(STORE_REPLAY_INTERVAL_MS);
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+
+        bool onset = false;
+        gps_fix_t fix;
+        while (gps_ring_pop(&g_gps_ring, &fix)) {
+            if (fix.publish != DEADBAND_HOLD) batch_add_gps(p, &fix);
+            if (fix.publish == DEADBAND_ONSET) onset = true;
+            if (!fix.valid) {
+                track_publish(&g_track);    // sin fix: se cierra el segmento
+                continue;
+            }
+            if (g_track.npoints > 0 &&
+                (fix.time_ms < g_track.t0 || fix.time_ms - g_track.t0 >= TRACK_SEG_MAX_MS)) {
+                track_publish(&g_track);
+            }
+            if (!track_add(&g_track, fix.time_ms, fix.lat_e7, fix.lon_e7)) {
+                track_publish(&g_track);
+                track_add(&g_track, fix.time_ms, fix.lat_e7, fix.lon_e7);
+            }
         }
 
-        // Publicar
-        int msg_id = esp_mqtt_client_publish(mqtt_client, MQTT_TOPIC, payload, 0, 1, 0);
-        ESP_LOGI(TAG, "Sent publish successful, msg_id=%d, payload=%s", msg_id, payload);
+        bmp_sample_t smp;
+        while (xQueueReceive(g_bmp_queue, &smp, 0) == pdTRUE) {
+            batch_add_bmp(p, &smp);
+            if (smp.publish == DEADBAND_ONSET) onset = true;
+        }
 
-        vTaskDelay(pdMS_TO_TICKS(2000));
+        uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+        if (onset || p->batch.n >= p->cfg.batch_max_samples ||
+            (p->batch.n > 0 && now_ms - p->batch.t0_ms >= (uint32_t)p->cfg.batch_max_latency_ms)) {
+            batch_flush(p);
+        }
+        store_replay(p);
+
+        if (esp_timer_get_time() - t_stats >= GPS_STATS_PERIOD_MS * 1000LL) {
+            t_stats = esp_timer_get_time();
+            ESP_LOGI(TAG, "Publicador: %" PRIu32 " mensajes, %" PRIu32 " muestras, %" PRIu32 " perdidas; "
+                     "descartes en cola GPS=%" PRIu32 " BMP=%" PRIu32,
+                     p->messages, p->samples, p->lost, g_gps_ring.dropped, g_bmp_dropped);
+            if (p->store_ok) {
+                ESP_LOGI(TAG, "Flash: %" PRIu32 " guardados, %" PRIu32 " reenviados, %" PRIu32 " pendientes, "
+                         "%" PRIu32 " pisados, %" PRIu32 " borrados de sector",
+                         p->stored, p->replayed, p->store.pending, p->store.dropped, p->store.erases);
+            }
+        }
     }
 }
 
@@ -446,9 +942,40 @@ void app_main(void)
     }
     ESP_ERROR_CHECK(ret);
 
+    // Configuración: valores de fábrica, sobrescritos por los guardados en NVS
+    g_cfg = (node_cfg_t){
+        .bmp_period_ms = BMP_PERIOD_MS,
+        .bmp_profile = BMP_PROFILE,
+        .batch_max_samples = BATCH_MAX_SAMPLES,
+        .batch_max_latency_ms = BATCH_MAX_LATENCY_MS,
+        .max_silence_ms = DB_MAX_SILENCE_MS,
+        .db_temp_c100 = DB_TEMP_C100,
+        .db_press_pa = DB_PRESS_PA,
+        .db_gps_e7 = DB_GPS_E7,
+        .db_speed_mms = DB_SPEED_MMS,
+        .channels = NODE_CFG_CH_ALL,
+        .qos = MQTT_QOS,
+    };
+    bool cfg_saved = node_cfg_load(&g_cfg) == ESP_OK;
+
+    // Id del nodo (lotes y topic de configuración): los 4 últimos bytes de la MAC
+    uint8_t mac[6];
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    g_node_id = ((uint32_t)mac[2] << 24) | ((uint32_t)mac[3] << 16) | ((uint32_t)mac[4] << 8) | mac[5];
+    snprintf(g_cfg_topic, sizeof(g_cfg_topic), MQTT_TOPIC_CFG "%08" PRIx32, g_node_id);
+    snprintf(g_cfg_state_topic, sizeof(g_cfg_state_topic), "%s/estado", g_cfg_topic);
+
+    char cfg_txt[256];
+    node_cfg_format(&g_cfg, cfg_txt, sizeof(cfg_txt));
+    ESP_LOGI(TAG, "Configuración (%s), topic %s: %s", cfg_saved ? "NVS" : "fábrica", g_cfg_topic, cfg_txt);
+
     // WiFi Init
     wifi_init_sta();
 
+    // SNTP: la hora se fija en cuanto haya IP; hasta entonces los lotes van sin hora
+    esp_sntp_config_t sntp_cfg = ESP_NETIF_SNTP_DEFAULT_CONFIG(SNTP_SERVER);
+    esp_netif_sntp_init(&sntp_cfg);
+
     // MQTT Init
     mqtt_app_start();
 
@@ -462,14 +989,19 @@ void app_main(void)
         .source_clk = UART_SCLK_DEFAULT,
     };
 
-    ESP_ERROR_CHECK(uart_driver_install(GPS_UART, 2048, 0, 0, NULL, 0));
-    ESP_ERROR_CHECK(uart_param_config(GPS_UART, &uart_config));
-    ESP_ERROR_CHECK(uart_set_pin(GPS_UART, GPS_TXD, GPS_RXD, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE));
+    ESP_ERROR_CHECK(gps_uart_install(&g_gps, GPS_UART, &uart_config, GPS_TXD, GPS_RXD, 2048, GPS_UBX_MODE));
 
+#if GPS_UBX_MODE
+    ubx_neo7_configure(GPS_UART, GPS_UBX_BAUD, GPS_UBX_RATE_HZ);
+    ESP_LOGI(TAG, "UART GPS listo. RX=%d TX=%d BAUD=%d (UBX NAV-PVT %d Hz)", GPS_RXD, GPS_TXD, GPS_UBX_BAUD, GPS_UBX_RATE_HZ);
+#else
     ESP_LOGI(TAG, "UART GPS listo. RX=%d TX=%d BAUD=%d", GPS_RXD, GPS_TXD, GPS_BAUD);
+#endif
     ESP_LOGI(TAG, "I2C SDA=%d SCL=%d (BMP/BME 0x76/0x77)", I2C_SDA, I2C_SCL);
 
-    xTaskCreate(bmp_task,       "bmp_task",       4096, NULL, 5, NULL);
+    // El publicador se crea primero: los productores le notifican cada muestra
+    g_bmp_queue = xQueueCreate(BMP_QUEUE_LEN, sizeof(bmp_sample_t));
+    xTaskCreate(publisher_task, "publisher_task", 4096, NULL, 4, &g_publisher);
+    xTaskCreate(bmp_task,       "bmp_task",       4096, NULL, 5, &g_bmp_task);
     xTaskCreate(gps_uart_task,  "gps_uart_task",  4096, NULL, 6, NULL);
-    xTaskCreate(publisher_task, "publisher_task", 4096, NULL, 4, NULL);
 }
\ No newline at end of file
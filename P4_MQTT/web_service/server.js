@@ -9,15 +9,335 @@ const io = socketIo(server);
 
 app.use(express.static('public'));
 
+// Percentiles de latencia por nodo y etapa
+app.get('/latencias', (req, res) => {
+    const out = {};
+    for (const [node, stages] of latency) {
+        out[node] = {};
+        for (const [stage, h] of stages) out[node][stage] = h.summary();
+    }
+    res.json(out);
+});
+
+// El navegador confirma cuándo ha pintado cada datos_sensor
+io.on('connection', (socket) => {
+    socket.on('pintado', (t) => {
+        if (!t || typeof t.node !== 'string') return;
+        recordLatency(t.node, 'navegador', t.tRender - t.tEmit);
+        if (t.tAcq) recordLatency(t.node, 'total', t.tRender - t.tAcq);
+    });
+});
+
+// Decodifica un segmento de recorrido comprimido de la ESP32:
+// cabecera (versión, nº puntos, t0, lat0, lon0) + deltas zigzag/varint
+function decodeTrackSegment(buf) {
+    let off = 0;
+    const version = buf.readUInt8(off); off += 1;
+    if (version !== 1) throw new Error(`Versión de segmento desconocida: ${version}`);
+    const n = buf.readUInt16LE(off); off += 2;
+    let t = buf.readUInt32LE(off); off += 4;
+    let lat = buf.readInt32LE(off); off += 4;
+    let lon = buf.readInt32LE(off); off += 4;
+
+    // Los deltas pueden superar 32 bits: se usa aritmética en coma flotante, no desplazamientos
+    const varint = () => {
+        let v = 0, mul = 1, b;
+        do {
+            b = buf[off++];
+            v += (b & 0x7f) * mul;
+            mul *= 128;
+        } while (b & 0x80);
+        return v;
+    };
+    const unzigzag = v => (v % 2 ? -(v + 1) / 2 : v / 2);
+
+    const points = [[lat / 1e7, lon / 1e7, t]];
+    for (let i = 1; i < n; i++) {
+        t += unzigzag(varint());
+        lat += unzigzag(varint());
+        lon += unzigzag(varint());
+        points.push([lat / 1e7, lon / 1e7, t]);
+    }
+    return points;
+}
+
+// Decodifica el mensaje binario de sensores (common/sensor_msg.h, 29 bytes LE)
+// y devuelve el mismo objeto que producía el JSON antiguo
+const SENSOR_MSG_VERSION = 1;
+const SENSOR_MSG_LEN = 29;
+const SENSOR_MSG_F_SENSOR = 0x01;
+const SENSOR_MSG_F_FIX = 0x02;
+
+function decodeSensorMsg(buf) {
+    if (buf.length < SENSOR_MSG_LEN) throw new Error(`Mensaje demasiado corto: ${buf.length} bytes`);
+    const version = buf.readUInt8(0);
+    if (version !== SENSOR_MSG_VERSION) throw new Error(`Versión de mensaje desconocida: ${version}`);
+    const flags = buf.readUInt8(1);
+    const sensor = (flags & SENSOR_MSG_F_SENSOR) !== 0;
+    return {
+        temp: sensor ? buf.readInt16LE(8) / 100 : null,
+        press: sensor ? buf.readUInt32LE(10) / 100 : null,
+        lat: buf.readInt32LE(14),
+        lon: buf.readInt32LE(18),
+        spd: buf.readUInt32LE(22),
+        crs: buf.readUInt16LE(26),
+        fix: (flags & SENSOR_MSG_F_FIX) ? 1 : 0,
+        n: buf.readUInt8(28),
+        seq: buf.readUInt16LE(2),
+        t: buf.readUInt32LE(4),
+    };
+}
+
+// Lote de muestras: cabecera (8 bytes en la versión 2; 24 en la 3, con
+// marcas de publicación e id del nodo) y registros con dt en ms
+const SENSOR_BATCH_V2 = 2;
+const SENSOR_BATCH_V3 = 3;
+const SENSOR_REC_BMP = 1;
+const SENSOR_REC_GPS = 2;
+
+const isSensorBatch = buf => buf.length > 0 && (buf[0] === SENSOR_BATCH_V2 || buf[0] === SENSOR_BATCH_V3);
+
+function decodeSensorBatch(buf) {
+    let off = 0;
+    const version = buf.readUInt8(off); off += 1;
+    if (version !== SENSOR_BATCH_V2 && version !== SENSOR_BATCH_V3) {
+        throw new Error(`Versión de lote desconocida: ${version}`);
+    }
+    const n = buf.readUInt8(off); off += 1;
+    const seq = buf.readUInt16LE(off); off += 2;
+    const t0 = buf.readUInt32LE(off); off += 4;
+    // Sin SNTP la hora de publicación llega a 0
+    let tPub = null, pubEpoch = null, node = null;
+    if (version === SENSOR_BATCH_V3) {
+        tPub = buf.readUInt32LE(off); off += 4;
+        pubEpoch = Number(buf.readBigUInt64LE(off)) || null; off += 8;
+        node = buf.readUInt32LE(off).toString(16).padStart(8, '0'); off += 4;
+    }
+
+    const samples = [];
+    for (let i = 0; i < n; i++) {
+        const type = buf.readUInt8(off); off += 1;
+        const t = t0 + buf.readInt16LE(off); off += 2;
+        if (type === SENSOR_REC_BMP) {
+            samples.push({ type: 'bmp', t, temp: buf.readInt16LE(off) / 100, press: buf.readUInt32LE(off + 2) / 100 });
+            off += 6;
+        } else if (type === SENSOR_REC_GPS) {
+            samples.push({
+                type: 'gps', t,
+                lat: buf.readInt32LE(off), lon: buf.readInt32LE(off + 4),
+                spd: buf.readUInt32LE(off + 8), crs: buf.readUInt16LE(off + 12), fix: buf.readUInt8(off + 14),
+            });
+            off += 15;
+        } else {
+            throw new Error(`Tipo de registro desconocido: ${type}`);
+        }
+    }
+    return { seq, t0, tPub, pubEpoch, node, samples };
+}
+
+// Resume un lote en el objeto datos_sensor de siempre (último valor de cada
+// sensor). Con publicación por cambios un lote puede traer un solo sensor:
+// el resto se conserva del lote anterior del mismo nodo.
+const lastSnapshot = new Map();
+
+function batchSnapshot(node, samples) {
+    const prev = lastSnapshot.get(node) || { temp: null, press: null, lat: 0, lon: 0, spd: 0, crs: 0, fix: 0 };
+    const datos = { ...prev, n: 0 };
+    for (const s of samples) {
+        if (s.type === 'bmp') {
+            datos.temp = s.temp;
+            datos.press = s.press;
+        } else {
+            Object.assign(datos, { lat: s.lat, lon: s.lon, spd: s.spd, crs: s.crs, fix: s.fix });
+            datos.n++;
+        }
+    }
+    lastSnapshot.set(node, datos);
+    return datos;
+}
+
+// ===================== Trazas de latencia =====================
+// Etapas (ms), por nodo:
+//   adquisicion  lectura del sensor -> publicación (reloj del nodo, exacto)
+//   red          publicación -> recepción en el servidor (incluye el broker;
+//                necesita SNTP en el nodo y el servidor en hora)
+//   servidor     recepción -> emit de socket.io (decodificación)
+//   navegador    emit -> marcador pintado (reloj del navegador; misma máquina)
+//   total        lectura de la muestra más reciente -> marcador pintado
+// Cada etapa es un histograma logarítmico de 4 cubetas por octava desde
+// 0.1 ms: memoria fija y percentiles con un error < 19 %.
+const LAT_BUCKETS = 96;
+const LAT_MIN_MS = 0.1;
+
+class LatencyHistogram {
+    constructor() {
+        this.buckets = new Array(LAT_BUCKETS).fill(0);
+        this.count = 0;
+        this.max = 0;
+        this.negative = 0;      // relojes desajustados
+    }
+
+    add(ms) {
+        if (!Number.isFinite(ms)) return;
+        if (ms < 0) {
+            this.negative++;
+            return;
+        }
+        const i = ms < LAT_MIN_MS ? 0 : Math.min(LAT_BUCKETS - 1, Math.floor(4 * Math.log2(ms / LAT_MIN_MS)));
+        this.buckets[i]++;
+        this.count++;
+        if (ms > this.max) this.max = ms;
+    }
+
+    // Borde superior de la cubeta que contiene el percentil q
+    percentile(q) {
+        if (this.count === 0) return null;
+        let acc = 0;
+        const target = q * this.count;
+        for (let i = 0; i < LAT_BUCKETS; i++) {
+            acc += this.buckets[i];
+            if (acc >= target) return Math.min(this.max, LAT_MIN_MS * Math.pow(2, (i + 1) / 4));
+        }
+        return this.max;
+    }
+
+    summary() {
+        const r = v => (v === null ? null : Math.round(v * 10) / 10);
+        return { n: this.count, p50: r(this.percentile(0.5)), p99: r(this.percentile(0.99)), max: r(this.max),
+                 negativos: this.negative };
+    }
+}
+
+const latency = new Map();      // nodo -> etapa -> LatencyHistogram
+
+function recordLatency(node, stage, ms) {
+    if (!latency.has(node)) latency.set(node, new Map());
+    const stages = latency.get(node);
+    if (!stages.has(stage)) stages.set(stage, new LatencyHistogram());
+    stages.get(stage).add(ms);
+}
+
+// Registra las etapas del lado del nodo y devuelve la traza que viaja con
+// datos_sensor hasta el navegador
+function traceBatch(batch, rxEpoch) {
+    const node = batch.node || 'desconocido';
+    let tAcq = null;
+    if (batch.tPub !== null) {
+        for (const s of batch.samples) recordLatency(node, 'adquisicion', batch.tPub - s.t);
+        if (batch.pubEpoch !== null) {
+            recordLatency(node, 'red', rxEpoch - batch.pubEpoch);
+            const newest = Math.max(...batch.samples.map(s => s.t));
+            tAcq = batch.pubEpoch - (batch.tPub - newest);
+        }
+    }
+    return { node, seq: batch.seq, tAcq };
+}
+
+// El JSON siempre empieza por '{'; el binario, por su versión
+const isJsonPayload = buf => buf.length > 0 && buf[0] === 0x7b;
+
+// PAYLOAD_BENCH=1 node server.js: coste de decodificar un lote v3 como los
+// que publica batch_flush (24 muestras, dos fixes por cada lectura del BMP)
+// frente a las mismas muestras en JSON, un mensaje por muestra
+if (process.env.PAYLOAD_BENCH) {
+    const N = 20000;
+    const NS = 24;
+    const batch = Buffer.alloc(24 + NS * 18);
+    const json = [];
+    let off = 24, t = 1000, temp = 2345, press = 101325, lat = 404167754, lon = -37037902;
+    batch.writeUInt8(SENSOR_BATCH_V3, 0);
+    batch.writeUInt8(NS, 1);
+    batch.writeUInt16LE(7, 2);
+    batch.writeUInt32LE(t, 4);
+    batch.writeUInt32LE(t + NS * 100, 8);
+    batch.writeBigUInt64LE(BigInt(Date.now()), 12);
+    batch.writeUInt32LE(0x1a2b3c4d, 20);
+    for (let k = 0; k < NS; k++) {
+        const bmp = k % 3 === 2;
+        batch.writeUInt8(bmp ? SENSOR_REC_BMP : SENSOR_REC_GPS, off);
+        batch.writeInt16LE(k * 100, off + 1);
+        if (bmp) {
+            press = 101325 + k;
+            batch.writeInt16LE(temp, off + 3);
+            batch.writeUInt32LE(press, off + 5);
+            off += 9;
+        } else {
+            lat = 404167754 + k * 50;
+            lon = -37037902 - k * 30;
+            batch.writeInt32LE(lat, off + 3);
+            batch.writeInt32LE(lon, off + 7);
+            batch.writeUInt32LE(1389, off + 11);
+            batch.writeUInt16LE(27015, off + 15);
+            batch.writeUInt8(1, off + 17);
+            off += 18;
+        }
+        json.push(Buffer.from(JSON.stringify({ temp: temp / 100, press: press / 100, lat, lon,
+                                               spd: 1389, crs: 27015, fix: 1, n: 1 })));
+    }
+    const bin = batch.subarray(0, off);
+    if (decodeSensorBatch(bin).samples.length !== NS) throw new Error('Lote de prueba mal formado');
+
+    const bench = (name, msgs, fn) => {
+        const bytes = msgs.reduce((acc, m) => acc + m.length, 0);
+        const t0 = process.hrtime.bigint();
+        for (let i = 0; i < N; i++) for (const m of msgs) fn(m);
+        const ns = Number(process.hrtime.bigint() - t0) / (N * NS);
+        console.log(`${name}: ${msgs.length} mensajes, ${bytes} bytes (${(bytes / NS).toFixed(1)} por muestra), ` +
+                    `${ns.toFixed(0)} ns/muestra`);
+    };
+    bench('JSON', json, b => JSON.parse(b.toString()));
+    bench('Lote v3', [bin], decodeSensorBatch);
+}
+
 // Conexión al Broker MQTT
 const mqttClient = mqtt.connect('mqtt://localhost:1883');
 
 mqttClient.on('connect', () => {
     console.log('Node.js conectado a MQTT');
     mqttClient.subscribe('test/gps'); // Suscribirse al tópico nuevo
+    mqttClient.subscribe('test/gps/track'); // Segmentos de recorrido (binario)
 });
 
 mqttClient.on('message', (topic, message) => {
+    if (topic === 'test/gps/track') {
+        try {
+            const points = decodeTrackSegment(message);
+            console.log(`Segmento de recorrido: ${points.length} puntos, ${message.length} bytes`);
+            io.emit('recorrido', points);
+        } catch (e) {
+            console.error("Error al decodificar el segmento de recorrido:", e);
+        }
+        return;
+    }
+
+    if (isSensorBatch(message)) {
+        const rxEpoch = Date.now();
+        const rxHr = process.hrtime.bigint();
+        try {
+            const batch = decodeSensorBatch(message);
+            const trace = traceBatch(batch, rxEpoch);
+            const datos = batchSnapshot(trace.node, batch.samples);
+            console.log(`Lote #${batch.seq} de ${trace.node}: ${batch.samples.length} muestras, ${message.length} bytes: ` +
+                        JSON.stringify(datos));
+            recordLatency(trace.node, 'servidor', Number(process.hrtime.bigint() - rxHr) / 1e6);
+            io.emit('datos_sensor', { ...datos, trace: { ...trace, tEmit: Date.now() } });
+        } catch (e) {
+            console.error("Error al decodificar el lote del ESP32:", e);
+        }
+        return;
+    }
+
+    if (!isJsonPayload(message)) {
+        try {
+            const { seq, t, ...datos } = decodeSensorMsg(message);
+            console.log(`Recibido #${seq} (t=${t} ms, ${message.length} bytes): ${JSON.stringify(datos)}`);
+            io.emit('datos_sensor', datos);
+        } catch (e) {
+            console.error("Error al decodificar el mensaje binario del ESP32:", e);
+        }
+        return;
+    }
+
     // El mensaje viene como Buffer, lo pasamos a String
     const mensajeString = message.toString();
     console.log(`Recibido: ${mensajeString}`);
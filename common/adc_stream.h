@@ -0,0 +1,334 @@
+// Adquisición continua del ADC por DMA (adc_continuous) en bloques
+//
+// Sustituye a la lectura adc_oneshot_read cada ~0.5 s de la práctica 2, muy
+// por debajo de lo que hace falta para ver el pulso en la señal PPG. El ADC
+// muestrea solo a frecuencia fija y el DMA llena tramas; al completar cada
+// trama su ISR despierta a una tarea lectora, que pasa las muestras a mV y
+// las deja en un anillo sin cerrojos (un productor, un consumidor). Los
+// consumidores piden bloques de n muestras, no lecturas sueltas, y cada
+// bloque lleva el índice de su primera muestra: con la frecuencia de salida
+// se sabe el instante exacto de cada una aunque el consumidor vaya con
+// retraso. Las muestras perdidas (anillo lleno o pool del DMA desbordado)
+// también consumen índice, así que tras una pérdida las marcas de tiempo
+// siguen siendo las reales; un bloque nunca cruza un hueco (se entrega más
+// corto y el siguiente empieza después de él).
+//
+// Conversión a mV sin coma flotante: al iniciar se evalúa la calibración de
+// ESP-IDF (curve fitting, con los datos de eFuse) en 65 puntos de la escala
+// de 12 bits y por muestra sólo se interpola entre dos de ellos con enteros.
+// Si el chip no tiene calibración se usa el fondo de escala nominal.
+//
+// El ADC del C3 en modo continuo no baja de ~611 Hz, así que para salidas
+// más lentas se promedian decim muestras (p. ej. 1000 Hz / 4 = 250 Hz, que
+// además reduce el ruido).
+//
+// El anillo y la tabla de mV no dependen de ESP-IDF; el driver sólo se
+// compila en el ESP32 (ESP_PLATFORM).
+//
+// Uso:
+//     static adc_stream_t ppg;
+//     adc_stream_config_t cfg = { .channel = ADC_CHANNEL_0, .atten = ADC_ATTEN_DB_11,
+//                                 .sample_hz = 1000, .decim = 4 };
+//     adc_stream_start(&ppg, &cfg, 6);
+//     uint16_t mv[25];
+//     uint32_t idx;
+//     size_t n = adc_stream_read(&ppg, mv, 25, &idx, portMAX_DELAY);
+#ifndef ADC_STREAM_H
+#define ADC_STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#define ADC_STREAM_RING         1024    // muestras (potencia de 2): ~4 s a 250 Hz
+#define ADC_STREAM_LUT_BITS     6       // un punto de calibración cada 64 cuentas
+#define ADC_STREAM_LUT_LEN      ((4096 >> ADC_STREAM_LUT_BITS) + 1)
+
+// ===================== Anillo SPSC =====================
+// head sólo lo escribe el productor y tail sólo el consumidor; son contadores
+// libres de 32 bits (el total de posiciones escritas/leídas). Cada muestra
+// guarda además su índice de adquisición, que lo pone el productor y avanza
+// también con las perdidas.
+typedef struct {
+    uint16_t             buf[ADC_STREAM_RING];
+    uint32_t             idx[ADC_STREAM_RING];
+    _Atomic uint32_t     head;
+    _Atomic uint32_t     tail;
+    uint32_t             overruns;     // muestras perdidas con el anillo lleno
+} adc_ring_t;
+
+static inline uint32_t adc_ring_count(adc_ring_t *r)
+{
+    return atomic_load_explicit(&r->head, memory_order_acquire) -
+           atomic_load_explicit(&r->tail, memory_order_acquire);
+}
+
+// Productor: muestra v con índice idx (el productor lo incrementa en cada
+// muestra, se guarde o no). Si no cabe se descarta y se cuenta.
+static inline bool adc_ring_push(adc_ring_t *r, uint16_t v, uint32_t idx)
+{
+    uint32_t h = atomic_load_explicit(&r->head, memory_order_relaxed);
+    if (h - atomic_load_explicit(&r->tail, memory_order_acquire) >= ADC_STREAM_RING) {
+        r->overruns++;
+        return false;
+    }
+    r->buf[h & (ADC_STREAM_RING - 1)] = v;
+    r->idx[h & (ADC_STREAM_RING - 1)] = idx;
+    atomic_store_explicit(&r->head, h + 1, memory_order_release);
+    return true;
+}
+
+// Consumidor: copia hasta n muestras consecutivas y devuelve cuántas. En
+// *first deja el índice de la primera; se para antes de un hueco para que
+// first + i siga siendo el índice de out[i].
+static inline size_t adc_ring_pop(adc_ring_t *r, uint16_t *out, size_t n, uint32_t *first)
+{
+    uint32_t t = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    uint32_t avail = atomic_load_explicit(&r->head, memory_order_acquire) - t;
+    if (n > avail) n = avail;
+    if (n == 0) return 0;
+
+    uint32_t i0 = r->idx[t & (ADC_STREAM_RING - 1)];
+    size_t i = 0;
+    for (; i < n; i++) {
+        uint32_t slot = (t + (uint32_t)i) & (ADC_STREAM_RING - 1);
+        if (r->idx[slot] != i0 + (uint32_t)i) break;
+        out[i] = r->buf[slot];
+    }
+    if (first) *first = i0;
+    atomic_store_explicit(&r->tail, t + (uint32_t)i, memory_order_release);
+    return i;
+}
+
+// ===================== Cuentas -> mV =====================
+// lut[k] = mV de la cuenta k << ADC_STREAM_LUT_BITS (el último punto, 4096,
+// se toma como 4095: el error es de 1 LSB en la última cuenta)
+typedef struct {
+    uint16_t mv[ADC_STREAM_LUT_LEN];
+} adc_mv_lut_t;
+
+static inline void adc_mv_lut_linear(adc_mv_lut_t *l, uint32_t full_scale_mv)
+{
+    for (uint32_t k = 0; k < ADC_STREAM_LUT_LEN; k++) {
+        uint32_t raw = k << ADC_STREAM_LUT_BITS;
+        if (raw > 4095) raw = 4095;
+        l->mv[k] = (uint16_t)((raw * full_scale_mv + 2047) / 4095);
+    }
+}
+
+static inline uint16_t adc_mv_from_raw(const adc_mv_lut_t *l, uint32_t raw)
+{
+    if (raw > 4095) raw = 4095;
+    uint32_t k = raw >> ADC_STREAM_LUT_BITS;
+    uint32_t frac = raw & ((1u << ADC_STREAM_LUT_BITS) - 1);
+    int32_t a = l->mv[k], b = l->mv[k + 1];
+    return (uint16_t)(a + (((b - a) * (int32_t)frac) >> ADC_STREAM_LUT_BITS));
+}
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_adc/adc_continuous.h"
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include <inttypes.h>
+
+#define ADC_STREAM_FRAME_RESULTS    64      // resultados por trama DMA
+#define ADC_STREAM_FRAME_BYTES      (ADC_STREAM_FRAME_RESULTS * SOC_ADC_DIGI_RESULT_BYTES)
+#define ADC_STREAM_POOL_BYTES       (ADC_STREAM_FRAME_BYTES * 8)
+#define ADC_STREAM_FULL_SCALE_MV    2500    // 11 dB en el C3 sin calibración
+
+typedef struct {
+    adc_channel_t channel;          // ADC1
+    adc_atten_t   atten;
+    uint32_t      sample_hz;        // frecuencia del ADC (>= SOC_ADC_SAMPLE_FREQ_THRES_LOW)
+    uint8_t       decim;            // muestras promediadas por salida (1 = ninguna)
+    uint16_t      block;            // avisa al consumidor con al menos block muestras (0 = 1)
+} adc_stream_config_t;
+
+typedef struct {
+    adc_stream_config_t    cfg;
+    adc_continuous_handle_t adc;
+    adc_mv_lut_t           lut;
+    adc_ring_t             ring;
+    TaskHandle_t           reader;
+    TaskHandle_t           consumer;    // tarea bloqueada en adc_stream_read
+    uint32_t               acc;         // suma para la decimación
+    uint8_t                nacc;        // resultados en acc
+    uint8_t                phase;       // resultados (recibidos o perdidos) de la salida en curso
+    uint32_t               next_idx;    // índice de la próxima muestra de salida
+    bool                   calibrated;
+
+    uint32_t               frames;
+    volatile uint32_t      dma_ovf;     // el pool del driver se llenó (lector con retraso); sólo la ISR
+    uint32_t               ovf_seen;    // dma_ovf ya contabilizados por el lector
+    uint32_t               bad;         // resultados de otro canal o unidad
+} adc_stream_t;
+
+static bool IRAM_ATTR adc_stream_on_frame(adc_continuous_handle_t h, const adc_continuous_evt_data_t *ed,
+                                          void *arg)
+{
+    adc_stream_t *s = arg;
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(s->reader, &woken);
+    return woken == pdTRUE;
+}
+
+// El driver descarta la trama entera que no cabe en su pool
+static bool IRAM_ATTR adc_stream_on_ovf(adc_continuous_handle_t h, const adc_continuous_evt_data_t *ed, void *arg)
+{
+    adc_stream_t *s = arg;
+    s->dma_ovf = s->dma_ovf + 1;
+    return false;
+}
+
+// Resultados perdidos antes de llegar al lector: avanzan el índice de salida
+// como si se hubieran recibido. La media en curso se descarta si el hueco
+// llega a cerrar su salida.
+static inline void adc_stream_skip(adc_stream_t *s, uint32_t lost)
+{
+    uint32_t total = s->phase + lost;
+    s->next_idx += total / s->cfg.decim;
+    s->phase = (uint8_t)(total % s->cfg.decim);
+    if (total >= s->cfg.decim) {
+        s->acc = 0;
+        s->nacc = 0;
+    }
+}
+
+// Pasa una trama de resultados al anillo (decimación incluida)
+static inline void adc_stream_feed(adc_stream_t *s, const uint8_t *buf, uint32_t len)
+{
+    for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= len; i += SOC_ADC_DIGI_RESULT_BYTES) {
+        const adc_digi_output_data_t *d = (const adc_digi_output_data_t *)&buf[i];
+        if (d->type2.unit != ADC_UNIT_1 || d->type2.channel != s->cfg.channel) {
+            s->bad++;
+            continue;
+        }
+        s->acc += d->type2.data;
+        s->nacc++;
+        if (++s->phase < s->cfg.decim) continue;
+        uint32_t raw = (s->acc + s->nacc / 2) / s->nacc;
+        s->acc = 0;
+        s->nacc = 0;
+        s->phase = 0;
+        adc_ring_push(&s->ring, adc_mv_from_raw(&s->lut, raw), s->next_idx++);
+    }
+}
+
+static void adc_stream_task(void *arg)
+{
+    adc_stream_t *s = arg;
+    uint8_t buf[ADC_STREAM_FRAME_BYTES];
+    uint32_t len;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        // Una trama descartada por el driver llegó con el pool lleno: va
+        // detrás de todo lo que había en él, así que el hueco se cuenta al
+        // vaciarlo (vaciar lleva mucho menos que una trama nueva)
+        uint32_t ovf = s->dma_ovf;
+        while (adc_continuous_read(s->adc, buf, sizeof(buf), &len, 0) == ESP_OK) {
+            s->frames++;
+            adc_stream_feed(s, buf, len);
+        }
+        if (ovf != s->ovf_seen) {
+            adc_stream_skip(s, (ovf - s->ovf_seen) * ADC_STREAM_FRAME_RESULTS);
+            s->ovf_seen = ovf;
+        }
+        TaskHandle_t c = s->consumer;
+        uint32_t want = s->cfg.block ? s->cfg.block : 1;
+        if (c != NULL && adc_ring_count(&s->ring) >= want) xTaskNotifyGive(c);
+    }
+}
+
+// Tabla de mV a partir de la calibración de eFuse (o nominal si no la hay)
+static inline bool adc_stream_calibrate(adc_stream_t *s)
+{
+    adc_cali_handle_t cali;
+    adc_cali_curve_fitting_config_t cc = {
+        .unit_id = ADC_UNIT_1,
+        .chan = s->cfg.channel,
+        .atten = s->cfg.atten,
+        .bitwidth = ADC_BITWIDTH_12,
+    };
+    if (adc_cali_create_scheme_curve_fitting(&cc, &cali) != ESP_OK) {
+        adc_mv_lut_linear(&s->lut, ADC_STREAM_FULL_SCALE_MV);
+        return false;
+    }
+    for (uint32_t k = 0; k < ADC_STREAM_LUT_LEN; k++) {
+        int raw = (int)(k << ADC_STREAM_LUT_BITS), mv = 0;
+        if (raw > 4095) raw = 4095;
+        adc_cali_raw_to_voltage(cali, raw, &mv);
+        s->lut.mv[k] = (uint16_t)(mv < 0 ? 0 : mv);
+    }
+    adc_cali_delete_scheme_curve_fitting(cali);
+    return true;
+}
+
+// Configura el ADC1 en modo continuo sobre un canal y arranca la lectura
+static inline esp_err_t adc_stream_start(adc_stream_t *s, const adc_stream_config_t *cfg, UBaseType_t prio)
+{
+    static const char *TAG = "adc_stream";
+
+    *s = (adc_stream_t){ .cfg = *cfg };
+    if (s->cfg.decim == 0) s->cfg.decim = 1;
+    s->calibrated = adc_stream_calibrate(s);
+
+    adc_continuous_handle_cfg_t hc = {
+        .max_store_buf_size = ADC_STREAM_POOL_BYTES,
+        .conv_frame_size = ADC_STREAM_FRAME_BYTES,
+    };
+    ESP_RETURN_ON_ERROR(adc_continuous_new_handle(&hc, &s->adc), TAG, "handle");
+
+    adc_digi_pattern_config_t pat = {
+        .atten = cfg->atten,
+        .channel = cfg->channel,
+        .unit = ADC_UNIT_1,
+        .bit_width = SOC_ADC_DIGI_MAX_BITWIDTH,
+    };
+    adc_continuous_config_t dc = {
+        .pattern_num = 1,
+        .adc_pattern = &pat,
+        .sample_freq_hz = cfg->sample_hz,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_DIGI_OUTPUT_FORMAT_TYPE2,
+    };
+    ESP_RETURN_ON_ERROR(adc_continuous_config(s->adc, &dc), TAG, "config");
+
+    if (xTaskCreate(adc_stream_task, "adc_stream", 3072, s, prio, &s->reader) != pdPASS) return ESP_ERR_NO_MEM;
+    adc_continuous_evt_cbs_t cbs = { .on_conv_done = adc_stream_on_frame, .on_pool_ovf = adc_stream_on_ovf };
+    ESP_RETURN_ON_ERROR(adc_continuous_register_event_callbacks(s->adc, &cbs, s), TAG, "callbacks");
+    ESP_RETURN_ON_ERROR(adc_continuous_start(s->adc), TAG, "start");
+
+    ESP_LOGI(TAG, "canal %d a %" PRIu32 " Hz / %u = %" PRIu32 " Hz, %s", cfg->channel, cfg->sample_hz,
+             s->cfg.decim, cfg->sample_hz / s->cfg.decim, s->calibrated ? "calibrado" : "sin calibración (nominal)");
+    return ESP_OK;
+}
+
+// Frecuencia de las muestras entregadas
+static inline uint32_t adc_stream_rate_hz(const adc_stream_t *s)
+{
+    return s->cfg.sample_hz / s->cfg.decim;
+}
+
+// Bloque de n muestras en mV. Espera hasta timeout a que estén todas; devuelve
+// cuántas ha copiado (menos de n si hay un hueco por pérdidas) y en *first
+// el índice de la primera. Un solo consumidor.
+static inline size_t adc_stream_read(adc_stream_t *s, uint16_t *mv, size_t n, uint32_t *first, TickType_t timeout)
+{
+    s->consumer = xTaskGetCurrentTaskHandle();
+    TickType_t t0 = xTaskGetTickCount();
+    while (adc_ring_count(&s->ring) < n) {
+        TickType_t waited = xTaskGetTickCount() - t0;
+        if (timeout != portMAX_DELAY && waited >= timeout) break;
+        ulTaskNotifyTake(pdTRUE, timeout == portMAX_DELAY ? portMAX_DELAY : timeout - waited);
+    }
+    return adc_ring_pop(&s->ring, mv, n, first);
+}
+#endif
+
+#endif // ADC_STREAM_H
@@ -0,0 +1,170 @@
+// Filtro de orientación Mahony en punto fijo (cuaternión Q30)
+//
+// La ESP32-C3 (RV32IMC) no tiene FPU: cada atan2f/sqrtf/multiplicación float
+// del filtro complementario se emula por software. Este filtro trabaja sólo
+// con enteros de 32/64 bits:
+//   - cuaternión y vectores unitarios en Q30 (1.0 = 1 << 30)
+//   - velocidad angular en rad/s Q16
+//   - dt en segundos Q30
+// La normalización usa una raíz cuadrada inversa rápida (estimación lineal y
+// cuatro pasos de Newton), sin divisiones.
+//
+// Sin magnetómetro el yaw no tiene corrección absoluta (igual que antes), pero
+// al integrar en el cuaternión los ejes quedan acoplados correctamente y roll
+// y pitch se corrigen con el acelerómetro en cualquier orientación.
+//
+// No depende de ESP-IDF, por lo que compila también en el host.
+//
+// Uso:
+//     ahrs_mahony_t f;
+//     ahrs_mahony_init(&f, AHRS_Q16(0.5f), AHRS_Q16(0.0f));
+//     for (...) ahrs_mahony_update(&f, g_q16, a_raw, dt_q30);
+//     ahrs_mahony_euler_deg(&f, &roll, &pitch, &yaw);   // float, una vez por lote
+#ifndef AHRS_H
+#define AHRS_H
+
+#include <stdint.h>
+#include <math.h>
+
+#define AHRS_ONE_Q30        (1 << 30)
+#define AHRS_PI             3.14159265358979f   // M_PI no existe en C11 estricto
+#define AHRS_Q16(x)         ((int32_t)((x) * 65536.0f))
+#define AHRS_Q30(x)         ((int32_t)((x) * 1073741824.0f))
+
+typedef struct {
+    int32_t q[4];           // w, x, y, z (Q30)
+    int32_t kp_q16;         // ganancia proporcional (1/s)
+    int32_t ki_q16;         // ganancia integral (1/s^2)
+    int32_t ib_q30[3];      // sesgo integrado del giroscopio, rad/s Q30
+} ahrs_mahony_t;
+
+static inline int32_t ahrs_mul30(int32_t a, int32_t b)
+{
+    return (int32_t)(((int64_t)a * b) >> 30);
+}
+
+static inline int ahrs_msb64(uint64_t v)
+{
+    return 63 - __builtin_clzll(v);
+}
+
+// 1/sqrt(m) = r * 2^-(45 + s/2), con r en Q30 dentro de (0.5, 1] y s par.
+// Se reduce m a x = m * 2^-s en [1, 4) (Q30), se estima 1/sqrt(x) con la
+// cuerda entre x = 1 y x = 4 (error < 25 %) y se refina con Newton:
+// y <- y * (3 - x*y^2) / 2. Cuatro iteraciones dejan el error en 1-2 LSB.
+static inline int32_t ahrs_inv_sqrt(uint64_t m, int *s)
+{
+    int sh = (ahrs_msb64(m) - 30) & ~1;
+    uint32_t x = (uint32_t)(sh >= 0 ? m >> sh : m << -sh);
+    int64_t y = AHRS_ONE_Q30 - ((int64_t)x - AHRS_ONE_Q30) / 6;
+
+    for (int i = 0; i < 4; i++) {
+        int64_t y2 = (y * y) >> 30;
+        int64_t xy2 = ((int64_t)x * y2) >> 30;
+        y = (y * ((3LL << 30) - xy2)) >> 31;
+    }
+    *s = sh;
+    return (int32_t)y;
+}
+
+// c / sqrt(m) en Q30 = c * r * 2^-(15 + s/2), con r y s de ahrs_inv_sqrt(m).
+// Vale igual para enteros crudos (acelerómetro) que para componentes Q30
+// (cuaternión, con m en Q60).
+static inline int32_t ahrs_scale(int64_t c, int32_t r, int s)
+{
+    int64_t v = c * r;
+    int h = 15 + s / 2;
+    return (int32_t)(h >= 0 ? v >> h : v << -h);
+}
+
+static inline void ahrs_mahony_init(ahrs_mahony_t *f, int32_t kp_q16, int32_t ki_q16)
+{
+    *f = (ahrs_mahony_t){
+        .q = { AHRS_ONE_Q30, 0, 0, 0 },
+        .kp_q16 = kp_q16,
+        .ki_q16 = ki_q16,
+    };
+}
+
+// Un paso del filtro.
+//   g_q16: giroscopio en rad/s Q16 (ya sin offset)
+//   a:     acelerómetro en cualquier escala entera (sólo importa la dirección)
+//   dt_q30: periodo de muestra en segundos Q30
+static inline void ahrs_mahony_update(ahrs_mahony_t *f, const int32_t g_q16[3],
+                                      const int32_t a[3], int32_t dt_q30)
+{
+    int32_t *q = f->q;
+    int32_t gx = g_q16[0], gy = g_q16[1], gz = g_q16[2];
+    int s;
+
+    uint64_t am = (uint64_t)((int64_t)a[0] * a[0] + (int64_t)a[1] * a[1] + (int64_t)a[2] * a[2]);
+    if (am != 0) {
+        // Acelerómetro normalizado (Q30)
+        int32_t r = ahrs_inv_sqrt(am, &s);
+        int32_t ax = ahrs_scale(a[0], r, s);
+        int32_t ay = ahrs_scale(a[1], r, s);
+        int32_t az = ahrs_scale(a[2], r, s);
+
+        // Dirección de la gravedad estimada por el cuaternión (Q30)
+        int32_t vx = 2 * (ahrs_mul30(q[1], q[3]) - ahrs_mul30(q[0], q[2]));
+        int32_t vy = 2 * (ahrs_mul30(q[0], q[1]) + ahrs_mul30(q[2], q[3]));
+        int32_t vz = ahrs_mul30(q[0], q[0]) - ahrs_mul30(q[1], q[1])
+                   - ahrs_mul30(q[2], q[2]) + ahrs_mul30(q[3], q[3]);
+
+        // Error = a x v (Q30, adimensional)
+        int32_t ex = ahrs_mul30(ay, vz) - ahrs_mul30(az, vy);
+        int32_t ey = ahrs_mul30(az, vx) - ahrs_mul30(ax, vz);
+        int32_t ez = ahrs_mul30(ax, vy) - ahrs_mul30(ay, vx);
+
+        if (f->ki_q16 > 0) {
+            // ib += Ki * e * dt, acumulado en Q30 para no perder resolución
+            f->ib_q30[0] += ahrs_mul30((int32_t)(((int64_t)ex * f->ki_q16) >> 16), dt_q30);
+            f->ib_q30[1] += ahrs_mul30((int32_t)(((int64_t)ey * f->ki_q16) >> 16), dt_q30);
+            f->ib_q30[2] += ahrs_mul30((int32_t)(((int64_t)ez * f->ki_q16) >> 16), dt_q30);
+            gx += f->ib_q30[0] >> 14;
+            gy += f->ib_q30[1] >> 14;
+            gz += f->ib_q30[2] >> 14;
+        }
+
+        // Corrección proporcional: Kp * e (rad/s Q16)
+        gx += (int32_t)(((int64_t)ex * f->kp_q16) >> 30);
+        gy += (int32_t)(((int64_t)ey * f->kp_q16) >> 30);
+        gz += (int32_t)(((int64_t)ez * f->kp_q16) >> 30);
+    }
+
+    // Integración: q += q (x) (0, g) * dt / 2
+    int32_t hx = (int32_t)(((int64_t)gx * dt_q30) >> 17);   // Q16 * Q30 / 2 -> Q30
+    int32_t hy = (int32_t)(((int64_t)gy * dt_q30) >> 17);
+    int32_t hz = (int32_t)(((int64_t)gz * dt_q30) >> 17);
+
+    int32_t q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+    q0 += -ahrs_mul30(q[1], hx) - ahrs_mul30(q[2], hy) - ahrs_mul30(q[3], hz);
+    q1 +=  ahrs_mul30(q[0], hx) + ahrs_mul30(q[2], hz) - ahrs_mul30(q[3], hy);
+    q2 +=  ahrs_mul30(q[0], hy) - ahrs_mul30(q[1], hz) + ahrs_mul30(q[3], hx);
+    q3 +=  ahrs_mul30(q[0], hz) + ahrs_mul30(q[1], hy) - ahrs_mul30(q[2], hx);
+
+    // Renormalización (|q|^2 en Q60)
+    uint64_t qm = (uint64_t)((int64_t)q0 * q0 + (int64_t)q1 * q1 + (int64_t)q2 * q2 + (int64_t)q3 * q3);
+    int32_t r = ahrs_inv_sqrt(qm, &s);
+    q[0] = ahrs_scale(q0, r, s);
+    q[1] = ahrs_scale(q1, r, s);
+    q[2] = ahrs_scale(q2, r, s);
+    q[3] = ahrs_scale(q3, r, s);
+}
+
+// Ángulos de Euler en grados (convención de p3_LSM6DS33.c: roll sobre X,
+// pitch sobre Y, yaw sobre Z). Usa float: llamar sólo para mostrar/actuar.
+static inline void ahrs_mahony_euler_deg(const ahrs_mahony_t *f, float *roll, float *pitch, float *yaw)
+{
+    const float k = 1.0f / AHRS_ONE_Q30;
+    float w = f->q[0] * k, x = f->q[1] * k, y = f->q[2] * k, z = f->q[3] * k;
+    float sp = 2.0f * (w * y - z * x);
+    if (sp > 1.0f) sp = 1.0f;
+    if (sp < -1.0f) sp = -1.0f;
+
+    *roll  = atan2f(2.0f * (w * x + y * z), 1.0f - 2.0f * (x * x + y * y)) * 180.0f / AHRS_PI;
+    *pitch = asinf(sp) * 180.0f / AHRS_PI;
+    *yaw   = atan2f(2.0f * (w * z + x * y), 1.0f - 2.0f * (y * y + z * z)) * 180.0f / AHRS_PI;
+}
+
+#endif // AHRS_H
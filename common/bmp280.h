@@ -0,0 +1,265 @@
+// Compensación BMP280/BME280 (temperatura y presión) sin coma flotante
+//
+// La fórmula de referencia de Bosch en 64 bits hace varias multiplicaciones
+// de 64 bits y una división de 64 bits por muestra, que en el RV32IMC de la
+// ESP32-C3 son llamadas a la librería (__muldi3/__divdi3). Aquí se usa la
+// variante de 32 bits del datasheet (resolución 1 Pa) partida en tres fases:
+//
+//   1. bmp280_comp_init(): una vez tras leer la calibración. Deja listos los
+//      términos que sólo dependen de los coeficientes dig_* (ya extendidos a
+//      32 bits y con sus desplazamientos aplicados).
+//   2. bmp280_press_prep(): una vez por cada t_fine distinto. Todo el
+//      polinomio en temperatura (divisor y offset) queda precalculado.
+//   3. bmp280_press_apply(): por muestra. Una división de 32 bits (hardware)
+//      y el término de segundo orden en p.
+//
+// bmp280_comp() guarda la fase 2 del último adc_T en el propio
+// bmp280_comp_t, así que mientras la temperatura no cambia (lo normal entre
+// lecturas seguidas y dentro de un lote con bmp280_comp_batch()) cada
+// muestra cuesta sólo la fase 3. bmp280_comp_press64() es la fórmula
+// original en 64 bits (Pa * 256), que sirve de referencia: la de 32 bits
+// difiere de ella en unos pocos Pa (< 0.1 hPa) en todo el rango de medida
+// (tests/test_bmp280.c lo comprueba).
+//
+// Perfiles de medida (datasheet, apartado 3.4): cada uno fija el
+// oversampling de temperatura y presión, el filtro IIR y t_standby. Se usan
+// en modo forzado: una conversión por lectura, con el sensor en reposo
+// entre medidas, de modo que consumo y tráfico I2C escalan con la tasa
+// pedida. bmp280_meas_time_us() da el tiempo máximo de conversión del
+// datasheet (apartado 9.1) para esperar justo lo necesario.
+//
+// No depende de ESP-IDF, por lo que compila también en el host.
+#ifndef BMP280_H
+#define BMP280_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define BMP280_CALIB_LEN    24      // 0x88..0x9F
+
+#define BMP280_REG_STATUS       0xF3
+#define BMP280_REG_CTRL_MEAS    0xF4
+#define BMP280_REG_CONFIG       0xF5
+#define BMP280_STATUS_MEASURING 0x08
+
+#define BMP280_MODE_SLEEP       0x00
+#define BMP280_MODE_FORCED      0x01
+#define BMP280_MODE_NORMAL      0x03
+
+typedef enum {
+    BMP280_PROFILE_ULTRA_LOW_POWER = 0, // estación meteorológica: x1/x1, sin IIR
+    BMP280_PROFILE_STANDARD,            // cambios de planta: p x4, t x1, IIR 4
+    BMP280_PROFILE_HIGH_RES,            // p x8, t x1, IIR 4
+    BMP280_PROFILE_INDOOR_NAV,          // navegación en interior: p x16, t x2, IIR 16
+} bmp280_profile_id_t;
+
+typedef struct {
+    uint8_t osrs_t;         // oversampling: 1, 2, 4, 8 o 16 (0 = desactivado)
+    uint8_t osrs_p;
+    uint8_t filter;         // coeficiente IIR: 0 (off), 2, 4, 8 o 16
+    uint8_t t_sb;           // código t_standby (sólo modo normal): 0 = 0.5 ms ... 7 = 4 s
+} bmp280_profile_t;
+
+static inline const bmp280_profile_t *bmp280_profile(bmp280_profile_id_t id)
+{
+    static const bmp280_profile_t profiles[] = {
+        [BMP280_PROFILE_ULTRA_LOW_POWER] = { .osrs_t = 1, .osrs_p = 1,  .filter = 0,  .t_sb = 5 },
+        [BMP280_PROFILE_STANDARD]        = { .osrs_t = 1, .osrs_p = 4,  .filter = 4,  .t_sb = 0 },
+        [BMP280_PROFILE_HIGH_RES]        = { .osrs_t = 1, .osrs_p = 8,  .filter = 4,  .t_sb = 0 },
+        [BMP280_PROFILE_INDOOR_NAV]      = { .osrs_t = 2, .osrs_p = 16, .filter = 16, .t_sb = 0 },
+    };
+    return &profiles[id];
+}
+
+// x1 -> 1, x2 -> 2, x4 -> 3, x8 -> 4, x16 -> 5 (vale también para el filtro: 2 -> 1 ... 16 -> 4)
+static inline uint8_t bmp280_log2_code(uint8_t v)
+{
+    uint8_t code = 0;
+    while (v) {
+        code++;
+        v >>= 1;
+    }
+    return code;
+}
+
+static inline uint8_t bmp280_ctrl_meas(const bmp280_profile_t *p, uint8_t mode)
+{
+    return (uint8_t)((bmp280_log2_code(p->osrs_t) << 5) | (bmp280_log2_code(p->osrs_p) << 2) | mode);
+}
+
+static inline uint8_t bmp280_config(const bmp280_profile_t *p)
+{
+    uint8_t filter = p->filter ? bmp280_log2_code(p->filter) - 1 : 0;
+    return (uint8_t)(((p->t_sb & 0x07) << 5) | (filter << 2));
+}
+
+// Tiempo máximo de una conversión: 1.25 + 2.3 * osrs_t + (2.3 * osrs_p + 0.575) ms
+static inline uint32_t bmp280_meas_time_us(const bmp280_profile_t *p)
+{
+    uint32_t t = 1250 + 2300u * p->osrs_t;
+    if (p->osrs_p) t += 2300u * p->osrs_p + 575;
+    return t;
+}
+
+typedef struct {
+    uint16_t dig_T1;
+    int16_t  dig_T2;
+    int16_t  dig_T3;
+
+    uint16_t dig_P1;
+    int16_t  dig_P2;
+    int16_t  dig_P3;
+    int16_t  dig_P4;
+    int16_t  dig_P5;
+    int16_t  dig_P6;
+    int16_t  dig_P7;
+    int16_t  dig_P8;
+    int16_t  dig_P9;
+} bmp280_calib_t;
+
+// Coeficientes de presión para un t_fine concreto
+typedef struct {
+    int32_t  t_fine;
+    uint32_t div;           // var1 de Bosch (0 = calibración inválida)
+    int32_t  offset;        // var2 >> 12
+} bmp280_press_prep_t;
+
+// Términos precalculados a partir de la calibración y fase de temperatura
+// de la última muestra
+typedef struct {
+    bmp280_calib_t c;       // original, para la referencia de 64 bits
+    int32_t t1_x2;          // dig_T1 << 1
+    int32_t t1;
+    int32_t t2;
+    int32_t t3;
+    int32_t p1;
+    int32_t p2;
+    int32_t p3;
+    int32_t p4_x65536;      // dig_P4 << 16
+    int32_t p5_x2;          // dig_P5 << 1
+    int32_t p6;
+    int32_t p7;
+    int32_t p8;
+    int32_t p9;
+
+    int32_t last_adc_T;     // INT32_MIN = ninguna
+    int32_t last_t100;
+    bmp280_press_prep_t pp;
+} bmp280_comp_t;
+
+static inline void bmp280_parse_calib(const uint8_t b[BMP280_CALIB_LEN], bmp280_calib_t *c)
+{
+    c->dig_T1 = (uint16_t)(b[1] << 8 | b[0]);
+    c->dig_T2 = (int16_t)(b[3] << 8 | b[2]);
+    c->dig_T3 = (int16_t)(b[5] << 8 | b[4]);
+
+    c->dig_P1 = (uint16_t)(b[7] << 8 | b[6]);
+    c->dig_P2 = (int16_t)(b[9] << 8 | b[8]);
+    c->dig_P3 = (int16_t)(b[11] << 8 | b[10]);
+    c->dig_P4 = (int16_t)(b[13] << 8 | b[12]);
+    c->dig_P5 = (int16_t)(b[15] << 8 | b[14]);
+    c->dig_P6 = (int16_t)(b[17] << 8 | b[16]);
+    c->dig_P7 = (int16_t)(b[19] << 8 | b[18]);
+    c->dig_P8 = (int16_t)(b[21] << 8 | b[20]);
+    c->dig_P9 = (int16_t)(b[23] << 8 | b[22]);
+}
+
+static inline void bmp280_comp_init(bmp280_comp_t *k, const bmp280_calib_t *c)
+{
+    k->c = *c;
+    k->t1_x2 = (int32_t)c->dig_T1 << 1;
+    k->t1 = c->dig_T1;
+    k->t2 = c->dig_T2;
+    k->t3 = c->dig_T3;
+    k->p1 = c->dig_P1;
+    k->p2 = c->dig_P2;
+    k->p3 = c->dig_P3;
+    k->p4_x65536 = (int32_t)c->dig_P4 * 65536;
+    k->p5_x2 = (int32_t)c->dig_P5 * 2;
+    k->p6 = c->dig_P6;
+    k->p7 = c->dig_P7;
+    k->p8 = c->dig_P8;
+    k->p9 = c->dig_P9;
+    k->last_adc_T = INT32_MIN;
+}
+
+// Temperatura en 0.01 °C; deja t_fine para la presión
+static inline int32_t bmp280_comp_temp(const bmp280_comp_t *k, int32_t adc_T, int32_t *t_fine)
+{
+    int32_t var1 = (((adc_T >> 3) - k->t1_x2) * k->t2) >> 11;
+    int32_t d = (adc_T >> 4) - k->t1;
+    int32_t var2 = (((d * d) >> 12) * k->t3) >> 14;
+    *t_fine = var1 + var2;
+    return (*t_fine * 5 + 128) >> 8;
+}
+
+// Fase dependiente sólo de la temperatura (variante de 32 bits de Bosch)
+static inline void bmp280_press_prep(const bmp280_comp_t *k, int32_t t_fine, bmp280_press_prep_t *pp)
+{
+    int32_t var1 = (t_fine >> 1) - 64000;
+    int32_t v = (var1 >> 2) * (var1 >> 2);
+    int32_t var2 = ((v >> 11) * k->p6) + ((var1 * k->p5_x2));
+    var2 = (var2 >> 2) + k->p4_x65536;
+    var1 = (((k->p3 * (v >> 13)) >> 3) + ((k->p2 * var1) >> 1)) >> 18;
+    var1 = ((32768 + var1) * k->p1) >> 15;
+
+    pp->t_fine = t_fine;
+    pp->div = (uint32_t)var1;
+    pp->offset = var2 >> 12;
+}
+
+// Presión en Pa a partir de la fase precalculada
+static inline uint32_t bmp280_press_apply(const bmp280_comp_t *k, const bmp280_press_prep_t *pp, int32_t adc_P)
+{
+    if (pp->div == 0) return 0;
+    uint32_t p = ((uint32_t)(1048576 - adc_P) - (uint32_t)pp->offset) * 3125u;
+    if (p < 0x80000000u) p = (p << 1) / pp->div;
+    else p = (p / pp->div) * 2;
+
+    int32_t var1 = (k->p9 * (int32_t)(((p >> 3) * (p >> 3)) >> 13)) >> 12;
+    int32_t var2 = ((int32_t)(p >> 2) * k->p8) >> 13;
+    return (uint32_t)((int32_t)p + ((var1 + var2 + k->p7) >> 4));
+}
+
+// Una muestra completa: temperatura (0.01 °C) y presión (Pa). Las fases de
+// temperatura se rehacen sólo si adc_T ha cambiado desde la muestra anterior.
+static inline void bmp280_comp(bmp280_comp_t *k, int32_t adc_T, int32_t adc_P, int32_t *t100, uint32_t *pa)
+{
+    if (adc_T != k->last_adc_T) {
+        int32_t t_fine;
+        k->last_t100 = bmp280_comp_temp(k, adc_T, &t_fine);
+        bmp280_press_prep(k, t_fine, &k->pp);
+        k->last_adc_T = adc_T;
+    }
+    *t100 = k->last_t100;
+    *pa = bmp280_press_apply(k, &k->pp, adc_P);
+}
+
+// Compensa n muestras (en lotes cortos la temperatura apenas cambia y casi
+// todas cuestan sólo la fase 3)
+static inline void bmp280_comp_batch(bmp280_comp_t *k, const int32_t *adc_T, const int32_t *adc_P,
+                                     size_t n, int32_t *t100, uint32_t *pa)
+{
+    for (size_t i = 0; i < n; i++) bmp280_comp(k, adc_T[i], adc_P[i], &t100[i], &pa[i]);
+}
+
+// Referencia: fórmula de 64 bits del datasheet, Pa * 256 (Q24.8)
+static inline uint32_t bmp280_comp_press64(const bmp280_calib_t *c, int32_t t_fine, int32_t adc_P)
+{
+    int64_t var1, var2, p;
+    var1 = ((int64_t)t_fine) - 128000;
+    var2 = var1 * var1 * (int64_t)c->dig_P6;
+    var2 = var2 + ((var1 * (int64_t)c->dig_P5) << 17);
+    var2 = var2 + (((int64_t)c->dig_P4) << 35);
+    var1 = ((var1 * var1 * (int64_t)c->dig_P3) >> 8) + ((var1 * (int64_t)c->dig_P2) << 12);
+    var1 = (((((int64_t)1) << 47) + var1) * (int64_t)c->dig_P1) >> 33;
+    if (var1 == 0) return 0;
+    p = 1048576 - adc_P;
+    p = (((p << 31) - var2) * 3125) / var1;
+    var1 = ((int64_t)c->dig_P9 * (p >> 13) * (p >> 13)) >> 25;
+    var2 = ((int64_t)c->dig_P8 * p) >> 19;
+    p = ((p + var1 + var2) >> 8) + (((int64_t)c->dig_P7) << 4);
+    return (uint32_t)p;
+}
+
+#endif // BMP280_H
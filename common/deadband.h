@@ -0,0 +1,89 @@
+// Filtro de cambios por canal (banda muerta + silencio máximo)
+//
+// Cada productor decide si una lectura merece publicarse: se compara canal
+// a canal con la última que dejó pasar y sólo pasa si alguno se ha movido
+// más que su banda muerta, o si lleva max_silence_ms sin publicar nada
+// (latido, para que el servidor sepa que el nodo sigue vivo). Una banda de
+// 0 deja pasar cualquier cambio (p. ej. el estado del fix). Los valores son
+// enteros en la unidad de cada canal, como en el resto del firmware.
+//
+// El primer cambio tras una o más lecturas dentro de la banda se marca como
+// DEADBAND_ONSET: es el que conviene enviar en el acto (empieza un
+// movimiento); los DEADBAND_CHANGED que le siguen pueden esperar en el lote.
+//
+// Uso:
+//     static const int32_t db[2] = { 5, 12 };     // 0.05 °C, 12 Pa
+//     deadband_t f;
+//     deadband_init(&f, 2, db, 60000);
+//     int32_t v[2] = { t100, pa };
+//     if (deadband_check(&f, v, now_ms) != DEADBAND_HOLD) { ... publicar ... }
+#ifndef DEADBAND_H
+#define DEADBAND_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define DEADBAND_MAX_CH     6
+
+typedef enum {
+    DEADBAND_HOLD = 0,      // sin cambios relevantes: no se publica
+    DEADBAND_SILENCE,       // latido tras max_silence_ms
+    DEADBAND_CHANGED,       // algún canal ha salido de su banda
+    DEADBAND_ONSET,         // como CHANGED, pero la lectura anterior estaba en banda
+} deadband_result_t;
+
+typedef struct {
+    uint8_t  nch;
+    int32_t  band[DEADBAND_MAX_CH];
+    int32_t  last[DEADBAND_MAX_CH];     // último valor publicado
+    uint32_t max_silence_ms;
+    uint32_t t_last_ms;
+    bool     primed;
+    bool     moving;                    // la última lectura salió de su banda
+
+    uint32_t changed;
+    uint32_t silence;
+    uint32_t held;
+} deadband_t;
+
+static inline void deadband_init(deadband_t *f, uint8_t nch, const int32_t *band, uint32_t max_silence_ms)
+{
+    *f = (deadband_t){ .nch = nch > DEADBAND_MAX_CH ? DEADBAND_MAX_CH : nch, .max_silence_ms = max_silence_ms };
+    for (int k = 0; k < f->nch; k++) f->band[k] = band[k];
+}
+
+static inline deadband_result_t deadband_check(deadband_t *f, const int32_t *v, uint32_t now_ms)
+{
+    deadband_result_t r = DEADBAND_HOLD;
+
+    if (!f->primed) {
+        r = DEADBAND_CHANGED;
+    } else {
+        for (int k = 0; k < f->nch; k++) {
+            int64_t d = (int64_t)v[k] - f->last[k];
+            if (d > f->band[k] || d < -(int64_t)f->band[k]) {
+                r = DEADBAND_CHANGED;
+                break;
+            }
+        }
+        if (r == DEADBAND_HOLD && now_ms - f->t_last_ms >= f->max_silence_ms) r = DEADBAND_SILENCE;
+    }
+
+    bool was_moving = f->moving;
+    f->moving = r == DEADBAND_CHANGED;
+    if (r == DEADBAND_HOLD) {
+        f->held++;
+        return r;
+    }
+    for (int k = 0; k < f->nch; k++) f->last[k] = v[k];
+    f->t_last_ms = now_ms;
+    f->primed = true;
+    if (r == DEADBAND_SILENCE) {
+        f->silence++;
+        return r;
+    }
+    f->changed++;
+    return was_moving ? DEADBAND_CHANGED : DEADBAND_ONSET;
+}
+
+#endif // DEADBAND_H
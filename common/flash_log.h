@@ -0,0 +1,373 @@
+// Registro circular en flash para store-and-forward (sólo append)
+//
+// Guarda mensajes mientras el broker no está accesible y los devuelve en
+// orden cuando vuelve. La partición se divide en sectores de FLOG_SECTOR
+// bytes que se usan en anillo: cada sector empieza con una cabecera
+//
+//     magic (u32) | seq (u32) | borrados (u32) | CRC-16 (u16) | 0xFFFF
+//
+// y después registros alineados a 4 bytes
+//
+//     len (u16) | CRC-16 de len + datos (u16) | estado (u8) | 3 x 0xFF | datos
+//
+// Escrituras y borrados respetan la flash NOR:
+//   - la cabecera del registro se escribe antes que los datos, así que un
+//     corte a medias deja un CRC incorrecto: al montar, ese sector se da por
+//     cerrado y se sigue en el siguiente, sin reescribir nunca sobre bytes
+//     ya programados
+//   - "enviado" sólo baja bits del byte de estado (0xFF -> 0x00)
+//   - un sector sólo se borra cuando la escritura llega a él, siempre en el
+//     mismo orden circular, así que todos se desgastan por igual. Si aún
+//     tenía registros pendientes (corte muy largo) se pierden los más
+//     antiguos y se cuentan en dropped.
+//
+// flog_peek() recuerda qué registro devolvió (sector, desplazamiento y seq
+// del sector) y flog_ack() sólo lo marca si sigue siendo la cola: si entre
+// medias una rotación ha pisado ese sector, el ACK llega tarde y devuelve
+// FLOG_STALE sin tocar el registro que ahora ocupa la cola.
+//
+// El acceso a la flash va por flog_io_t, de modo que la lógica no depende de
+// ESP-IDF; la parte de esp_partition sólo se compila en el ESP32. No es
+// reentrante: lo debe usar una sola tarea.
+#ifndef FLASH_LOG_H
+#define FLASH_LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#define FLOG_SECTOR         4096
+#define FLOG_MAGIC          0x474C4653u     // "SFLG"
+#define FLOG_HDR_LEN        16
+#define FLOG_REC_HDR        8
+#define FLOG_MAX_REC        (FLOG_SECTOR - FLOG_HDR_LEN - FLOG_REC_HDR)
+#define FLOG_ALIGN(n)       (((n) + 3u) & ~3u)
+
+#define FLOG_STATE_PENDING  0xFF
+#define FLOG_STATE_SENT     0x00
+
+#define FLOG_OK             0
+#define FLOG_EMPTY          1
+#define FLOG_STALE          2               // el registro de flog_peek ya no es la cola
+#define FLOG_ERR_IO         (-1)
+#define FLOG_ERR_SIZE       (-2)
+
+// Acceso a la partición: desplazamientos relativos a su inicio, 0 = correcto
+typedef struct {
+    void     *ctx;
+    int     (*read)(void *ctx, uint32_t off, void *buf, size_t len);
+    int     (*write)(void *ctx, uint32_t off, const void *buf, size_t len);
+    int     (*erase)(void *ctx, uint32_t off, size_t len);
+    uint32_t  size;         // múltiplo de FLOG_SECTOR
+} flog_io_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t erases;
+    uint16_t crc;
+    uint16_t pad;
+} flog_sect_hdr_t;
+
+typedef struct {
+    uint16_t len;
+    uint16_t crc;
+    uint8_t  state;
+    uint8_t  pad[3];
+} flog_rec_hdr_t;
+
+typedef struct {
+    flog_io_t io;
+    uint32_t  nsect;
+
+    uint32_t  head_sect;    // sector y desplazamiento de la próxima escritura
+    uint32_t  head_off;
+    uint32_t  head_seq;
+
+    uint32_t  tail_sect;    // registro pendiente más antiguo (si pending > 0)
+    uint32_t  tail_off;
+    uint32_t  pending;
+
+    bool      peeked;       // registro devuelto por flog_peek, a la espera de flog_ack
+    uint32_t  peek_sect;
+    uint32_t  peek_off;
+    uint32_t  peek_seq;
+
+    uint32_t  appended;
+    uint32_t  acked;
+    uint32_t  dropped;      // pendientes pisados al rotar
+    uint32_t  erases;       // borrados de sector desde el montaje
+} flog_t;
+
+typedef enum {
+    FLOG_REC_OK,
+    FLOG_REC_END,           // flash borrada: no hay más registros en el sector
+    FLOG_REC_BAD,           // escritura interrumpida o corrupta
+} flog_rec_status_t;
+
+// CRC-16/CCITT-FALSE, encadenable
+static inline uint16_t flog_crc16(uint16_t crc, const uint8_t *d, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        crc ^= (uint16_t)d[i] << 8;
+        for (int b = 0; b < 8; b++) crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+static inline uint32_t flog_addr(uint32_t sect, uint32_t off)
+{
+    return sect * FLOG_SECTOR + off;
+}
+
+static inline bool flog_read_sect(flog_t *f, uint32_t s, flog_sect_hdr_t *h)
+{
+    if (f->io.read(f->io.ctx, flog_addr(s, 0), h, sizeof(*h)) != 0) return false;
+    return h->magic == FLOG_MAGIC && h->crc == flog_crc16(0xFFFF, (const uint8_t *)h, 12);
+}
+
+// Lee la cabecera del registro en (s, off) y comprueba su CRC
+static inline flog_rec_status_t flog_rec_check(flog_t *f, uint32_t s, uint32_t off, flog_rec_hdr_t *r)
+{
+    if (off + FLOG_REC_HDR > FLOG_SECTOR) return FLOG_REC_END;
+    if (f->io.read(f->io.ctx, flog_addr(s, off), r, sizeof(*r)) != 0) return FLOG_REC_BAD;
+    if (r->len == 0xFFFF) return FLOG_REC_END;
+    if (r->len == 0 || off + FLOG_REC_HDR + r->len > FLOG_SECTOR) return FLOG_REC_BAD;
+
+    uint16_t crc = flog_crc16(0xFFFF, (const uint8_t *)&r->len, 2);
+    uint8_t chunk[64];
+    for (uint32_t done = 0; done < r->len; done += sizeof(chunk)) {
+        size_t n = r->len - done < sizeof(chunk) ? r->len - done : sizeof(chunk);
+        if (f->io.read(f->io.ctx, flog_addr(s, off + FLOG_REC_HDR + done), chunk, n) != 0) return FLOG_REC_BAD;
+        crc = flog_crc16(crc, chunk, n);
+    }
+    return crc == r->crc ? FLOG_REC_OK : FLOG_REC_BAD;
+}
+
+// Recorre los registros válidos de un sector; devuelve el desplazamiento
+// donde termina la parte válida y, si pending != NULL, cuántos faltan por enviar
+static inline uint32_t flog_scan_sect(flog_t *f, uint32_t s, uint32_t *pending, flog_rec_status_t *last)
+{
+    uint32_t off = FLOG_HDR_LEN;
+    flog_rec_hdr_t r;
+    flog_rec_status_t st;
+
+    while ((st = flog_rec_check(f, s, off, &r)) == FLOG_REC_OK) {
+        if (pending && r.state == FLOG_STATE_PENDING) (*pending)++;
+        off += FLOG_REC_HDR + FLOG_ALIGN(r.len);
+    }
+    if (last) *last = st;
+    return off;
+}
+
+// Busca el primer registro pendiente desde (s, off) hasta la cabeza
+static inline void flog_seek_pending(flog_t *f, uint32_t s, uint32_t off)
+{
+    for (uint32_t i = 0; i < f->nsect; i++) {
+        flog_sect_hdr_t h;
+        if (flog_read_sect(f, s, &h)) {
+            flog_rec_hdr_t r;
+            while (!(s == f->head_sect && off >= f->head_off) && flog_rec_check(f, s, off, &r) == FLOG_REC_OK) {
+                if (r.state == FLOG_STATE_PENDING) {
+                    f->tail_sect = s;
+                    f->tail_off = off;
+                    return;
+                }
+                off += FLOG_REC_HDR + FLOG_ALIGN(r.len);
+            }
+        }
+        if (s == f->head_sect) break;
+        s = (s + 1) % f->nsect;
+        off = FLOG_HDR_LEN;
+    }
+    f->pending = 0;         // no quedaba ninguno legible
+}
+
+// Borra el sector s y lo abre como nueva cabeza
+static inline int flog_open_sect(flog_t *f, uint32_t s, uint32_t seq, uint32_t erases)
+{
+    if (f->io.erase(f->io.ctx, flog_addr(s, 0), FLOG_SECTOR) != 0) return FLOG_ERR_IO;
+    f->erases++;
+
+    flog_sect_hdr_t h = { .magic = FLOG_MAGIC, .seq = seq, .erases = erases + 1, .pad = 0xFFFF };
+    h.crc = flog_crc16(0xFFFF, (const uint8_t *)&h, 12);
+    if (f->io.write(f->io.ctx, flog_addr(s, 0), &h, sizeof(h)) != 0) return FLOG_ERR_IO;
+
+    f->head_sect = s;
+    f->head_seq = seq;
+    f->head_off = FLOG_HDR_LEN;
+    return FLOG_OK;
+}
+
+// Avanza la cabeza al siguiente sector del anillo
+static inline int flog_next_sect(flog_t *f)
+{
+    uint32_t s = (f->head_sect + 1) % f->nsect;
+    uint32_t erases = 0;
+    flog_sect_hdr_t old;
+
+    if (flog_read_sect(f, s, &old)) {
+        erases = old.erases;
+        uint32_t lost = 0;
+        flog_scan_sect(f, s, &lost, NULL);
+        if (lost > 0) {
+            f->pending -= lost;
+            f->dropped += lost;
+        }
+    }
+    int err = flog_open_sect(f, s, f->head_seq + 1, erases);
+    if (err != FLOG_OK) return err;
+
+    // Si el más antiguo estaba en el sector reciclado, pasa al siguiente
+    if (f->pending > 0 && f->tail_sect == s) flog_seek_pending(f, (s + 1) % f->nsect, FLOG_HDR_LEN);
+    return FLOG_OK;
+}
+
+// Reconstruye cabeza, cola y pendientes a partir del contenido de la flash
+static inline int flog_mount(flog_t *f, const flog_io_t *io)
+{
+    *f = (flog_t){ .io = *io, .nsect = io->size / FLOG_SECTOR };
+    if (f->nsect < 2) return FLOG_ERR_SIZE;
+
+    bool any = false;
+    for (uint32_t s = 0; s < f->nsect; s++) {
+        flog_sect_hdr_t h;
+        if (!flog_read_sect(f, s, &h)) continue;
+        if (!any || (int32_t)(h.seq - f->head_seq) > 0) {
+            f->head_sect = s;
+            f->head_seq = h.seq;
+            any = true;
+        }
+    }
+    if (!any) return flog_open_sect(f, 0, 1, 0);
+
+    // Un registro roto cierra la cabeza: la siguiente escritura abre otro sector
+    flog_rec_status_t last;
+    f->head_off = flog_scan_sect(f, f->head_sect, NULL, &last);
+    if (last == FLOG_REC_BAD) f->head_off = FLOG_SECTOR;
+
+    uint32_t oldest = (f->head_sect + 1) % f->nsect;
+    for (uint32_t s = 0; s < f->nsect; s++) {
+        flog_sect_hdr_t h;
+        if (flog_read_sect(f, s, &h)) flog_scan_sect(f, s, &f->pending, NULL);
+    }
+    if (f->pending > 0) flog_seek_pending(f, oldest, FLOG_HDR_LEN);
+    return FLOG_OK;
+}
+
+static inline int flog_append(flog_t *f, const void *data, size_t len)
+{
+    if (len == 0 || len > FLOG_MAX_REC) return FLOG_ERR_SIZE;
+
+    uint32_t need = FLOG_REC_HDR + FLOG_ALIGN((uint32_t)len);
+    if (f->head_off + need > FLOG_SECTOR) {
+        int err = flog_next_sect(f);
+        if (err != FLOG_OK) return err;
+    }
+
+    flog_rec_hdr_t r = { .len = (uint16_t)len, .state = FLOG_STATE_PENDING, .pad = { 0xFF, 0xFF, 0xFF } };
+    r.crc = flog_crc16(flog_crc16(0xFFFF, (const uint8_t *)&r.len, 2), (const uint8_t *)data, len);
+
+    // Cabecera primero: un corte antes de acabar los datos deja el CRC mal
+    uint32_t addr = flog_addr(f->head_sect, f->head_off);
+    if (f->io.write(f->io.ctx, addr, &r, sizeof(r)) != 0 ||
+        f->io.write(f->io.ctx, addr + FLOG_REC_HDR, data, len) != 0) {
+        f->head_off = FLOG_SECTOR;      // no se vuelve a escribir en este sector
+        return FLOG_ERR_IO;
+    }
+
+    if (f->pending == 0) {
+        f->tail_sect = f->head_sect;
+        f->tail_off = f->head_off;
+    }
+    f->head_off += need;
+    f->pending++;
+    f->appended++;
+    return FLOG_OK;
+}
+
+// Copia el registro pendiente más antiguo sin consumirlo
+static inline int flog_peek(flog_t *f, void *buf, size_t max, size_t *len)
+{
+    if (f->pending == 0) return FLOG_EMPTY;
+
+    flog_sect_hdr_t h;
+    flog_rec_hdr_t r;
+    uint32_t addr = flog_addr(f->tail_sect, f->tail_off);
+    if (!flog_read_sect(f, f->tail_sect, &h)) return FLOG_ERR_IO;
+    if (f->io.read(f->io.ctx, addr, &r, sizeof(r)) != 0) return FLOG_ERR_IO;
+    if (r.len > max) return FLOG_ERR_SIZE;
+    if (f->io.read(f->io.ctx, addr + FLOG_REC_HDR, buf, r.len) != 0) return FLOG_ERR_IO;
+    *len = r.len;
+
+    f->peeked = true;
+    f->peek_sect = f->tail_sect;
+    f->peek_off = f->tail_off;
+    f->peek_seq = h.seq;
+    return FLOG_OK;
+}
+
+// Marca como enviado el registro devuelto por flog_peek. FLOG_STALE si ya
+// no está en la cola (su sector se ha reciclado y se contó en dropped).
+static inline int flog_ack(flog_t *f)
+{
+    if (!f->peeked) return FLOG_STALE;
+    f->peeked = false;
+    if (f->pending == 0) return FLOG_STALE;
+
+    flog_sect_hdr_t h;
+    if (f->tail_sect != f->peek_sect || f->tail_off != f->peek_off) return FLOG_STALE;
+    if (!flog_read_sect(f, f->tail_sect, &h)) return FLOG_ERR_IO;
+    if (h.seq != f->peek_seq) return FLOG_STALE;
+
+    flog_rec_hdr_t r;
+    uint32_t addr = flog_addr(f->tail_sect, f->tail_off);
+    if (f->io.read(f->io.ctx, addr, &r, sizeof(r)) != 0) return FLOG_ERR_IO;
+
+    uint8_t sent = FLOG_STATE_SENT;
+    if (f->io.write(f->io.ctx, addr + offsetof(flog_rec_hdr_t, state), &sent, 1) != 0) return FLOG_ERR_IO;
+
+    f->acked++;
+    if (--f->pending > 0) flog_seek_pending(f, f->tail_sect, f->tail_off + FLOG_REC_HDR + FLOG_ALIGN(r.len));
+    return FLOG_OK;
+}
+
+#ifdef ESP_PLATFORM
+#include "esp_partition.h"
+
+static int flog_esp_read(void *ctx, uint32_t off, void *buf, size_t len)
+{
+    return esp_partition_read((const esp_partition_t *)ctx, off, buf, len) == ESP_OK ? 0 : -1;
+}
+
+static int flog_esp_write(void *ctx, uint32_t off, const void *buf, size_t len)
+{
+    return esp_partition_write((const esp_partition_t *)ctx, off, buf, len) == ESP_OK ? 0 : -1;
+}
+
+static int flog_esp_erase(void *ctx, uint32_t off, size_t len)
+{
+    return esp_partition_erase_range((const esp_partition_t *)ctx, off, len) == ESP_OK ? 0 : -1;
+}
+
+// Monta el registro sobre la partición de datos con esa etiqueta (partitions.csv)
+static inline esp_err_t flog_mount_partition(flog_t *f, const char *label)
+{
+    const esp_partition_t *p = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    if (p == NULL) return ESP_ERR_NOT_FOUND;
+
+    flog_io_t io = {
+        .ctx = (void *)p,
+        .read = flog_esp_read,
+        .write = flog_esp_write,
+        .erase = flog_esp_erase,
+        .size = p->size - p->size % FLOG_SECTOR,
+    };
+    int err = flog_mount(f, &io);
+    if (err == FLOG_ERR_SIZE) return ESP_ERR_INVALID_SIZE;
+    return err == FLOG_OK ? ESP_OK : ESP_FAIL;
+}
+#endif
+
+#endif // FLASH_LOG_H
@@ -0,0 +1,158 @@
+// Salidas GPIO por registro con máscaras precalculadas (ESP32-C3)
+//
+// Sustituye a los GPIO_BASE / GPIO_OUT_W1TS que cada práctica redefinía y a
+// los gpio_set_level por pin: cualquier combinación de pines del banco (los
+// 22 GPIO del C3 caben en un registro de 32 bits) se cambia con una escritura
+// en W1TC y otra en W1TS, sin leer-modificar-escribir y sin llamadas.
+//
+// Las máscaras de pines constantes se pliegan en compilación
+// (GPIO_FAST_MASK4, GPIO_FAST_PATTERN4). Para secuencias cuyos pines llegan
+// en tiempo de ejecución (p. ej. las bobinas del paso a paso) se construye
+// una tabla de patrones una sola vez con gpio_fast_pattern_build: cada
+// entrada ya lleva su máscara de set y de clear, y aplicar un paso completo
+// de cuatro bobinas son dos escrituras.
+//
+// Fuera del ESP32 (sin ESP_PLATFORM) los registros son una estructura en RAM
+// (gpio_fast_mock) que aplica W1TS/W1TC sobre OUT y apunta cada escritura con
+// la hora simulada now_us, de modo que las secuencias y sus tiempos se pueden
+// comprobar en el host con gcc -I common.
+//
+// Uso:
+//     #define LED_MASK GPIO_FAST_BIT(2)
+//     gpio_fast_output_enable(LED_MASK);
+//     gpio_fast_set(LED_MASK);
+//     gpio_fast_clear(LED_MASK);
+#ifndef GPIO_FAST_H
+#define GPIO_FAST_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define GPIO_FAST_BIT(pin)              (1u << (pin))
+#define GPIO_FAST_MASK4(a, b, c, d)     (GPIO_FAST_BIT(a) | GPIO_FAST_BIT(b) | GPIO_FAST_BIT(c) | GPIO_FAST_BIT(d))
+
+// Offsets dentro del bloque GPIO (TRM del ESP32-C3, cap. 5)
+#define GPIO_FAST_OUT           0x04
+#define GPIO_FAST_OUT_W1TS      0x08
+#define GPIO_FAST_OUT_W1TC      0x0C
+#define GPIO_FAST_ENABLE_W1TS   0x24
+#define GPIO_FAST_ENABLE_W1TC   0x28
+
+// Estado de un grupo de pines: qué bits se ponen a 1 y cuáles a 0
+typedef struct {
+    uint32_t set;
+    uint32_t clr;
+} gpio_fast_pattern_t;
+
+// Patrón constante: bit n de bits -> pin pn
+#define GPIO_FAST_PATTERN4(bits, p0, p1, p2, p3)                                                          \
+    ((gpio_fast_pattern_t){                                                                               \
+        .set = (((bits) & 1) ? GPIO_FAST_BIT(p0) : 0) | (((bits) & 2) ? GPIO_FAST_BIT(p1) : 0) |          \
+               (((bits) & 4) ? GPIO_FAST_BIT(p2) : 0) | (((bits) & 8) ? GPIO_FAST_BIT(p3) : 0),           \
+        .clr = (((bits) & 1) ? 0 : GPIO_FAST_BIT(p0)) | (((bits) & 2) ? 0 : GPIO_FAST_BIT(p1)) |          \
+               (((bits) & 4) ? 0 : GPIO_FAST_BIT(p2)) | (((bits) & 8) ? 0 : GPIO_FAST_BIT(p3)) })
+
+// Convierte una secuencia de n estados (bit k = pins[k]) en una tabla de patrones
+static inline void gpio_fast_pattern_build(gpio_fast_pattern_t *out, const uint8_t *bits, size_t n,
+                                           const int *pins, size_t npins)
+{
+    for (size_t i = 0; i < n; i++) {
+        out[i] = (gpio_fast_pattern_t){ 0, 0 };
+        for (size_t k = 0; k < npins; k++) {
+            if ((bits[i] >> k) & 1) out[i].set |= GPIO_FAST_BIT(pins[k]);
+            else out[i].clr |= GPIO_FAST_BIT(pins[k]);
+        }
+    }
+}
+
+#ifdef ESP_PLATFORM
+#include "soc/reg_base.h"
+
+#define GPIO_FAST_REG(off)      (*(volatile uint32_t *)(DR_REG_GPIO_BASE + (off)))
+
+static inline __attribute__((always_inline)) void gpio_fast_reg_write(uint32_t off, uint32_t v)
+{
+    GPIO_FAST_REG(off) = v;
+}
+
+static inline __attribute__((always_inline)) uint32_t gpio_fast_reg_read(uint32_t off)
+{
+    return GPIO_FAST_REG(off);
+}
+#else
+// Registros simulados para el host
+#define GPIO_FAST_MOCK_LOG      256
+
+typedef struct {
+    uint32_t reg;           // offset escrito
+    uint32_t val;
+    uint32_t out;           // OUT tras la escritura
+    uint64_t t_us;
+} gpio_fast_mock_write_t;
+
+typedef struct {
+    uint32_t out;
+    uint32_t enable;
+    uint64_t now_us;        // la avanza la prueba (temporizador simulado)
+    uint32_t writes;        // total; el registro guarda las GPIO_FAST_MOCK_LOG últimas
+    gpio_fast_mock_write_t log[GPIO_FAST_MOCK_LOG];
+} gpio_fast_mock_t;
+
+static gpio_fast_mock_t gpio_fast_mock;
+
+static inline void gpio_fast_reg_write(uint32_t off, uint32_t v)
+{
+    gpio_fast_mock_t *m = &gpio_fast_mock;
+    switch (off) {
+    case GPIO_FAST_OUT:         m->out = v; break;
+    case GPIO_FAST_OUT_W1TS:    m->out |= v; break;
+    case GPIO_FAST_OUT_W1TC:    m->out &= ~v; break;
+    case GPIO_FAST_ENABLE_W1TS: m->enable |= v; break;
+    case GPIO_FAST_ENABLE_W1TC: m->enable &= ~v; break;
+    }
+    m->log[m->writes % GPIO_FAST_MOCK_LOG] = (gpio_fast_mock_write_t){ off, v, m->out, m->now_us };
+    m->writes++;
+}
+
+static inline uint32_t gpio_fast_reg_read(uint32_t off)
+{
+    return off == GPIO_FAST_OUT ? gpio_fast_mock.out : 0;
+}
+
+static inline void gpio_fast_mock_reset(void)
+{
+    gpio_fast_mock = (gpio_fast_mock_t){ 0 };
+}
+#endif
+
+// Sólo el banco de salida: los pines tienen que estar ya en función GPIO
+// (lo están por defecto casi todos; si no, gpio_config o gpio_iomux_out)
+static inline void gpio_fast_output_enable(uint32_t mask)
+{
+    gpio_fast_reg_write(GPIO_FAST_ENABLE_W1TS, mask);
+}
+
+static inline void gpio_fast_set(uint32_t mask)
+{
+    gpio_fast_reg_write(GPIO_FAST_OUT_W1TS, mask);
+}
+
+static inline void gpio_fast_clear(uint32_t mask)
+{
+    gpio_fast_reg_write(GPIO_FAST_OUT_W1TC, mask);
+}
+
+// Aplica un patrón: primero apaga y luego enciende, así un cambio de bobina
+// nunca deja momentáneamente más bobinas activas que las de los dos estados
+static inline void gpio_fast_write(gpio_fast_pattern_t p)
+{
+    if (p.clr) gpio_fast_reg_write(GPIO_FAST_OUT_W1TC, p.clr);
+    if (p.set) gpio_fast_reg_write(GPIO_FAST_OUT_W1TS, p.set);
+}
+
+static inline uint32_t gpio_fast_out(void)
+{
+    return gpio_fast_reg_read(GPIO_FAST_OUT);
+}
+
+#endif // GPIO_FAST_H
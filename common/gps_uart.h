@@ -0,0 +1,162 @@
+// Ingesta del GPS por la cola de eventos del driver UART (sólo ESP32)
+//
+// En modo NMEA se habilita la detección de patrón por hardware sobre '\n': el
+// driver genera un evento UART_PATTERN_DET por cada trama completa y se lee
+// exactamente esa trama del ring buffer, sin timeouts de lectura ni búsqueda
+// byte a byte. En modo binario (UBX) no hay terminador y se entregan los
+// bloques de cada evento UART_DATA en cuanto llegan.
+//
+// Uso:
+//     gps_uart_t gps;
+//     gps_uart_install(&gps, UART_NUM_1, &uart_config, TX, RX, 2048, false);
+//     while (1) {
+//         int n = gps_uart_read(&gps, buf, sizeof(buf), portMAX_DELAY);
+//         for (int i = 0; i < n; i++) nmea_feed(&parser, buf[i], &msg);
+//     }
+#ifndef GPS_UART_H
+#define GPS_UART_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "driver/uart.h"
+#include "esp_timer.h"
+
+#define GPS_UART_EVT_QUEUE_LEN   20
+#define GPS_UART_PATTERN_CHR     '\n'
+
+typedef struct {
+    uint32_t sentences;     // tramas (o bloques en modo binario) entregadas
+    uint32_t fifo_ovf;      // desbordamientos de la FIFO hardware
+    uint32_t buffer_full;   // ring buffer del driver lleno
+    uint32_t pattern_ovf;   // cola de posiciones de patrón llena
+    uint32_t line_ovf;      // trama más larga que el buffer del llamante
+
+    // Latencia aprox. por trama: primer evento de la trama -> entrega
+    uint32_t lat_last_us;
+    uint32_t lat_max_us;
+    uint64_t lat_sum_us;
+} gps_uart_stats_t;
+
+typedef struct {
+    uart_port_t      uart;
+    QueueHandle_t    queue;
+    bool             binary;
+    int64_t          t_first;   // instante del primer evento de la trama en curso
+    gps_uart_stats_t stats;
+} gps_uart_t;
+
+// Instala el driver con cola de eventos, configura la UART y, en modo NMEA,
+// activa la detección de '\n' (debe hacerse tras uart_param_config)
+static inline esp_err_t gps_uart_install(gps_uart_t *g, uart_port_t uart, const uart_config_t *cfg,
+                                         int tx_pin, int rx_pin, int rx_buf_size, bool binary)
+{
+    *g = (gps_uart_t){ .uart = uart, .binary = binary };
+
+    esp_err_t err = uart_driver_install(uart, rx_buf_size, 0, GPS_UART_EVT_QUEUE_LEN, &g->queue, 0);
+    if (err != ESP_OK) return err;
+    err = uart_param_config(uart, cfg);
+    if (err != ESP_OK) return err;
+    err = uart_set_pin(uart, tx_pin, rx_pin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+    if (err != ESP_OK) return err;
+    if (binary) return ESP_OK;
+
+    err = uart_enable_pattern_det_baud_intr(uart, GPS_UART_PATTERN_CHR, 1, 9, 0, 0);
+    if (err != ESP_OK) return err;
+    return uart_pattern_queue_reset(uart, GPS_UART_EVT_QUEUE_LEN);
+}
+
+static inline void gps_uart_latency(gps_uart_t *g)
+{
+    int64_t now = esp_timer_get_time();
+    uint32_t lat = (g->t_first > 0) ? (uint32_t)(now - g->t_first) : 0;
+    g->stats.lat_last_us = lat;
+    g->stats.lat_sum_us += lat;
+    if (lat > g->stats.lat_max_us) g->stats.lat_max_us = lat;
+    g->stats.sentences++;
+    g->t_first = 0;
+}
+
+static inline void gps_uart_recover(gps_uart_t *g)
+{
+    uart_flush_input(g->uart);
+    xQueueReset(g->queue);
+    if (!g->binary) uart_pattern_queue_reset(g->uart, GPS_UART_EVT_QUEUE_LEN);
+    g->t_first = 0;
+}
+
+// Bloquea hasta tener una trama completa (modo NMEA, incluye el '\n') o un
+// bloque de datos (modo binario). Devuelve el número de bytes copiados en buf
+// o 0 si vence el timeout.
+static inline int gps_uart_read(gps_uart_t *g, uint8_t *buf, size_t size, TickType_t timeout)
+{
+    uart_event_t evt;
+
+    while (xQueueReceive(g->queue, &evt, timeout) == pdTRUE) {
+        if (g->t_first == 0) g->t_first = esp_timer_get_time();
+
+        switch (evt.type) {
+        case UART_DATA:
+            if (g->binary) {
+                size_t n = evt.size < size ? evt.size : size;
+                int len = uart_read_bytes(g->uart, buf, n, 0);
+                if (len > 0) {
+                    gps_uart_latency(g);
+                    return len;
+                }
+            }
+            break;
+
+        case UART_PATTERN_DET: {
+            int pos = uart_pattern_pop_pos(g->uart);
+            if (pos < 0) {
+                // Se perdieron posiciones: no se puede delimitar la trama
+                g->stats.pattern_ovf++;
+                gps_uart_recover(g);
+                break;
+            }
+            size_t len = (size_t)pos + 1;
+            if (len > size) {
+                // Trama demasiado larga: se descarta del ring buffer
+                g->stats.line_ovf++;
+                while (len > 0) {
+                    size_t chunk = len < size ? len : size;
+                    uart_read_bytes(g->uart, buf, chunk, 0);
+                    len -= chunk;
+                }
+                g->t_first = 0;
+                break;
+            }
+            int n = uart_read_bytes(g->uart, buf, len, 0);
+            if (n > 0) {
+                gps_uart_latency(g);
+                return n;
+            }
+            break;
+        }
+
+        case UART_FIFO_OVF:
+            g->stats.fifo_ovf++;
+            gps_uart_recover(g);
+            break;
+
+        case UART_BUFFER_FULL:
+            g->stats.buffer_full++;
+            gps_uart_recover(g);
+            break;
+
+        default:
+            break;
+        }
+    }
+    return 0;
+}
+
+static inline uint32_t gps_uart_lat_avg_us(const gps_uart_stats_t *s)
+{
+    return s->sentences ? (uint32_t)(s->lat_sum_us / s->sentences) : 0;
+}
+
+#endif // GPS_UART_H
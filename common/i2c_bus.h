@@ -0,0 +1,205 @@
+// Gestor de bus I2C compartido sobre la API i2c_master de ESP-IDF (sólo ESP32)
+//
+// Un único bus (i2c_master_bus) con handles persistentes por dispositivo
+// (i2c_master_dev): no se crea ni se libera nada por transacción. Todas las
+// transacciones pasan por una tarea dueña del bus que atiende dos colas
+// de prioridad; la alta (p. ej. el FIFO del LSM6DS33) siempre se sirve antes
+// que la baja (p. ej. el BMP280), así que varios sensores comparten
+// I2C_NUM_0 a 400 kHz sin que uno bloquee al otro.
+//
+// Cada dispositivo tiene su propio semáforo de fin de transacción (creado al
+// registrarlo) y admite una transacción en curso a la vez: debe usarlo una
+// sola tarea. Se cuentan transacciones, errores y latencia (encolado +
+// transferencia) por dispositivo.
+//
+// Uso:
+//     static i2c_bus_t bus;
+//     static i2c_bus_dev_t imu;
+//     i2c_bus_init(&bus, I2C_NUM_0, SDA, SCL, 100);
+//     i2c_bus_add_device(&bus, &imu, "lsm6", 0x6B, 400000, I2C_BUS_PRIO_HIGH);
+//     i2c_bus_read_reg(&imu, REG, buf, len);
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "driver/i2c_master.h"
+#include "esp_timer.h"
+
+#define I2C_BUS_QUEUE_LEN       8
+#define I2C_BUS_TASK_PRIO       (configMAX_PRIORITIES - 2)
+#define I2C_BUS_TASK_STACK      3072
+
+typedef enum {
+    I2C_BUS_PRIO_LOW = 0,
+    I2C_BUS_PRIO_HIGH,
+    I2C_BUS_PRIO_COUNT,
+} i2c_bus_prio_t;
+
+typedef struct {
+    uint32_t transactions;
+    uint32_t errors;            // NACK, timeout del driver, etc.
+    uint32_t queue_full;        // no se pudo encolar a tiempo
+    uint32_t lat_last_us;
+    uint32_t lat_max_us;
+    uint64_t lat_sum_us;
+} i2c_bus_dev_stats_t;
+
+struct i2c_bus;
+
+typedef struct {
+    struct i2c_bus          *bus;
+    i2c_master_dev_handle_t  dev;
+    const char              *name;
+    uint16_t                 addr;
+    i2c_bus_prio_t           prio;
+    SemaphoreHandle_t        done;
+    StaticSemaphore_t        done_buf;
+
+    // Transacción en curso (la rellena el llamante, la ejecuta la tarea del bus)
+    const uint8_t           *tx;
+    size_t                   tx_len;
+    uint8_t                 *rx;
+    size_t                   rx_len;
+    esp_err_t                result;
+
+    i2c_bus_dev_stats_t      stats;
+} i2c_bus_dev_t;
+
+typedef struct i2c_bus {
+    i2c_master_bus_handle_t  handle;
+    QueueHandle_t            q[I2C_BUS_PRIO_COUNT];
+    SemaphoreHandle_t        pending;   // transacciones encoladas en total
+    int                      timeout_ms;
+} i2c_bus_t;
+
+static void i2c_bus_task(void *arg)
+{
+    i2c_bus_t *b = (i2c_bus_t *)arg;
+
+    while (1) {
+        xSemaphoreTake(b->pending, portMAX_DELAY);
+
+        // Siempre se mira primero la cola de prioridad alta
+        i2c_bus_dev_t *d = NULL;
+        for (int p = I2C_BUS_PRIO_COUNT - 1; p >= 0 && d == NULL; p--) {
+            if (xQueueReceive(b->q[p], &d, 0) != pdTRUE) d = NULL;
+        }
+        if (d == NULL) continue;
+
+        if (d->rx_len > 0) {
+            d->result = i2c_master_transmit_receive(d->dev, d->tx, d->tx_len, d->rx, d->rx_len, b->timeout_ms);
+        } else {
+            d->result = i2c_master_transmit(d->dev, d->tx, d->tx_len, b->timeout_ms);
+        }
+        xSemaphoreGive(d->done);
+    }
+}
+
+static inline esp_err_t i2c_bus_init(i2c_bus_t *b, i2c_port_num_t port, gpio_num_t sda, gpio_num_t scl,
+                                     int timeout_ms)
+{
+    i2c_master_bus_config_t cfg = {
+        .i2c_port = port,
+        .sda_io_num = sda,
+        .scl_io_num = scl,
+        .clk_source = I2C_CLK_SRC_DEFAULT,
+        .glitch_ignore_cnt = 7,
+        .flags.enable_internal_pullup = true,
+    };
+    *b = (i2c_bus_t){ .timeout_ms = timeout_ms };
+
+    esp_err_t err = i2c_new_master_bus(&cfg, &b->handle);
+    if (err != ESP_OK) return err;
+
+    for (int p = 0; p < I2C_BUS_PRIO_COUNT; p++) {
+        b->q[p] = xQueueCreate(I2C_BUS_QUEUE_LEN, sizeof(i2c_bus_dev_t *));
+        if (b->q[p] == NULL) return ESP_ERR_NO_MEM;
+    }
+    b->pending = xSemaphoreCreateCounting(I2C_BUS_QUEUE_LEN * I2C_BUS_PRIO_COUNT, 0);
+    if (b->pending == NULL) return ESP_ERR_NO_MEM;
+
+    if (xTaskCreate(i2c_bus_task, "i2c_bus", I2C_BUS_TASK_STACK, b, I2C_BUS_TASK_PRIO, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+// ¿Responde alguien en addr? Va directo al driver (sólo para la detección inicial).
+static inline esp_err_t i2c_bus_probe(i2c_bus_t *b, uint16_t addr)
+{
+    return i2c_master_probe(b->handle, addr, b->timeout_ms);
+}
+
+static inline esp_err_t i2c_bus_add_device(i2c_bus_t *b, i2c_bus_dev_t *d, const char *name, uint16_t addr,
+                                           uint32_t scl_hz, i2c_bus_prio_t prio)
+{
+    i2c_device_config_t cfg = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = addr,
+        .scl_speed_hz = scl_hz,
+    };
+    *d = (i2c_bus_dev_t){ .bus = b, .name = name, .addr = addr, .prio = prio };
+
+    esp_err_t err = i2c_master_bus_add_device(b->handle, &cfg, &d->dev);
+    if (err != ESP_OK) return err;
+    d->done = xSemaphoreCreateBinaryStatic(&d->done_buf);
+    return ESP_OK;
+}
+
+static inline esp_err_t i2c_bus_rm_device(i2c_bus_dev_t *d)
+{
+    return i2c_master_bus_rm_device(d->dev);
+}
+
+// Escribe tx y, si rx_len > 0, lee rx con START repetido. Bloquea hasta que
+// la tarea del bus completa la transacción.
+static inline esp_err_t i2c_bus_xfer(i2c_bus_dev_t *d, const uint8_t *tx, size_t tx_len, uint8_t *rx, size_t rx_len)
+{
+    i2c_bus_t *b = d->bus;
+    int64_t t0 = esp_timer_get_time();
+
+    d->tx = tx;
+    d->tx_len = tx_len;
+    d->rx = rx;
+    d->rx_len = rx_len;
+
+    if (xQueueSend(b->q[d->prio], &d, pdMS_TO_TICKS(b->timeout_ms)) != pdTRUE) {
+        d->stats.queue_full++;
+        return ESP_ERR_TIMEOUT;
+    }
+    xSemaphoreGive(b->pending);
+    // El driver ya limita la transferencia a timeout_ms: la respuesta siempre llega
+    xSemaphoreTake(d->done, portMAX_DELAY);
+
+    uint32_t lat = (uint32_t)(esp_timer_get_time() - t0);
+    d->stats.transactions++;
+    if (d->result != ESP_OK) d->stats.errors++;
+    d->stats.lat_last_us = lat;
+    d->stats.lat_sum_us += lat;
+    if (lat > d->stats.lat_max_us) d->stats.lat_max_us = lat;
+    return d->result;
+}
+
+static inline esp_err_t i2c_bus_read_reg(i2c_bus_dev_t *d, uint8_t reg, uint8_t *data, size_t len)
+{
+    return i2c_bus_xfer(d, &reg, 1, data, len);
+}
+
+static inline esp_err_t i2c_bus_write_u8(i2c_bus_dev_t *d, uint8_t reg, uint8_t val)
+{
+    uint8_t buf[2] = { reg, val };
+    return i2c_bus_xfer(d, buf, sizeof(buf), NULL, 0);
+}
+
+static inline uint32_t i2c_bus_lat_avg_us(const i2c_bus_dev_stats_t *s)
+{
+    return s->transactions ? (uint32_t)(s->lat_sum_us / s->transactions) : 0;
+}
+
+#endif // I2C_BUS_H
@@ -0,0 +1,243 @@
+// Calibración en línea del IMU (offsets de giroscopio y acelerómetro)
+//
+// Sustituye a la calibración bloqueante del arranque. Las muestras crudas
+// del FIFO se agrupan en ventanas; en cada una se acumulan suma y suma de
+// cuadrados por eje en enteros (exactas en int64, sin float por muestra).
+// Si al cerrar la ventana la varianza de todos los ejes es pequeña, el
+// sensor está quieto y su media actualiza los offsets:
+//   - giroscopio: siempre que la media sea plausible como sesgo
+//   - acelerómetro: sólo si además está horizontal (X, Y ~ 0 g, Z ~ 1 g)
+// La primera ventana quieta fija los offsets; las siguientes los corrigen
+// con un filtro de primer orden (IMU_CAL_BLEND), así que siguen la deriva
+// térmica sin saltos.
+//
+// Los offsets se guardan en NVS junto con la temperatura a la que se
+// midieron. Al arrancar se cargan y la fusión empieza con ellos de
+// inmediato; si la temperatura actual difiere más de IMU_CAL_TEMP_MAX_C100,
+// se usan igualmente pero la siguiente ventana quieta los reemplaza en
+// lugar de promediarse con ellos. La parte de NVS sólo se compila en el
+// ESP32 (ESP_PLATFORM).
+//
+// Uso:
+//     imu_cal_t cal;
+//     imu_cal_init(&cal, 416, 16393, 114);
+//     imu_cal_load(&cal, temp_c100);
+//     for (...) if (imu_cal_add(&cal, s.g, s.a, temp_c100)) { ... cal.off ... }
+//     if (imu_cal_should_save(&cal)) imu_cal_save(&cal);
+#ifndef IMU_CAL_H
+#define IMU_CAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#define IMU_CAL_AXES            6       // gx gy gz ax ay az
+#define IMU_CAL_BLEND           0.25f   // peso de cada ventana quieta nueva
+#define IMU_CAL_TEMP_MAX_C100   1000    // 10 °C: por encima, los offsets guardados se reemplazan
+#define IMU_CAL_SAVE_GYRO_LSB   20      // cambios mínimos para volver a escribir en flash
+#define IMU_CAL_SAVE_ACC_LSB    50
+#define IMU_CAL_SAVE_TEMP_C100  200
+
+typedef struct {
+    // Configuración (LSB)
+    uint32_t window;            // muestras por ventana
+    int32_t  one_g;             // LSB de 1 g
+    int64_t  gyro_var_max;      // LSB^2
+    int64_t  acc_var_max;       // LSB^2
+    int32_t  gyro_mean_max;     // sesgo máximo creíble
+    int32_t  acc_level_max;     // tolerancia para considerar el sensor horizontal
+
+    // Ventana en curso
+    uint32_t n;
+    int32_t  sum[IMU_CAL_AXES];
+    int64_t  sum_sq[IMU_CAL_AXES];
+
+    // Resultado: offsets en LSB (az ya sin el 1 g)
+    float    off[IMU_CAL_AXES];
+    int16_t  temp_c100;         // temperatura de la última actualización
+    bool     gyro_valid;
+    bool     acc_valid;
+    bool     stale;             // cargados de NVS a otra temperatura
+
+    // Último estado escrito en flash
+    float    saved_off[IMU_CAL_AXES];
+    int16_t  saved_temp_c100;
+    bool     saved;
+
+    uint32_t still_windows;
+    uint32_t moving_windows;
+} imu_cal_t;
+
+// rate_hz: muestras por segundo (una ventana = 1 s); one_g / one_dps en LSB
+// para el fondo de escala configurado
+static inline void imu_cal_init(imu_cal_t *c, uint32_t rate_hz, int32_t one_g, int32_t one_dps)
+{
+    int64_t g_sd = one_dps;         // 1 dps de desviación típica
+    int64_t a_sd = one_g / 50;      // 20 mg
+    *c = (imu_cal_t){
+        .window = rate_hz,
+        .one_g = one_g,
+        .gyro_var_max = g_sd * g_sd,
+        .acc_var_max = a_sd * a_sd,
+        .gyro_mean_max = 10 * one_dps,
+        .acc_level_max = one_g / 10,
+    };
+}
+
+static inline float imu_cal_update_off(float old, float mean, bool replace)
+{
+    return replace ? mean : old + IMU_CAL_BLEND * (mean - old);
+}
+
+// Cierra la ventana; devuelve true si los offsets han cambiado
+static inline bool imu_cal_close_window(imu_cal_t *c, int16_t temp_c100)
+{
+    int64_t n = c->n;
+    bool still = true;
+
+    // var * n^2 = n * sum_sq - sum^2 (exacto en enteros)
+    for (int k = 0; k < IMU_CAL_AXES && still; k++) {
+        int64_t var_n2 = n * c->sum_sq[k] - (int64_t)c->sum[k] * c->sum[k];
+        int64_t max = (k < 3) ? c->gyro_var_max : c->acc_var_max;
+        if (var_n2 > max * n * n) still = false;
+    }
+    if (!still) {
+        c->moving_windows++;
+        return false;
+    }
+    c->still_windows++;
+
+    float mean[IMU_CAL_AXES];
+    for (int k = 0; k < IMU_CAL_AXES; k++) mean[k] = (float)c->sum[k] / (float)n;
+
+    bool changed = false;
+    bool gyro_ok = true;
+    for (int k = 0; k < 3; k++) {
+        if (abs((int)mean[k]) > c->gyro_mean_max) gyro_ok = false;
+    }
+    if (gyro_ok) {
+        bool replace = !c->gyro_valid || c->stale;
+        for (int k = 0; k < 3; k++) c->off[k] = imu_cal_update_off(c->off[k], mean[k], replace);
+        c->gyro_valid = true;
+        changed = true;
+    }
+
+    bool level = abs((int)mean[3]) < c->acc_level_max && abs((int)mean[4]) < c->acc_level_max &&
+                 abs((int)mean[5] - c->one_g) < c->acc_level_max;
+    if (level) {
+        bool replace = !c->acc_valid || c->stale;
+        mean[5] -= (float)c->one_g;
+        for (int k = 3; k < 6; k++) c->off[k] = imu_cal_update_off(c->off[k], mean[k], replace);
+        c->acc_valid = true;
+        changed = true;
+    }
+
+    if (changed) {
+        c->temp_c100 = temp_c100;
+        if (gyro_ok) c->stale = false;
+    }
+    return changed;
+}
+
+// Añade una muestra cruda (g y a en LSB). Devuelve true cuando una ventana
+// quieta acaba de actualizar los offsets.
+static inline bool imu_cal_add(imu_cal_t *c, const int16_t g[3], const int16_t a[3], int16_t temp_c100)
+{
+    for (int k = 0; k < 3; k++) {
+        c->sum[k] += g[k];
+        c->sum_sq[k] += (int32_t)g[k] * g[k];
+        c->sum[3 + k] += a[k];
+        c->sum_sq[3 + k] += (int32_t)a[k] * a[k];
+    }
+    if (++c->n < c->window) return false;
+
+    bool changed = imu_cal_close_window(c, temp_c100);
+    c->n = 0;
+    for (int k = 0; k < IMU_CAL_AXES; k++) {
+        c->sum[k] = 0;
+        c->sum_sq[k] = 0;
+    }
+    return changed;
+}
+
+// ¿Han cambiado lo bastante los offsets (o la temperatura) desde la última
+// escritura como para justificar otra? Limita el desgaste de la flash.
+static inline bool imu_cal_should_save(const imu_cal_t *c)
+{
+    if (!c->gyro_valid) return false;
+    if (!c->saved) return true;
+    if (abs(c->temp_c100 - c->saved_temp_c100) > IMU_CAL_SAVE_TEMP_C100) return true;
+    for (int k = 0; k < IMU_CAL_AXES; k++) {
+        float d = c->off[k] - c->saved_off[k];
+        float lim = (k < 3) ? IMU_CAL_SAVE_GYRO_LSB : IMU_CAL_SAVE_ACC_LSB;
+        if (d > lim || d < -lim) return true;
+    }
+    return false;
+}
+
+#ifdef ESP_PLATFORM
+#include <string.h>
+#include "nvs.h"
+
+#define IMU_CAL_NVS_NS          "imu_cal"
+#define IMU_CAL_NVS_KEY         "off"
+#define IMU_CAL_NVS_VERSION     1
+
+typedef struct {
+    uint16_t version;
+    int16_t  temp_c100;
+    uint8_t  acc_valid;
+    uint8_t  reserved[3];
+    float    off[IMU_CAL_AXES];
+} imu_cal_blob_t;
+
+// Carga los offsets guardados (nvs_flash_init ya hecho). temp_c100 es la
+// temperatura actual, para decidir si son de fiar.
+static inline esp_err_t imu_cal_load(imu_cal_t *c, int16_t temp_c100)
+{
+    nvs_handle_t h;
+    imu_cal_blob_t b;
+    size_t len = sizeof(b);
+
+    esp_err_t err = nvs_open(IMU_CAL_NVS_NS, NVS_READONLY, &h);
+    if (err != ESP_OK) return err;
+    err = nvs_get_blob(h, IMU_CAL_NVS_KEY, &b, &len);
+    nvs_close(h);
+    if (err != ESP_OK) return err;
+    if (len != sizeof(b) || b.version != IMU_CAL_NVS_VERSION) return ESP_ERR_INVALID_VERSION;
+
+    memcpy(c->off, b.off, sizeof(c->off));
+    memcpy(c->saved_off, b.off, sizeof(c->saved_off));
+    c->temp_c100 = c->saved_temp_c100 = b.temp_c100;
+    c->gyro_valid = true;
+    c->acc_valid = b.acc_valid != 0;
+    c->saved = true;
+    c->stale = abs(temp_c100 - b.temp_c100) > IMU_CAL_TEMP_MAX_C100;
+    return ESP_OK;
+}
+
+static inline esp_err_t imu_cal_save(imu_cal_t *c)
+{
+    nvs_handle_t h;
+    imu_cal_blob_t b = {
+        .version = IMU_CAL_NVS_VERSION,
+        .temp_c100 = c->temp_c100,
+        .acc_valid = c->acc_valid,
+    };
+    memcpy(b.off, c->off, sizeof(b.off));
+
+    esp_err_t err = nvs_open(IMU_CAL_NVS_NS, NVS_READWRITE, &h);
+    if (err != ESP_OK) return err;
+    err = nvs_set_blob(h, IMU_CAL_NVS_KEY, &b, sizeof(b));
+    if (err == ESP_OK) err = nvs_commit(h);
+    nvs_close(h);
+    if (err != ESP_OK) return err;
+
+    memcpy(c->saved_off, c->off, sizeof(c->saved_off));
+    c->saved_temp_c100 = c->temp_c100;
+    c->saved = true;
+    return ESP_OK;
+}
+#endif
+
+#endif // IMU_CAL_H
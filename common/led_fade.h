@@ -0,0 +1,286 @@
+// Salidas PWM con fundidos por hardware (LEDC) y curvas de gamma
+//
+// Sustituye al PWM por software de las prácticas 1 y 2 (bucles que
+// alternaban W1TS/W1TC con ets_delay_us y tenían la CPU al 100 %): el LEDC
+// genera la señal y hace los fundidos (ledc_set_fade_with_time) solo.
+//
+// Cada salida tiene una curva nivel -> duty precalculada al iniciar: gamma
+// perceptual para LEDs (el ojo no ve lineal el duty) o lineal para
+// actuadores y para el LED del PPG, donde importa el duty real. El
+// fundido del LEDC es lineal en duty, así que para seguir la curva se
+// trocea en tramos lineales (LED_FADE_SEGMENTS como máximo) y se encadenan
+// desde la interrupción de fin de fundido: unas pocas interrupciones por
+// fundido en lugar de un bucle ocupado.
+//
+// Una única tarea es dueña de todos los canales: recibe por una cola las
+// peticiones de las demás tareas y, por bits de su notificación (uno por
+// canal), los fines de tramo de la ISR; arranca el tramo siguiente y, al
+// terminar, llama al callback de la salida (en el contexto de esa tarea, no
+// en la ISR). Un bit de notificación no se pierde aunque la cola esté llena,
+// así que ningún fundido se queda a medias. Si llega una petición a mitad de
+// un fundido se atiende al acabar el tramo en curso, desde donde esté.
+//
+// La curva y el troceado no dependen de ESP-IDF; el motor sólo se compila
+// en el ESP32 (ESP_PLATFORM).
+//
+// Uso:
+//     static uint16_t gamma[256];
+//     led_gamma_build(gamma, 256, LED_FADE_DUTY_MAX(LEDC_TIMER_13_BIT), 2.2f);
+//     led_fade_start(4);
+//     led_fade_timer_init(LEDC_TIMER_0, 5000, LEDC_TIMER_13_BIT);
+//     led_out_config_t cfg = { .gpio = 2, .ch = LEDC_CHANNEL_0, .timer = LEDC_TIMER_0,
+//                              .curve = gamma, .nlevels = 256, .segments = 16 };
+//     led_out_init(&led, &cfg);
+//     led_out_fade(&led, 255, 3000);
+#ifndef LED_FADE_H
+#define LED_FADE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <math.h>
+
+#define LED_FADE_DUTY_MAX(res)  (1u << (res))   // duty del 100 % con res bits
+#define LED_FADE_SEGMENTS       16
+#define LED_FADE_MIN_SEG_MS     20              // tramos más cortos no compensan la interrupción
+
+// Curva nivel -> duty con duty = duty_max * (i / (n-1))^gamma (gamma 1 = lineal).
+// Se fuerza estrictamente creciente (si duty_max >= n) para que ningún tramo
+// de un fundido quede sin cambio de duty.
+static inline void led_gamma_build(uint16_t *tab, size_t n, uint32_t duty_max, float gamma)
+{
+    for (size_t i = 0; i < n; i++) {
+        float x = n > 1 ? (float)i / (float)(n - 1) : 1.0f;
+        uint32_t d = (uint32_t)((float)duty_max * powf(x, gamma) + 0.5f);
+        if (i > 0 && d <= tab[i - 1] && duty_max >= n) d = tab[i - 1] + 1u;
+        tab[i] = (uint16_t)(d > duty_max ? duty_max : d);
+    }
+    if (n > 0) tab[n - 1] = (uint16_t)duty_max;
+}
+
+// Número de tramos para ir de from a to en ms: no más que niveles a recorrer
+// ni tramos de menos de LED_FADE_MIN_SEG_MS
+static inline uint8_t led_fade_nseg(uint16_t from, uint16_t to, uint32_t ms, uint8_t max_seg)
+{
+    uint32_t span = from > to ? from - to : to - from;
+    uint32_t n = max_seg ? max_seg : 1;
+    if (n > span) n = span;
+    if (n > ms / LED_FADE_MIN_SEG_MS) n = ms / LED_FADE_MIN_SEG_MS;
+    return (uint8_t)(n ? n : 1);
+}
+
+// Nivel al final del tramo k (0..nseg-1) y su duración en ms
+static inline uint16_t led_fade_segment(uint16_t from, uint16_t to, uint32_t ms, uint8_t nseg, uint8_t k,
+                                        uint32_t *seg_ms)
+{
+    *seg_ms = ms * (k + 1u) / nseg - ms * k / nseg;
+    return (uint16_t)((int32_t)from + ((int32_t)to - from) * (int32_t)(k + 1) / nseg);
+}
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "driver/ledc.h"
+#include "esp_check.h"
+
+#define LED_FADE_MODE       LEDC_LOW_SPEED_MODE
+#define LED_FADE_QUEUE_LEN  16
+#define LED_FADE_NOTIFY_REQ (1u << 31)      // hay peticiones en la cola; bits 0..LEDC_CHANNEL_MAX-1: fin de tramo
+
+typedef struct led_out led_out_t;
+typedef void (*led_fade_done_cb_t)(led_out_t *o, uint16_t level, void *arg);
+
+typedef struct {
+    int                 gpio;
+    ledc_channel_t      ch;
+    ledc_timer_t        timer;
+    const uint16_t     *curve;      // nivel -> duty (led_gamma_build), debe seguir viva
+    uint16_t            nlevels;
+    uint8_t             segments;   // tramos máximos por fundido (1 = un fundido lineal en duty)
+    led_fade_done_cb_t  done;       // opcional, desde la tarea del motor
+    void               *done_arg;
+} led_out_config_t;
+
+struct led_out {
+    led_out_config_t cfg;
+    uint16_t level;                 // nivel al final del último tramo
+    uint16_t from, to;
+    uint32_t ms;
+    uint8_t  nseg, k;
+    bool     fading;
+    bool     pending;               // petición recibida a mitad de fundido
+    uint16_t pend_level;
+    uint32_t pend_ms;
+};
+
+// Petición de fundido de otra tarea
+typedef struct {
+    uint8_t  ch;
+    uint16_t level;
+    uint32_t ms;
+} led_fade_evt_t;
+
+typedef struct {
+    QueueHandle_t q;
+    TaskHandle_t  task;
+    led_out_t    *out[LEDC_CHANNEL_MAX];
+    uint32_t      segments;         // tramos arrancados (estadística)
+} led_fade_t;
+
+static led_fade_t s_led_fade;
+
+static bool IRAM_ATTR led_fade_isr(const ledc_cb_param_t *param, void *arg)
+{
+    led_out_t *o = arg;
+    BaseType_t woken = pdFALSE;
+
+    if (param->event == LEDC_FADE_END_EVT) {
+        xTaskNotifyFromISR(s_led_fade.task, 1u << o->cfg.ch, eSetBits, &woken);
+    }
+    return woken == pdTRUE;
+}
+
+static inline void led_fade_run_segment(led_out_t *o)
+{
+    uint32_t seg_ms;
+    uint16_t lvl = led_fade_segment(o->from, o->to, o->ms, o->nseg, o->k, &seg_ms);
+    ledc_set_fade_with_time(LED_FADE_MODE, o->cfg.ch, o->cfg.curve[lvl], (int)seg_ms);
+    ledc_fade_start(LED_FADE_MODE, o->cfg.ch, LEDC_FADE_NO_WAIT);
+    s_led_fade.segments++;
+}
+
+static inline void led_fade_finish(led_out_t *o)
+{
+    o->fading = false;
+    if (o->cfg.done) o->cfg.done(o, o->level, o->cfg.done_arg);
+}
+
+static inline void led_fade_begin(led_out_t *o, uint16_t level, uint32_t ms)
+{
+    if (level >= o->cfg.nlevels) level = o->cfg.nlevels - 1;
+    if (ms == 0 || level == o->level) {
+        ledc_set_duty(LED_FADE_MODE, o->cfg.ch, o->cfg.curve[level]);
+        ledc_update_duty(LED_FADE_MODE, o->cfg.ch);
+        o->level = level;
+        led_fade_finish(o);
+        return;
+    }
+    o->from = o->level;
+    o->to = level;
+    o->ms = ms;
+    o->nseg = led_fade_nseg(o->from, o->to, ms, o->cfg.segments);
+    o->k = 0;
+    o->fading = true;
+    led_fade_run_segment(o);
+}
+
+// Fin del tramo en curso de o: encadena el siguiente, la petición pendiente
+// o termina el fundido
+static inline void led_fade_seg_end(led_out_t *o)
+{
+    if (!o->fading) return;
+    uint32_t seg_ms;
+    o->level = led_fade_segment(o->from, o->to, o->ms, o->nseg, o->k, &seg_ms);
+    o->k++;
+    if (o->pending) {
+        o->pending = false;
+        o->fading = false;
+        led_fade_begin(o, o->pend_level, o->pend_ms);
+    } else if (o->k < o->nseg) {
+        led_fade_run_segment(o);
+    } else {
+        led_fade_finish(o);
+    }
+}
+
+static void led_fade_task(void *arg)
+{
+    led_fade_evt_t e;
+    uint32_t bits;
+
+    while (1) {
+        xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY);
+
+        for (int ch = 0; ch < LEDC_CHANNEL_MAX; ch++) {
+            if ((bits & (1u << ch)) && s_led_fade.out[ch] != NULL) led_fade_seg_end(s_led_fade.out[ch]);
+        }
+
+        while (xQueueReceive(s_led_fade.q, &e, 0) == pdTRUE) {
+            led_out_t *o = e.ch < LEDC_CHANNEL_MAX ? s_led_fade.out[e.ch] : NULL;
+            if (o == NULL) continue;
+            if (o->fading) {
+                o->pending = true;
+                o->pend_level = e.level;
+                o->pend_ms = e.ms;
+            } else {
+                led_fade_begin(o, e.level, e.ms);
+            }
+        }
+    }
+}
+
+// Instala el servicio de fundidos del LEDC y arranca la tarea del motor
+static inline esp_err_t led_fade_start(UBaseType_t prio)
+{
+    static const char *TAG = "led_fade";
+
+    if (s_led_fade.q != NULL) return ESP_OK;
+    ESP_RETURN_ON_ERROR(ledc_fade_func_install(0), TAG, "fade");
+    s_led_fade.q = xQueueCreate(LED_FADE_QUEUE_LEN, sizeof(led_fade_evt_t));
+    if (s_led_fade.q == NULL) return ESP_ERR_NO_MEM;
+    if (xTaskCreate(led_fade_task, "led_fade", 2560, NULL, prio, &s_led_fade.task) != pdPASS) return ESP_ERR_NO_MEM;
+    return ESP_OK;
+}
+
+// Temporizador LEDC compartido por las salidas con la misma frecuencia
+static inline esp_err_t led_fade_timer_init(ledc_timer_t timer, uint32_t freq_hz, ledc_timer_bit_t res)
+{
+    ledc_timer_config_t tc = {
+        .speed_mode = LED_FADE_MODE,
+        .duty_resolution = res,
+        .timer_num = timer,
+        .freq_hz = freq_hz,
+        .clk_cfg = LEDC_AUTO_CLK,
+    };
+    return ledc_timer_config(&tc);
+}
+
+// Configura el canal (apagado, nivel 0) y lo registra en el motor
+static inline esp_err_t led_out_init(led_out_t *o, const led_out_config_t *cfg)
+{
+    static const char *TAG = "led_fade";
+
+    if (s_led_fade.q == NULL || cfg->ch >= LEDC_CHANNEL_MAX || cfg->nlevels == 0) return ESP_ERR_INVALID_STATE;
+    *o = (led_out_t){ .cfg = *cfg };
+    ledc_channel_config_t cc = {
+        .gpio_num = cfg->gpio,
+        .speed_mode = LED_FADE_MODE,
+        .channel = cfg->ch,
+        .timer_sel = cfg->timer,
+        .duty = cfg->curve[0],
+    };
+    ESP_RETURN_ON_ERROR(ledc_channel_config(&cc), TAG, "canal");
+    ledc_cbs_t cbs = { .fade_cb = led_fade_isr };
+    ESP_RETURN_ON_ERROR(ledc_cb_register(LED_FADE_MODE, cfg->ch, &cbs, o), TAG, "callback");
+    s_led_fade.out[cfg->ch] = o;
+    return ESP_OK;
+}
+
+// Funde hasta level en ms (0 = inmediato). No bloquea; seguro desde
+// cualquier tarea. false si la cola de peticiones está llena.
+static inline bool led_out_fade(led_out_t *o, uint16_t level, uint32_t ms)
+{
+    led_fade_evt_t e = { .ch = (uint8_t)o->cfg.ch, .level = level, .ms = ms };
+    if (xQueueSend(s_led_fade.q, &e, 0) != pdTRUE) return false;
+    xTaskNotify(s_led_fade.task, LED_FADE_NOTIFY_REQ, eSetBits);
+    return true;
+}
+
+static inline bool led_out_set(led_out_t *o, uint16_t level)
+{
+    return led_out_fade(o, level, 0);
+}
+#endif
+
+#endif // LED_FADE_H
@@ -0,0 +1,117 @@
+// Vaciado del FIFO del LSM6DS33 (giroscopio + acelerómetro)
+//
+// El FIFO guarda palabras de 16 bits en un patrón fijo Gx Gy Gz XLx XLy XLz
+// (con la misma decimación para ambos sensores). FIFO_STATUS1..4 dan el
+// número de palabras sin leer y la posición en el patrón de la siguiente;
+// si se ha quedado a mitad de muestra (lectura anterior cortada, desbordamiento)
+// se descartan las palabras sueltas hasta el siguiente Gx y luego se leen
+// muestras enteras en ráfagas de FIFO_DATA_OUT.
+//
+// La lógica no toca el bus: recibe los cuatro bytes de estado y una función
+// que lee n bytes en ráfaga de FIFO_DATA_OUT_L (en el ESP32, una transacción
+// I2C con IF_INC; en las pruebas de host, un FIFO simulado).
+//
+// Uso:
+//     uint8_t st[4];                            // FIFO_STATUS1..4
+//     static uint8_t scratch[32 * LSM6_FIFO_SAMPLE_BYTES];
+//     int n = lsm6_fifo_drain(st, read_fifo, dev, scratch, 32, out, max, &overrun);
+#ifndef LSM6_FIFO_H
+#define LSM6_FIFO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define LSM6_FIFO_WORDS_PER_SAMPLE  6       // Gx Gy Gz XLx XLy XLz
+#define LSM6_FIFO_SAMPLE_BYTES      (2 * LSM6_FIFO_WORDS_PER_SAMPLE)
+#define LSM6_FIFO_MAX_WORDS         4096    // 8 KB; DIFF_FIFO sólo tiene 12 bits
+
+typedef struct {
+    int16_t g[3];   // giroscopio x, y, z (LSB)
+    int16_t a[3];   // acelerómetro x, y, z (LSB)
+} lsm6_sample_t;
+
+typedef struct {
+    uint16_t words;     // palabras sin leer (DIFF_FIFO)
+    uint16_t pattern;   // posición en el patrón de la siguiente palabra (0 = Gx)
+    bool     overrun;   // FIFO_OVER_RUN: se han perdido muestras
+    bool     full;      // FIFO_FULL
+    bool     wtm;       // watermark alcanzado
+} lsm6_fifo_status_t;
+
+// Lee len bytes seguidos de FIFO_DATA_OUT_L; false si falla el bus
+typedef bool (*lsm6_fifo_read_fn)(void *ctx, uint8_t *buf, size_t len);
+
+// Con el FIFO lleno DIFF_FIFO (12 bits) vale 0: se toma como LSM6_FIFO_MAX_WORDS,
+// si no el FIFO desbordado no se vaciaría nunca
+static inline lsm6_fifo_status_t lsm6_fifo_parse_status(const uint8_t st[4])
+{
+    lsm6_fifo_status_t s = {
+        .words   = (uint16_t)(((st[1] & 0x0F) << 8) | st[0]),
+        .pattern = (uint16_t)(((st[3] & 0x03) << 8) | st[2]),
+        .overrun = (st[1] & 0x40) != 0,
+        .full    = (st[1] & 0x20) != 0,
+        .wtm     = (st[1] & 0x80) != 0,
+    };
+    if (s.words == 0 && (s.full || s.overrun)) s.words = LSM6_FIFO_MAX_WORDS;
+    return s;
+}
+
+// Palabras a descartar para que la siguiente lectura empiece en Gx
+static inline int lsm6_fifo_skip_words(const lsm6_fifo_status_t *s)
+{
+    int p = s->pattern % LSM6_FIFO_WORDS_PER_SAMPLE;
+    int n = p ? LSM6_FIFO_WORDS_PER_SAMPLE - p : 0;
+    return n > s->words ? s->words : n;
+}
+
+static inline int16_t lsm6_le16(const uint8_t *p)
+{
+    return (int16_t)((uint16_t)p[0] | ((uint16_t)p[1] << 8));
+}
+
+// n muestras enteras en crudo (little-endian, empezando en Gx) -> out
+static inline void lsm6_fifo_unpack(const uint8_t *raw, int n, lsm6_sample_t *out)
+{
+    for (int i = 0; i < n; i++) {
+        const uint8_t *b = &raw[i * LSM6_FIFO_SAMPLE_BYTES];
+        out[i].g[0] = lsm6_le16(&b[0]);
+        out[i].g[1] = lsm6_le16(&b[2]);
+        out[i].g[2] = lsm6_le16(&b[4]);
+        out[i].a[0] = lsm6_le16(&b[6]);
+        out[i].a[1] = lsm6_le16(&b[8]);
+        out[i].a[2] = lsm6_le16(&b[10]);
+    }
+}
+
+// Vacía como mucho max muestras en out a partir del estado st, leyendo en
+// ráfagas de hasta burst muestras sobre scratch (burst * LSM6_FIFO_SAMPLE_BYTES
+// bytes). Devuelve el número de muestras o -1 si falla una lectura.
+static inline int lsm6_fifo_drain(const uint8_t st[4], lsm6_fifo_read_fn read, void *ctx, uint8_t *scratch,
+                                  int burst, lsm6_sample_t *out, int max, bool *overrun)
+{
+    lsm6_fifo_status_t s = lsm6_fifo_parse_status(st);
+    int words = s.words;
+    *overrun = s.overrun;
+
+    // Alinear al inicio de muestra descartando palabras sueltas
+    int skip = lsm6_fifo_skip_words(&s);
+    if (skip > 0) {
+        if (!read(ctx, scratch, 2 * (size_t)skip)) return -1;
+        words -= skip;
+    }
+
+    int samples = words / LSM6_FIFO_WORDS_PER_SAMPLE;
+    if (samples > max) samples = max;
+
+    for (int done = 0; done < samples; ) {
+        int n = samples - done;
+        if (n > burst) n = burst;
+        if (!read(ctx, scratch, (size_t)n * LSM6_FIFO_SAMPLE_BYTES)) return -1;
+        lsm6_fifo_unpack(scratch, n, &out[done]);
+        done += n;
+    }
+    return samples;
+}
+
+#endif // LSM6_FIFO_H
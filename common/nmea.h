@@ -0,0 +1,404 @@
+// Parser NMEA 0183 incremental (máquina de estados)
+//
+// Se alimenta byte a byte directamente desde el buffer de la UART: separa los
+// campos en una sola pasada, valida el checksum "*hh" y decodifica las tramas
+// RMC, GGA, VTG y GSA a estructuras tipadas. No depende de ESP-IDF, por lo que
+// compila también en el host (gcc/clang).
+//
+// Posición, velocidad y rumbo se convierten directamente a punto fijo entero
+// (la ESP32-C3 no tiene FPU): lat/lon en 1e-7 grados, velocidad en mm/s y
+// rumbo en centésimas de grado.
+//
+// Uso:
+//     nmea_parser_t p;
+//     nmea_msg_t msg;
+//     nmea_init(&p);
+//     for (int i = 0; i < len; i++) {
+//         if (nmea_feed(&p, data[i], &msg)) { ... msg.type, msg.rmc ... }
+//     }
+#ifndef NMEA_H
+#define NMEA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#define NMEA_MAX_LEN      96   // el estándar limita a 82 caracteres, dejamos margen
+#define NMEA_MAX_FIELDS   24
+
+typedef enum {
+    NMEA_NONE = 0,
+    NMEA_RMC,
+    NMEA_GGA,
+    NMEA_VTG,
+    NMEA_GSA,
+} nmea_type_t;
+
+// Recommended Minimum: 0:ID, 1:Time, 2:Status(A/V), 3:Lat, 4:N/S, 5:Lon, 6:E/W, 7:Speed, 8:Course, 9:Date
+typedef struct {
+    uint32_t time_ms;       // ms desde las 00:00 UTC
+    uint32_t date;          // ddmmyy
+    bool     valid;         // Status == 'A'
+    bool     has_course;
+    int32_t  lat_e7;        // grados * 1e7, + Norte
+    int32_t  lon_e7;        // grados * 1e7, + Este
+    uint32_t speed_mms;     // mm/s
+    uint16_t course_cdeg;   // grados * 100
+} nmea_rmc_t;
+
+// Fix data: 1:Time, 2:Lat, 3:N/S, 4:Lon, 5:E/W, 6:Quality, 7:NumSats, 8:HDOP, 9:Alt
+typedef struct {
+    uint32_t time_ms;
+    int32_t  lat_e7;
+    int32_t  lon_e7;
+    uint8_t  quality;       // 0 = sin fix, 1 = GPS, 2 = DGPS...
+    uint8_t  num_sats;
+    float    hdop;
+    float    alt_m;
+} nmea_gga_t;
+
+// Course over ground: 1:Course(T), 3:Course(M), 5:Speed(kn), 7:Speed(km/h)
+typedef struct {
+    bool     has_course;
+    uint16_t course_cdeg;
+    uint32_t speed_mms;
+} nmea_vtg_t;
+
+// DOP y satélites activos: 1:Mode, 2:FixType, 3..14:SV, 15:PDOP, 16:HDOP, 17:VDOP
+typedef struct {
+    char     mode;          // 'M' manual, 'A' automático
+    uint8_t  fix_type;      // 1 = sin fix, 2 = 2D, 3 = 3D
+    uint8_t  num_sv;
+    uint8_t  sv[12];
+    float    pdop;
+    float    hdop;
+    float    vdop;
+} nmea_gsa_t;
+
+typedef struct {
+    nmea_type_t type;
+    char        talker[3];  // "GP", "GN", "GL"...
+    union {
+        nmea_rmc_t rmc;
+        nmea_gga_t gga;
+        nmea_vtg_t vtg;
+        nmea_gsa_t gsa;
+    };
+} nmea_msg_t;
+
+typedef enum {
+    NMEA_ST_IDLE = 0,   // esperando '$'
+    NMEA_ST_BODY,       // acumulando campos y XOR
+    NMEA_ST_CKS_HI,
+    NMEA_ST_CKS_LO,
+} nmea_state_t;
+
+typedef struct {
+    nmea_state_t state;
+    uint8_t  len;
+    uint8_t  nfields;
+    uint8_t  cks;
+    uint8_t  cks_rx;
+    uint8_t  field_off[NMEA_MAX_FIELDS];
+    char     buf[NMEA_MAX_LEN + 1];   // trama completa "$...*hh", terminada en '\0'
+
+    // Contadores
+    uint32_t sentences;     // tramas con checksum correcto
+    uint32_t cks_errors;
+    uint32_t overflows;     // tramas demasiado largas o con demasiados campos
+    uint32_t unknown;       // tramas válidas de tipos no soportados
+} nmea_parser_t;
+
+static inline void nmea_init(nmea_parser_t *p)
+{
+    *p = (nmea_parser_t){0};
+}
+
+// Trama cruda de la última sentencia completada (válida hasta el siguiente '$')
+static inline const char *nmea_sentence(const nmea_parser_t *p)
+{
+    return p->buf;
+}
+
+// --------------------- Acceso a campos ---------------------
+// Los campos no se copian: se referencian por desplazamiento dentro de buf y
+// terminan en ',' o '*'.
+static inline const char *nmea_field(const nmea_parser_t *p, int idx)
+{
+    return (idx < p->nfields) ? &p->buf[p->field_off[idx]] : NULL;
+}
+
+static inline int nmea_field_len(const nmea_parser_t *p, int idx)
+{
+    if (idx >= p->nfields) return 0;
+    int end = (idx + 1 < p->nfields) ? p->field_off[idx + 1] - 1 : p->len - 3;
+    return end - p->field_off[idx];
+}
+
+static inline bool nmea_field_empty(const nmea_parser_t *p, int idx)
+{
+    return nmea_field_len(p, idx) <= 0;
+}
+
+static inline char nmea_field_char(const nmea_parser_t *p, int idx)
+{
+    return nmea_field_empty(p, idx) ? '\0' : *nmea_field(p, idx);
+}
+
+static inline uint32_t nmea_field_uint(const nmea_parser_t *p, int idx)
+{
+    const char *s = nmea_field(p, idx);
+    int n = nmea_field_len(p, idx);
+    uint32_t v = 0;
+    for (int i = 0; i < n && s[i] >= '0' && s[i] <= '9'; i++) {
+        v = v * 10 + (uint32_t)(s[i] - '0');
+    }
+    return v;
+}
+
+// strtof se detiene en el ',' o '*' que cierra el campo
+static inline float nmea_field_float(const nmea_parser_t *p, int idx)
+{
+    if (nmea_field_empty(p, idx)) return 0.0f;
+    return strtof(nmea_field(p, idx), NULL);
+}
+
+// hhmmss.ss -> ms desde las 00:00
+static inline uint32_t nmea_field_time(const nmea_parser_t *p, int idx)
+{
+    const char *s = nmea_field(p, idx);
+    int n = nmea_field_len(p, idx);
+    if (n < 6) return 0;
+
+    uint32_t hh = (uint32_t)((s[0] - '0') * 10 + (s[1] - '0'));
+    uint32_t mm = (uint32_t)((s[2] - '0') * 10 + (s[3] - '0'));
+    uint32_t ss = (uint32_t)((s[4] - '0') * 10 + (s[5] - '0'));
+    uint32_t ms = 0, scale = 100;
+    for (int i = 7; i < n && scale > 0; i++, scale /= 10) {
+        ms += (uint32_t)(s[i] - '0') * scale;
+    }
+    return ((hh * 60 + mm) * 60 + ss) * 1000 + ms;
+}
+
+// Decimal "iii.fff" -> entero escalado por 10^decimals, redondeando con el
+// primer dígito descartado
+static inline uint32_t nmea_field_fixed(const nmea_parser_t *p, int idx, int decimals)
+{
+    const char *s = nmea_field(p, idx);
+    int n = nmea_field_len(p, idx);
+    uint32_t v = 0;
+    int i = 0, frac = -1;
+
+    for (; i < n; i++) {
+        char c = s[i];
+        if (c == '.') { frac = 0; continue; }
+        if (c < '0' || c > '9') break;
+        if (frac >= decimals) {
+            if (c >= '5') v++;
+            break;
+        }
+        v = v * 10 + (uint32_t)(c - '0');
+        if (frac >= 0) frac++;
+    }
+    for (frac = frac < 0 ? 0 : frac; frac < decimals; frac++) v *= 10;
+    return v;
+}
+
+// ddmm.mmmmm + hemisferio -> grados * 1e7 con signo, sin coma flotante.
+// Los minutos se leen en 1e-7 min y se dividen por 60 redondeando.
+static inline int32_t nmea_field_coord(const nmea_parser_t *p, int idx, int hemi_idx)
+{
+    const char *s = nmea_field(p, idx);
+    int n = nmea_field_len(p, idx);
+    uint32_t ip = 0, min_e7 = 0, scale = 1000000;
+    int i = 0;
+
+    for (; i < n && s[i] >= '0' && s[i] <= '9'; i++) {
+        ip = ip * 10 + (uint32_t)(s[i] - '0');
+    }
+    if (i < n && s[i] == '.') {
+        for (i++; i < n && scale > 0 && s[i] >= '0' && s[i] <= '9'; i++, scale /= 10) {
+            min_e7 += (uint32_t)(s[i] - '0') * scale;
+        }
+    }
+    min_e7 += (ip % 100) * 10000000u;   // < 6e8, cabe en 32 bits
+
+    int32_t v = (int32_t)((ip / 100) * 10000000u + (min_e7 + 30) / 60);
+    char h = nmea_field_char(p, hemi_idx);
+    return (h == 'S' || h == 'W') ? -v : v;
+}
+
+// Nudos -> mm/s (1 kn = 1852/3600 m/s)
+static inline uint32_t nmea_field_knots_mms(const nmea_parser_t *p, int idx)
+{
+    uint32_t mkn = nmea_field_fixed(p, idx, 3);
+    return (uint32_t)(((uint64_t)mkn * 463 + 450) / 900);
+}
+
+// --------------------- Decodificación ---------------------
+static inline nmea_type_t nmea_sentence_type(const nmea_parser_t *p)
+{
+    // buf = "$TTSSS,..." -> talker TT, sentencia SSS
+    if (p->nfields < 1 || nmea_field_len(p, 0) != 5) return NMEA_NONE;
+    const char *id = &p->buf[3];
+    if (id[0] == 'R' && id[1] == 'M' && id[2] == 'C') return NMEA_RMC;
+    if (id[0] == 'G' && id[1] == 'G' && id[2] == 'A') return NMEA_GGA;
+    if (id[0] == 'V' && id[1] == 'T' && id[2] == 'G') return NMEA_VTG;
+    if (id[0] == 'G' && id[1] == 'S' && id[2] == 'A') return NMEA_GSA;
+    return NMEA_NONE;
+}
+
+static inline void nmea_decode_rmc(const nmea_parser_t *p, nmea_rmc_t *m)
+{
+    m->time_ms     = nmea_field_time(p, 1);
+    m->valid       = nmea_field_char(p, 2) == 'A';
+    m->lat_e7      = nmea_field_coord(p, 3, 4);
+    m->lon_e7      = nmea_field_coord(p, 5, 6);
+    m->speed_mms   = nmea_field_knots_mms(p, 7);
+    m->has_course  = !nmea_field_empty(p, 8);
+    m->course_cdeg = (uint16_t)nmea_field_fixed(p, 8, 2);
+    m->date        = nmea_field_uint(p, 9);
+}
+
+static inline void nmea_decode_gga(const nmea_parser_t *p, nmea_gga_t *m)
+{
+    m->time_ms  = nmea_field_time(p, 1);
+    m->lat_e7   = nmea_field_coord(p, 2, 3);
+    m->lon_e7   = nmea_field_coord(p, 4, 5);
+    m->quality  = (uint8_t)nmea_field_uint(p, 6);
+    m->num_sats = (uint8_t)nmea_field_uint(p, 7);
+    m->hdop     = nmea_field_float(p, 8);
+    m->alt_m    = nmea_field_float(p, 9);
+}
+
+static inline void nmea_decode_vtg(const nmea_parser_t *p, nmea_vtg_t *m)
+{
+    m->has_course  = !nmea_field_empty(p, 1);
+    m->course_cdeg = (uint16_t)nmea_field_fixed(p, 1, 2);
+    m->speed_mms   = nmea_field_knots_mms(p, 5);
+}
+
+static inline void nmea_decode_gsa(const nmea_parser_t *p, nmea_gsa_t *m)
+{
+    m->mode     = nmea_field_char(p, 1);
+    m->fix_type = (uint8_t)nmea_field_uint(p, 2);
+    m->num_sv   = 0;
+    for (int i = 3; i <= 14; i++) {
+        if (!nmea_field_empty(p, i)) m->sv[m->num_sv++] = (uint8_t)nmea_field_uint(p, i);
+    }
+    m->pdop = nmea_field_float(p, 15);
+    m->hdop = nmea_field_float(p, 16);
+    m->vdop = nmea_field_float(p, 17);
+}
+
+static inline bool nmea_decode(nmea_parser_t *p, nmea_msg_t *msg)
+{
+    msg->type = nmea_sentence_type(p);
+    msg->talker[0] = p->buf[1];
+    msg->talker[1] = p->buf[2];
+    msg->talker[2] = '\0';
+
+    switch (msg->type) {
+    case NMEA_RMC: nmea_decode_rmc(p, &msg->rmc); break;
+    case NMEA_GGA: nmea_decode_gga(p, &msg->gga); break;
+    case NMEA_VTG: nmea_decode_vtg(p, &msg->vtg); break;
+    case NMEA_GSA: nmea_decode_gsa(p, &msg->gsa); break;
+    default:
+        p->unknown++;
+        return false;
+    }
+    return true;
+}
+
+// --------------------- Máquina de estados ---------------------
+static inline int nmea_hex(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+static inline bool nmea_put(nmea_parser_t *p, char c)
+{
+    if (p->len >= NMEA_MAX_LEN) {
+        p->overflows++;
+        p->state = NMEA_ST_IDLE;
+        return false;
+    }
+    p->buf[p->len++] = c;
+    return true;
+}
+
+// Procesa un byte. Devuelve true cuando se completa una trama soportada con
+// checksum correcto; en ese caso msg queda rellenado.
+static inline bool nmea_feed(nmea_parser_t *p, uint8_t byte, nmea_msg_t *msg)
+{
+    char c = (char)byte;
+
+    // '$' siempre reinicia: resincroniza tras bytes perdidos
+    if (c == '$') {
+        p->state = NMEA_ST_BODY;
+        p->len = 0;
+        p->cks = 0;
+        p->buf[p->len++] = c;
+        p->field_off[0] = 1;
+        p->nfields = 1;
+        return false;
+    }
+
+    switch (p->state) {
+    case NMEA_ST_IDLE:
+        return false;
+
+    case NMEA_ST_BODY:
+        if (c == '*') {
+            if (nmea_put(p, c)) p->state = NMEA_ST_CKS_HI;
+            return false;
+        }
+        if (c == '\r' || c == '\n') {   // trama sin checksum: se descarta
+            p->cks_errors++;
+            p->state = NMEA_ST_IDLE;
+            return false;
+        }
+        p->cks ^= (uint8_t)c;
+        if (!nmea_put(p, c)) return false;
+        if (c == ',') {
+            if (p->nfields >= NMEA_MAX_FIELDS) {
+                p->overflows++;
+                p->state = NMEA_ST_IDLE;
+                return false;
+            }
+            p->field_off[p->nfields++] = p->len;
+        }
+        return false;
+
+    case NMEA_ST_CKS_HI: {
+        int h = nmea_hex(c);
+        if (h < 0) { p->cks_errors++; p->state = NMEA_ST_IDLE; return false; }
+        p->cks_rx = (uint8_t)(h << 4);
+        if (nmea_put(p, c)) p->state = NMEA_ST_CKS_LO;
+        return false;
+    }
+
+    case NMEA_ST_CKS_LO: {
+        int h = nmea_hex(c);
+        p->state = NMEA_ST_IDLE;
+        if (h < 0) { p->cks_errors++; return false; }
+        p->cks_rx |= (uint8_t)h;
+        if (!nmea_put(p, c)) return false;
+        p->buf[p->len] = '\0';
+
+        if (p->cks_rx != p->cks) {
+            p->cks_errors++;
+            return false;
+        }
+        p->sentences++;
+        return nmea_decode(p, msg);
+    }
+    }
+    return false;
+}
+
+#endif // NMEA_H
@@ -0,0 +1,206 @@
+// Configuración del nodo modificable en marcha (downlink por MQTT)
+//
+// Los periodos, el perfil del BMP280, los umbrales de lote y de banda
+// muerta y los canales activos dejan de ser sólo macros: el firmware parte
+// de sus valores por defecto, los sobrescribe con lo guardado en NVS y los
+// cambia al recibir un mensaje de texto en su topic de configuración:
+//
+//     mosquitto_pub -t test/gps/cfg/<nodo> -m "bmp_ms=200 batch_n=4 db_temp=2"
+//
+// Pares clave=valor (valores enteros en decimal) separados por espacios,
+// comas, ';' o saltos de línea.
+// La actualización es atómica: si una clave no existe o un valor se sale de
+// rango, no se cambia nada. Todos los campos son int32_t para poder
+// describirlos con una tabla (clave, desplazamiento, rango).
+//
+// El análisis no depende de ESP-IDF; la parte de NVS sólo se compila en el
+// ESP32 (ESP_PLATFORM).
+#ifndef NODE_CFG_H
+#define NODE_CFG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NODE_CFG_CH_BMP     0x01
+#define NODE_CFG_CH_GPS     0x02
+#define NODE_CFG_CH_ALL     (NODE_CFG_CH_BMP | NODE_CFG_CH_GPS)
+
+typedef struct {
+    int32_t bmp_period_ms;
+    int32_t bmp_profile;        // bmp280_profile_id_t
+    int32_t batch_max_samples;
+    int32_t batch_max_latency_ms;
+    int32_t max_silence_ms;
+    int32_t db_temp_c100;
+    int32_t db_press_pa;
+    int32_t db_gps_e7;
+    int32_t db_speed_mms;
+    int32_t channels;           // NODE_CFG_CH_*
+    int32_t qos;
+} node_cfg_t;
+
+typedef struct {
+    const char *key;
+    size_t      off;
+    int32_t     min;
+    int32_t     max;
+} node_cfg_field_t;
+
+#define NODE_CFG_FIELD(k, f, lo, hi) { k, offsetof(node_cfg_t, f), lo, hi }
+
+static const node_cfg_field_t node_cfg_fields[] = {
+    NODE_CFG_FIELD("bmp_ms",      bmp_period_ms,        50,   3600000),
+    NODE_CFG_FIELD("bmp_profile", bmp_profile,          0,    3),
+    NODE_CFG_FIELD("batch_n",     batch_max_samples,    1,    32),        // SENSOR_BATCH_MAX_SAMPLES
+    NODE_CFG_FIELD("batch_ms",    batch_max_latency_ms, 0,    30000),     // dt de 16 bits con signo
+    NODE_CFG_FIELD("silence_ms",  max_silence_ms,       1000, 86400000),
+    NODE_CFG_FIELD("db_temp",     db_temp_c100,         0,    10000),
+    NODE_CFG_FIELD("db_press",    db_press_pa,          0,    100000),
+    NODE_CFG_FIELD("db_gps",      db_gps_e7,            0,    10000000),
+    NODE_CFG_FIELD("db_speed",    db_speed_mms,         0,    100000),
+    NODE_CFG_FIELD("channels",    channels,             0,    NODE_CFG_CH_ALL),
+    NODE_CFG_FIELD("qos",         qos,                  0,    2),
+};
+
+#define NODE_CFG_NFIELDS    (sizeof(node_cfg_fields) / sizeof(node_cfg_fields[0]))
+
+static inline int32_t *node_cfg_at(node_cfg_t *c, const node_cfg_field_t *f)
+{
+    return (int32_t *)((uint8_t *)c + f->off);
+}
+
+static inline bool node_cfg_is_sep(char ch)
+{
+    return ch == ' ' || ch == ',' || ch == ';' || ch == '\n' || ch == '\r' || ch == '\t';
+}
+
+// Aplica el texto sobre c. Devuelve cuántos campos han cambiado, o -1 con
+// el motivo en err (c queda intacto).
+static inline int node_cfg_parse(node_cfg_t *c, const char *txt, size_t len, char *err, size_t err_len)
+{
+    node_cfg_t tmp = *c;
+    int changed = 0;
+    size_t i = 0;
+
+    while (i < len) {
+        while (i < len && node_cfg_is_sep(txt[i])) i++;
+        if (i >= len) break;
+
+        size_t k0 = i;
+        while (i < len && txt[i] != '=' && !node_cfg_is_sep(txt[i])) i++;
+        size_t klen = i - k0;
+        if (i >= len || txt[i] != '=') {
+            snprintf(err, err_len, "falta '=' tras '%.*s'", (int)klen, &txt[k0]);
+            return -1;
+        }
+        i++;
+
+        char num[16];
+        size_t v0 = i;
+        while (i < len && !node_cfg_is_sep(txt[i])) i++;
+        size_t vlen = i - v0;
+        if (vlen == 0 || vlen >= sizeof(num)) {
+            snprintf(err, err_len, "valor inválido para '%.*s'", (int)klen, &txt[k0]);
+            return -1;
+        }
+        memcpy(num, &txt[v0], vlen);
+        num[vlen] = '\0';
+
+        const node_cfg_field_t *f = NULL;
+        for (size_t n = 0; n < NODE_CFG_NFIELDS; n++) {
+            if (strlen(node_cfg_fields[n].key) == klen && memcmp(node_cfg_fields[n].key, &txt[k0], klen) == 0) {
+                f = &node_cfg_fields[n];
+                break;
+            }
+        }
+        if (f == NULL) {
+            snprintf(err, err_len, "clave desconocida '%.*s'", (int)klen, &txt[k0]);
+            return -1;
+        }
+
+        char *end;
+        long v = strtol(num, &end, 10);    // "bmp_ms=0100" es 100, no octal
+        if (*end != '\0' || v < f->min || v > f->max) {
+            snprintf(err, err_len, "%s=%s fuera de rango [%ld, %ld]", f->key, num, (long)f->min, (long)f->max);
+            return -1;
+        }
+        if (*node_cfg_at(&tmp, f) != (int32_t)v) {
+            *node_cfg_at(&tmp, f) = (int32_t)v;
+            changed++;
+        }
+    }
+    *c = tmp;
+    return changed;
+}
+
+// Escribe la configuración completa en el mismo formato que acepta node_cfg_parse
+static inline size_t node_cfg_format(const node_cfg_t *c, char *out, size_t size)
+{
+    size_t n = 0;
+    for (size_t k = 0; k < NODE_CFG_NFIELDS && n < size; k++) {
+        int w = snprintf(out + n, size - n, "%s%s=%ld", k ? " " : "", node_cfg_fields[k].key,
+                         (long)*node_cfg_at((node_cfg_t *)c, &node_cfg_fields[k]));
+        if (w < 0) break;
+        n += (size_t)w;
+    }
+    return n < size ? n : size - 1;
+}
+
+#ifdef ESP_PLATFORM
+#include "nvs.h"
+
+#define NODE_CFG_NVS_NS         "node_cfg"
+#define NODE_CFG_NVS_KEY        "cfg"
+#define NODE_CFG_NVS_VERSION    1
+
+typedef struct {
+    uint16_t   version;
+    uint16_t   size;            // sizeof(node_cfg_t) al guardarla
+    node_cfg_t cfg;
+} node_cfg_blob_t;
+
+// Sobrescribe c con la configuración guardada (nvs_flash_init ya hecho).
+// Si no hay nada o es de otra versión, c se queda con los valores por defecto.
+static inline esp_err_t node_cfg_load(node_cfg_t *c)
+{
+    nvs_handle_t h;
+    node_cfg_blob_t b;
+    size_t len = sizeof(b);
+
+    esp_err_t err = nvs_open(NODE_CFG_NVS_NS, NVS_READONLY, &h);
+    if (err != ESP_OK) return err;
+    err = nvs_get_blob(h, NODE_CFG_NVS_KEY, &b, &len);
+    nvs_close(h);
+    if (err != ESP_OK) return err;
+    if (len != sizeof(b) || b.version != NODE_CFG_NVS_VERSION || b.size != sizeof(node_cfg_t)) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    // Se revalidan los rangos: un blob antiguo no debe dejar el nodo en un estado imposible
+    for (size_t k = 0; k < NODE_CFG_NFIELDS; k++) {
+        int32_t v = *node_cfg_at(&b.cfg, &node_cfg_fields[k]);
+        if (v < node_cfg_fields[k].min || v > node_cfg_fields[k].max) return ESP_ERR_INVALID_ARG;
+    }
+    *c = b.cfg;
+    return ESP_OK;
+}
+
+static inline esp_err_t node_cfg_save(const node_cfg_t *c)
+{
+    nvs_handle_t h;
+    node_cfg_blob_t b = { .version = NODE_CFG_NVS_VERSION, .size = sizeof(node_cfg_t), .cfg = *c };
+
+    esp_err_t err = nvs_open(NODE_CFG_NVS_NS, NVS_READWRITE, &h);
+    if (err != ESP_OK) return err;
+    err = nvs_set_blob(h, NODE_CFG_NVS_KEY, &b, sizeof(b));
+    if (err == ESP_OK) err = nvs_commit(h);
+    nvs_close(h);
+    return err;
+}
+#endif
+
+#endif // NODE_CFG_H
@@ -0,0 +1,159 @@
+// Mensajes binarios de sensores para MQTT (sustituyen al JSON de publisher_task)
+//
+// Lote de muestras, versión SENSOR_BATCH_VERSION: todas las lecturas
+// tomadas entre dos publicaciones en un único mensaje
+//
+//     u8 versión | u8 n | u16 seq | u32 t0 (ms desde el arranque)
+//     | u32 t_pub (ms desde el arranque al publicar) | u64 hora de publicación
+//     (ms Unix por SNTP, 0 si no hay hora) | u32 id del nodo
+//     n registros: u8 tipo | i16 dt (ms respecto a t0) | datos
+//       BMP  (9 bytes):  i16 temperatura (c°C) | u32 presión (Pa)
+//       GPS  (18 bytes): i32 lat | i32 lon (1e-7 grados) | u32 velocidad (mm/s)
+//                        | u16 rumbo (c°) | u8 fix
+//
+// dt es con signo: las muestras de tareas distintas pueden llegar algo
+// desordenadas respecto a la primera del lote. Cada muestra queda
+// identificada por (nodo, seq, índice) y su instante de adquisición es
+// t0 + dt; con t_pub y la hora de publicación el servidor mide la latencia
+// de cada etapa. La versión 2 (sin t_pub, hora ni id; cabecera de 8 bytes)
+// sigue siendo válida para el servidor.
+//
+// Todo son enteros escalados: el firmware no formatea floats y el servidor
+// lo lee con accesos de tamaño fijo en lugar de JSON.parse. El primer byte
+// (versión) nunca es '{', así que el servidor distingue este formato del
+// JSON antiguo y acepta los dos. Sin dependencias de ESP-IDF.
+//
+// La versión 1 (un mensaje fijo de 29 bytes por muestra) ya no se genera;
+// sólo el servidor la decodifica (decodeSensorMsg) para nodos con firmware
+// antiguo. sensor_msg_t queda como último valor de cada sensor, para el
+// JSON de PAYLOAD_BINARY 0 y el log.
+#ifndef SENSOR_MSG_H
+#define SENSOR_MSG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define SENSOR_MSG_F_SENSOR     0x01
+#define SENSOR_MSG_F_FIX        0x02
+
+typedef struct {
+    uint8_t  flags;
+    uint16_t seq;
+    uint32_t t_ms;
+    int16_t  temp_c100;
+    uint32_t press_pa;
+    int32_t  lat_e7;
+    int32_t  lon_e7;
+    uint32_t speed_mms;
+    uint16_t course_cdeg;
+    uint8_t  nfix;
+} sensor_msg_t;
+
+static inline void sensor_msg_put16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void sensor_msg_put32(uint8_t *p, uint32_t v)
+{
+    sensor_msg_put16(p, (uint16_t)v);
+    sensor_msg_put16(p + 2, (uint16_t)(v >> 16));
+}
+
+// ===================== Lotes =====================
+#define SENSOR_BATCH_VERSION    3
+#define SENSOR_BATCH_HDR_LEN    24
+#define SENSOR_BATCH_MAX_SAMPLES 32
+#define SENSOR_REC_BMP_LEN      9
+#define SENSOR_REC_GPS_LEN      18
+#define SENSOR_BATCH_MAX_LEN    (SENSOR_BATCH_HDR_LEN + SENSOR_BATCH_MAX_SAMPLES * SENSOR_REC_GPS_LEN)
+
+typedef enum {
+    SENSOR_REC_BMP = 1,
+    SENSOR_REC_GPS = 2,
+} sensor_rec_type_t;
+
+typedef struct {
+    uint8_t  buf[SENSOR_BATCH_MAX_LEN];
+    size_t   len;
+    uint8_t  n;
+    uint32_t t0_ms;
+    uint32_t node_id;
+} sensor_batch_t;
+
+static inline void sensor_batch_reset(sensor_batch_t *b)
+{
+    b->len = 0;
+    b->n = 0;
+}
+
+// Reserva un registro de rec_len bytes con marca t_ms. Devuelve el puntero
+// a sus datos o NULL si el lote está lleno o dt no cabe en 16 bits (hay que
+// publicar el lote y empezar otro).
+static inline uint8_t *sensor_batch_rec(sensor_batch_t *b, uint8_t type, uint32_t t_ms, size_t rec_len)
+{
+    if (b->n == 0) {
+        b->t0_ms = t_ms;
+        b->len = SENSOR_BATCH_HDR_LEN;
+    }
+    int32_t dt = (int32_t)(t_ms - b->t0_ms);
+    if (b->n >= SENSOR_BATCH_MAX_SAMPLES || b->len + rec_len > SENSOR_BATCH_MAX_LEN ||
+        dt < INT16_MIN || dt > INT16_MAX) {
+        return NULL;
+    }
+    uint8_t *p = &b->buf[b->len];
+    p[0] = type;
+    sensor_msg_put16(&p[1], (uint16_t)(int16_t)dt);
+    b->len += rec_len;
+    b->n++;
+    return p + 3;
+}
+
+static inline bool sensor_batch_add_bmp(sensor_batch_t *b, uint32_t t_ms, int16_t temp_c100, uint32_t press_pa)
+{
+    uint8_t *p = sensor_batch_rec(b, SENSOR_REC_BMP, t_ms, SENSOR_REC_BMP_LEN);
+    if (p == NULL) return false;
+    sensor_msg_put16(&p[0], (uint16_t)temp_c100);
+    sensor_msg_put32(&p[2], press_pa);
+    return true;
+}
+
+static inline bool sensor_batch_add_gps(sensor_batch_t *b, uint32_t t_ms, int32_t lat_e7, int32_t lon_e7,
+                                        uint32_t speed_mms, uint16_t course_cdeg, bool fix)
+{
+    uint8_t *p = sensor_batch_rec(b, SENSOR_REC_GPS, t_ms, SENSOR_REC_GPS_LEN);
+    if (p == NULL) return false;
+    sensor_msg_put32(&p[0], (uint32_t)lat_e7);
+    sensor_msg_put32(&p[4], (uint32_t)lon_e7);
+    sensor_msg_put32(&p[8], speed_mms);
+    sensor_msg_put16(&p[12], course_cdeg);
+    p[14] = fix;
+    return true;
+}
+
+// Escribe la cabecera; devuelve la longitud del mensaje (0 si está vacío).
+// Las marcas de publicación se ponen con sensor_batch_stamp.
+static inline size_t sensor_batch_finish(sensor_batch_t *b, uint16_t seq)
+{
+    if (b->n == 0) return 0;
+    b->buf[0] = SENSOR_BATCH_VERSION;
+    b->buf[1] = b->n;
+    sensor_msg_put16(&b->buf[2], seq);
+    sensor_msg_put32(&b->buf[4], b->t0_ms);
+    sensor_msg_put32(&b->buf[20], b->node_id);
+    return b->len;
+}
+
+// Sella un lote ya codificado justo antes de enviarlo (también al reenviar
+// uno guardado en flash, para que la latencia de red sea la del envío real)
+static inline void sensor_batch_stamp(uint8_t *msg, size_t len, uint32_t t_pub_ms, uint64_t epoch_ms)
+{
+    if (len < SENSOR_BATCH_HDR_LEN || msg[0] != SENSOR_BATCH_VERSION) return;
+    sensor_msg_put32(&msg[8], t_pub_ms);
+    sensor_msg_put32(&msg[12], (uint32_t)epoch_ms);
+    sensor_msg_put32(&msg[16], (uint32_t)(epoch_ms >> 32));
+}
+
+#endif // SENSOR_MSG_H
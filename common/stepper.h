@@ -0,0 +1,274 @@
+// Motor paso a paso (28BYJ-48 + ULN2003) movido desde la alarma de un gptimer
+//
+// Sustituye al bucle que daba cada medio paso con esp_rom_delay_us(1000) y
+// sondeaba el objetivo con vTaskDelay: la tarea que recibe los rumbos está
+// bloqueada en su cola y cada paso lo da la ISR de la alarma, que programa
+// la siguiente en alarm_value + intervalo. Entre pasos la CPU queda libre y,
+// con el motor parado, la alarma está desactivada (el contador sigue en
+// hardware sin generar interrupciones).
+//
+// Perfil trapezoidal: al iniciar se precalcula una tabla con el intervalo
+// (µs) de cada paso de la rampa, desde v_start hasta v_max con aceleración
+// constante (v_k = sqrt(v_start² + 2·a·k)). En la ISR sólo se sube o baja
+// un índice k: se acelera mientras quedan más pasos que k, se frena cuando
+// los pasos que faltan alcanzan a k, y si el objetivo cambia de sentido se
+// frena hasta v_start antes de invertir. Nada de coma flotante en la ISR.
+//
+// El objetivo es una posición en una vuelta (0..spr-1) y se recorre por el
+// camino más corto: de 359° a 1° son dos grados, no una vuelta entera.
+//
+// La planificación (stepper_motion_*) no depende de ESP-IDF; el driver con
+// gptimer, cola y tarea sólo se compila en el ESP32 (ESP_PLATFORM).
+//
+// Uso:
+//     static stepper_t motor;
+//     stepper_config_t cfg = { .pins = { 6, 7, 8, 9 }, .steps_per_rev = 2038, ... };
+//     stepper_start(&motor, &cfg, 5);
+//     stepper_post_heading(&motor, course_cdeg);      // desde cualquier tarea
+#ifndef STEPPER_H
+#define STEPPER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+#define STEPPER_RAMP_MAX    256     // pasos de rampa como máximo (tabla de u16)
+
+// Secuencia de medio paso: bit n = bobina n (IN1..IN4 del ULN2003)
+static const uint8_t stepper_half_step[8] = { 0x9, 0x1, 0x3, 0x2, 0x6, 0x4, 0xC, 0x8 };
+
+typedef struct {
+    uint16_t spr;                       // pasos por vuelta
+    uint16_t nramp;
+    uint16_t ramp_us[STEPPER_RAMP_MAX]; // intervalo del paso k de la rampa
+    int32_t  pos;                       // posición actual, 0..spr-1
+    int32_t  target;                    // objetivo, 0..spr-1
+    int8_t   dir;                       // sentido del movimiento en curso, 0 parado
+    uint16_t k;                         // índice actual en la rampa
+    uint8_t  phase;                     // índice en stepper_half_step
+
+    uint32_t steps;
+    uint32_t reversals;                 // frenadas por cambio de sentido
+} stepper_motion_t;
+
+// v_start y v_max en pasos/s, accel en pasos/s². Sólo al iniciar usa floats.
+static inline void stepper_motion_init(stepper_motion_t *m, uint16_t spr, uint32_t v_start, uint32_t v_max,
+                                       uint32_t accel)
+{
+    *m = (stepper_motion_t){ .spr = spr };
+    if (v_start == 0) v_start = 1;
+    if (v_max < v_start) v_max = v_start;
+
+    float v = (float)v_start;
+    for (uint16_t k = 0; k < STEPPER_RAMP_MAX; k++) {
+        float us = 1e6f / v;
+        m->ramp_us[k] = us > 65535.0f ? 65535 : (uint16_t)us;
+        m->nramp = k + 1;
+        if (v >= (float)v_max || accel == 0) break;
+        v = sqrtf((float)v_start * v_start + 2.0f * accel * (k + 1));
+        if (v > (float)v_max) v = (float)v_max;
+    }
+}
+
+// Diferencia con signo de pos a target por el camino más corto
+static inline int32_t stepper_motion_delta(const stepper_motion_t *m, int32_t target)
+{
+    int32_t d = (target - m->pos) % m->spr;
+    if (d < 0) d += m->spr;
+    if (d > m->spr / 2) d -= m->spr;
+    return d;
+}
+
+// Rumbo en centésimas de grado -> paso dentro de la vuelta
+static inline int32_t stepper_motion_cdeg_to_step(const stepper_motion_t *m, uint32_t cdeg)
+{
+    return (int32_t)(((cdeg % 36000) * (uint32_t)m->spr + 18000) / 36000) % m->spr;
+}
+
+// Cambia el objetivo. Con el motor parado se ignoran los cambios de hasta
+// deadband pasos (ruido del rumbo GPS); en marcha se acepta cualquiera.
+// Devuelve true si el motor tiene que arrancar.
+static inline bool stepper_motion_set_target(stepper_motion_t *m, int32_t target, int32_t deadband)
+{
+    if (m->dir == 0) {
+        int32_t d = stepper_motion_delta(m, target);
+        if (d <= deadband && d >= -deadband) return false;
+        m->target = target;
+        return true;
+    }
+    m->target = target;
+    return false;
+}
+
+// Da un paso hacia el objetivo (actualiza pos y phase) y devuelve los µs
+// hasta el siguiente, o 0 si el motor se queda parado sin moverse
+static inline uint32_t stepper_motion_next(stepper_motion_t *m)
+{
+    int32_t d = stepper_motion_delta(m, m->target);
+    int8_t want = d > 0 ? 1 : (d < 0 ? -1 : 0);
+
+    if (m->dir == 0) {
+        if (want == 0) return 0;
+        m->dir = want;
+        m->k = 0;
+    } else if (want != m->dir) {
+        // Objetivo alcanzado o al otro lado: frenar antes de parar o invertir
+        if (m->k == 0) {
+            if (want != 0) m->reversals++;
+            m->dir = want;
+            if (want == 0) return 0;
+        } else {
+            m->k--;
+        }
+    } else {
+        uint32_t left = (uint32_t)(d < 0 ? -d : d);
+        if (m->k >= left) {
+            m->k--;                     // si no da tiempo a frenar, se pasa y vuelve
+        } else if (m->k + 1u < m->nramp && m->k + 1u < left) {
+            m->k++;
+        }
+    }
+
+    m->pos += m->dir;
+    if (m->pos >= m->spr) m->pos -= m->spr;
+    if (m->pos < 0) m->pos += m->spr;
+    m->phase = (uint8_t)((m->phase + m->dir) & 7);
+    m->steps++;
+    return m->ramp_us[m->k];
+}
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "driver/gptimer.h"
+#include "driver/gpio.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include <inttypes.h>
+
+#include "gpio_fast.h"
+
+#define STEPPER_TIMER_HZ    1000000 // 1 tick = 1 µs
+#define STEPPER_KICK_US     20      // retardo del primer paso tras un objetivo nuevo
+
+typedef struct {
+    int      pins[4];               // IN1..IN4
+    uint16_t steps_per_rev;
+    uint32_t v_start;               // pasos/s
+    uint32_t v_max;                 // pasos/s
+    uint32_t accel;                 // pasos/s²
+    int32_t  deadband;              // pasos
+} stepper_config_t;
+
+typedef struct {
+    stepper_motion_t    m;
+    stepper_config_t    cfg;
+    gptimer_handle_t    timer;
+    gpio_fast_pattern_t coils[8];   // stepper_half_step ya traducida a máscaras W1TS/W1TC
+    QueueHandle_t       q;          // rumbos (u32, centésimas de grado), sólo el último
+    portMUX_TYPE        lock;
+    bool                running;    // alarma armada
+} stepper_t;
+
+static bool stepper_on_alarm(gptimer_handle_t timer, const gptimer_alarm_event_data_t *ed, void *ctx)
+{
+    stepper_t *s = ctx;
+
+    portENTER_CRITICAL_ISR(&s->lock);
+    uint32_t dt = stepper_motion_next(&s->m);
+    if (dt == 0) {
+        s->running = false;
+        gptimer_set_alarm_action(timer, NULL);
+    } else {
+        gpio_fast_write(s->coils[s->m.phase]);
+        gptimer_alarm_config_t next = { .alarm_count = ed->alarm_value + dt };
+        gptimer_set_alarm_action(timer, &next);
+    }
+    portEXIT_CRITICAL_ISR(&s->lock);
+    return false;
+}
+
+// Fija el objetivo y, si el motor estaba parado, arma la primera alarma.
+// La ISR desarma la alarma dentro del mismo cerrojo, así que no se pierde
+// ningún arranque aunque coincida con el último paso.
+static inline void stepper_set_target(stepper_t *s, int32_t step)
+{
+    portENTER_CRITICAL(&s->lock);
+    bool kick = stepper_motion_set_target(&s->m, step, s->cfg.deadband) && !s->running;
+    if (kick) {
+        uint64_t now = 0;
+        gptimer_get_raw_count(s->timer, &now);
+        gptimer_alarm_config_t a = { .alarm_count = now + STEPPER_KICK_US };
+        s->running = true;
+        gptimer_set_alarm_action(s->timer, &a);
+    }
+    portEXIT_CRITICAL(&s->lock);
+}
+
+static void stepper_task(void *arg)
+{
+    stepper_t *s = arg;
+    uint32_t cdeg;
+
+    while (1) {
+        if (xQueueReceive(s->q, &cdeg, portMAX_DELAY) != pdTRUE) continue;
+        stepper_set_target(s, stepper_motion_cdeg_to_step(&s->m, cdeg));
+    }
+}
+
+// Nuevo rumbo (centésimas de grado). No bloquea: si la tarea aún no ha
+// leído el anterior, se sustituye.
+static inline void stepper_post_heading(stepper_t *s, uint32_t cdeg)
+{
+    xQueueOverwrite(s->q, &cdeg);
+}
+
+// Posición actual en centésimas de grado
+static inline uint32_t stepper_heading_cdeg(stepper_t *s)
+{
+    portENTER_CRITICAL(&s->lock);
+    int32_t pos = s->m.pos;
+    portEXIT_CRITICAL(&s->lock);
+    return (uint32_t)pos * 36000u / s->m.spr;
+}
+
+// Configura los pines (gpio_config para el IO_MUX; después sólo W1TS/W1TC),
+// la rampa y el gptimer (en marcha libre, sin alarma) y arranca la tarea que
+// atiende la cola de rumbos
+static inline esp_err_t stepper_start(stepper_t *s, const stepper_config_t *cfg, UBaseType_t prio)
+{
+    static const char *TAG = "stepper";
+
+    *s = (stepper_t){ .cfg = *cfg, .lock = portMUX_INITIALIZER_UNLOCKED };
+    stepper_motion_init(&s->m, cfg->steps_per_rev, cfg->v_start, cfg->v_max, cfg->accel);
+
+    gpio_config_t io = { .mode = GPIO_MODE_OUTPUT, .intr_type = GPIO_INTR_DISABLE };
+    for (int n = 0; n < 4; n++) io.pin_bit_mask |= 1ULL << cfg->pins[n];
+    ESP_RETURN_ON_ERROR(gpio_config(&io), TAG, "gpio");
+    gpio_fast_pattern_build(s->coils, stepper_half_step, 8, cfg->pins, 4);
+    gpio_fast_write(s->coils[s->m.phase]);
+
+    s->q = xQueueCreate(1, sizeof(uint32_t));
+    if (s->q == NULL) return ESP_ERR_NO_MEM;
+
+    gptimer_config_t tc = {
+        .clk_src = GPTIMER_CLK_SRC_DEFAULT,
+        .direction = GPTIMER_COUNT_UP,
+        .resolution_hz = STEPPER_TIMER_HZ,
+    };
+    ESP_RETURN_ON_ERROR(gptimer_new_timer(&tc, &s->timer), TAG, "gptimer");
+    gptimer_event_callbacks_t cbs = { .on_alarm = stepper_on_alarm };
+    ESP_RETURN_ON_ERROR(gptimer_register_event_callbacks(s->timer, &cbs, s), TAG, "callback");
+    ESP_RETURN_ON_ERROR(gptimer_enable(s->timer), TAG, "enable");
+    ESP_RETURN_ON_ERROR(gptimer_start(s->timer), TAG, "start");
+
+    if (xTaskCreate(stepper_task, "stepper", 2048, s, prio, NULL) != pdPASS) return ESP_ERR_NO_MEM;
+    ESP_LOGI(TAG, "pines %d %d %d %d, %u pasos/vuelta, %" PRIu32 "-%" PRIu32 " pasos/s, rampa de %u pasos",
+             cfg->pins[0], cfg->pins[1], cfg->pins[2], cfg->pins[3], cfg->steps_per_rev,
+             cfg->v_start, cfg->v_max, s->m.nramp);
+    return ESP_OK;
+}
+#endif
+
+#endif // STEPPER_H
@@ -0,0 +1,243 @@
+// Telemetría binaria por tramas (COBS + CRC-16)
+//
+// Sustituye al printf por muestra: formatear %f en la ESP32-C3 (sin FPU)
+// cuesta más que leer el sensor y la consola limita la tasa de muestreo.
+// Cada registro se serializa en little-endian como
+//
+//     type (u8) | seq (u8) | payload | CRC-16/CCITT-FALSE (LE16)
+//
+// se codifica con COBS (sin bytes 0x00) y se delimita con un 0x00 delante y
+// otro detrás. El receptor se resincroniza en cualquier 0x00, así que las
+// líneas de ESP_LOG que se cuelen entre tramas se descartan por CRC sin
+// arrastrar a la trama siguiente.
+//
+// Registros (tiempos en µs de esp_timer, truncados a 32 bits):
+//   IMU_RAW   t_last (u32) | periodo (u16) | n (u8) | n * (gx gy gz ax ay az, i16)
+//             t_last es la marca de la última muestra del bloque
+//   ATTITUDE  t (u32) | roll pitch yaw (i16, centésimas de grado) | temp (i16, c°C) | servo (u8)
+//   ADC       t (u32) | canal (u8) | duty (u16, por mil) | raw (u16)
+//   GPS       t (u32) | lat lon (i32, 1e-7 grados) | velocidad (u32, mm/s) | rumbo (u16, c°) | fix (u8)
+//             fix: 0 sin fix, 1 RMC válido (NMEA), 2/3 = 2D/3D (UBX)
+//   ADC_BLOCK t_last (u32) | periodo (u16) | canal (u8) | duty (u16, por mil) | n (u8) | n * mV (u16)
+//             muestras equiespaciadas del ADC continuo; t_last es la de la última
+//
+// La parte de protocolo no depende de ESP-IDF (la usa también el
+// decodificador del host, tools/telem_csv.c). El escritor (telem_start /
+// telem_send) sólo se compila en el ESP32: los productores copian la trama
+// a un ring buffer sin esperar a que haya sitio y una tarea la vuelca al
+// USB-Serial-JTAG.
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define TELEM_MAX_PAYLOAD       400
+#define TELEM_MAX_RAW           (TELEM_MAX_PAYLOAD + 4)                 // type, seq, CRC
+#define TELEM_MAX_FRAME         (TELEM_MAX_RAW + TELEM_MAX_RAW / 254 + 3) // COBS + 2 x 0x00
+#define TELEM_IMU_MAX_SAMPLES   32      // 7 + 32 * 12 = 391 bytes de payload
+#define TELEM_ADC_MAX_SAMPLES   128     // 10 + 128 * 2 = 266 bytes de payload
+
+typedef enum {
+    TELEM_IMU_RAW   = 1,
+    TELEM_ATTITUDE  = 2,
+    TELEM_ADC       = 3,
+    TELEM_GPS       = 4,
+    TELEM_ADC_BLOCK = 5,
+} telem_type_t;
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+static inline uint16_t telem_crc16(const uint8_t *d, size_t n)
+{
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < n; i++) {
+        crc ^= (uint16_t)d[i] << 8;
+        for (int b = 0; b < 8; b++) crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+// COBS: devuelve la longitud codificada (sin el 0x00 final)
+static inline size_t telem_cobs_encode(const uint8_t *in, size_t len, uint8_t *out)
+{
+    size_t code_pos = 0, o = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < len; i++) {
+        if (in[i] == 0) {
+            out[code_pos] = code;
+            code_pos = o++;
+            code = 1;
+        } else {
+            out[o++] = in[i];
+            if (++code == 0xFF) {
+                out[code_pos] = code;
+                code_pos = o++;
+                code = 1;
+            }
+        }
+    }
+    out[code_pos] = code;
+    return o;
+}
+
+// Decodifica una trama COBS (sin el 0x00). Devuelve la longitud o 0 si es inválida.
+static inline size_t telem_cobs_decode(const uint8_t *in, size_t len, uint8_t *out, size_t max)
+{
+    size_t i = 0, o = 0;
+
+    while (i < len) {
+        uint8_t code = in[i++];
+        if (code == 0 || i + code - 1 > len) return 0;
+        for (uint8_t k = 1; k < code; k++) {
+            if (o >= max) return 0;
+            out[o++] = in[i++];
+        }
+        if (code != 0xFF && i < len) {
+            if (o >= max) return 0;
+            out[o++] = 0;
+        }
+    }
+    return o;
+}
+
+// Registro en construcción (sin codificar)
+typedef struct {
+    uint8_t buf[TELEM_MAX_RAW];
+    size_t  len;
+} telem_rec_t;
+
+static inline void telem_begin(telem_rec_t *r, telem_type_t type)
+{
+    r->buf[0] = (uint8_t)type;
+    r->buf[1] = 0;          // seq, se rellena al enviar
+    r->len = 2;
+}
+
+static inline void telem_put_u8(telem_rec_t *r, uint8_t v)
+{
+    if (r->len < TELEM_MAX_RAW - 2) r->buf[r->len++] = v;
+}
+
+static inline void telem_put_u16(telem_rec_t *r, uint16_t v)
+{
+    telem_put_u8(r, (uint8_t)v);
+    telem_put_u8(r, (uint8_t)(v >> 8));
+}
+
+static inline void telem_put_u32(telem_rec_t *r, uint32_t v)
+{
+    telem_put_u16(r, (uint16_t)v);
+    telem_put_u16(r, (uint16_t)(v >> 16));
+}
+
+// Añade seq y CRC y codifica en out (>= TELEM_MAX_FRAME). Devuelve los bytes
+// a transmitir, incluidos los dos delimitadores.
+static inline size_t telem_finish(telem_rec_t *r, uint8_t seq, uint8_t *out)
+{
+    r->buf[1] = seq;
+    uint16_t crc = telem_crc16(r->buf, r->len);
+    r->buf[r->len] = (uint8_t)crc;
+    r->buf[r->len + 1] = (uint8_t)(crc >> 8);
+
+    out[0] = 0;
+    size_t n = 1 + telem_cobs_encode(r->buf, r->len + 2, out + 1);
+    out[n++] = 0;
+    return n;
+}
+
+// Decodifica y valida una trama recibida (bytes entre dos 0x00). En raw
+// queda type | seq | payload; devuelve la longitud del payload o -1.
+static inline int telem_frame_decode(const uint8_t *enc, size_t len, uint8_t *raw, size_t max)
+{
+    size_t n = telem_cobs_decode(enc, len, raw, max);
+    if (n < 4) return -1;
+    uint16_t crc = (uint16_t)raw[n - 2] | ((uint16_t)raw[n - 1] << 8);
+    if (telem_crc16(raw, n - 2) != crc) return -1;
+    return (int)(n - 4);
+}
+
+static inline uint16_t telem_get_u16(const uint8_t *p)
+{
+    return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+}
+
+static inline uint32_t telem_get_u32(const uint8_t *p)
+{
+    return (uint32_t)telem_get_u16(p) | ((uint32_t)telem_get_u16(p + 2) << 16);
+}
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/ringbuf.h"
+#include "driver/usb_serial_jtag.h"
+#include "esp_timer.h"
+
+#define TELEM_WRITE_CHUNK       512
+
+typedef struct {
+    RingbufHandle_t   rb;
+    SemaphoreHandle_t lock;     // seq y orden en el ring buffer, entre productores
+    StaticSemaphore_t lock_buf;
+    uint8_t           seq;
+    uint32_t          frames;
+    uint32_t          dropped;  // ring buffer lleno: la trama se descarta
+} telem_t;
+
+static telem_t s_telem;
+
+static inline uint32_t telem_now_us(void)
+{
+    return (uint32_t)esp_timer_get_time();
+}
+
+static void telem_writer_task(void *arg)
+{
+    while (1) {
+        size_t n = 0;
+        uint8_t *p = xRingbufferReceiveUpTo(s_telem.rb, &n, portMAX_DELAY, TELEM_WRITE_CHUNK);
+        if (p == NULL) continue;
+        usb_serial_jtag_write_bytes(p, n, portMAX_DELAY);
+        vRingbufferReturnItem(s_telem.rb, p);
+    }
+}
+
+// Instala el driver USB-Serial-JTAG (si la consola no lo ha hecho ya) y
+// arranca la tarea escritora con un ring buffer de buf_size bytes
+static inline esp_err_t telem_start(size_t buf_size, UBaseType_t prio)
+{
+    usb_serial_jtag_driver_config_t cfg = USB_SERIAL_JTAG_DRIVER_CONFIG_DEFAULT();
+    esp_err_t err = usb_serial_jtag_driver_install(&cfg);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) return err;
+
+    s_telem.lock = xSemaphoreCreateMutexStatic(&s_telem.lock_buf);
+    s_telem.rb = xRingbufferCreate(buf_size, RINGBUF_TYPE_BYTEBUF);
+    if (s_telem.rb == NULL) return ESP_ERR_NO_MEM;
+    if (xTaskCreate(telem_writer_task, "telem_tx", 2048, NULL, prio, NULL) != pdPASS) return ESP_ERR_NO_MEM;
+    return ESP_OK;
+}
+
+// Codifica y encola el registro; si el ring buffer está lleno la trama se
+// descarta sin esperar. Seguro desde varias tareas (no desde una ISR): seq
+// se asigna y la trama se encola bajo el mismo mutex, así que en el USB los
+// seq van en orden y un salto es siempre una trama perdida. Un productor
+// sólo espera a que otro termine de codificar y encolar la suya.
+static inline bool telem_send(telem_rec_t *r)
+{
+    uint8_t frame[TELEM_MAX_FRAME];
+
+    if (s_telem.rb == NULL) return false;
+    xSemaphoreTake(s_telem.lock, portMAX_DELAY);
+    size_t n = telem_finish(r, s_telem.seq++, frame);
+    bool ok = xRingbufferSend(s_telem.rb, frame, n, 0) == pdTRUE;
+    if (ok) s_telem.frames++;
+    else s_telem.dropped++;
+    xSemaphoreGive(s_telem.lock);
+    return ok;
+}
+#endif
+
+#endif // TELEMETRY_H
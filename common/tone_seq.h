@@ -0,0 +1,204 @@
+// Secuenciador de tonos sobre LEDC (zumbador pasivo)
+//
+// Sustituye al play_nota de la práctica 1, que generaba la onda con
+// ets_delay_us y tenía la CPU ocupada toda la canción. La partitura se
+// compila una vez antes de tocarla: cada nota (nombre, duración) pasa a un
+// paso (frecuencia en Hz, duración, silencio posterior), de modo que al
+// sonar no hay búsquedas por nombre ni divisiones. Una nota desconocida es
+// un error de compilación de la partitura (se indica cuál), no un acceso a
+// notas[-1].
+//
+// Al tocar, el LEDC genera la onda cuadrada (50 %) y un esp_timer de un
+// disparo avanza de paso: cambia la frecuencia del temporizador LEDC de la
+// voz y programa el siguiente paso contra una hora absoluta, así el error no
+// se acumula a lo largo de la canción. Entre pasos la CPU queda libre.
+//
+// Polifonía: cada voz usa su propio canal y su propio temporizador LEDC (el
+// C3 tiene 4 temporizadores, luego hasta 4 voces con frecuencias
+// distintas). Para que arranquen a la vez se les da la misma hora de inicio.
+//
+// La compilación de partituras no depende de ESP-IDF; las voces sólo se
+// compilan en el ESP32 (ESP_PLATFORM).
+//
+// Uso:
+//     static tone_step_t pasos[N];
+//     int n = tone_compile(notas, NUM_NOTAS, partitura, N, 50, pasos);
+//     static tone_voice_t voz;
+//     tone_voice_init(&voz, PIN, LEDC_CHANNEL_0, LEDC_TIMER_0);
+//     tone_voice_play(&voz, pasos, n, true, 0);
+#ifndef TONE_SEQ_H
+#define TONE_SEQ_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+// Nota de la escala: nombre y frecuencia fundamental
+typedef struct {
+    const char *name;
+    uint16_t    freq_hz;
+} tone_note_t;
+
+// Nota de la partitura tal como se escribe
+typedef struct {
+    const char *name;           // NULL = silencio
+    uint16_t    dur_ms;
+} tone_score_note_t;
+
+// Paso ya compilado: lo único que se usa al tocar
+typedef struct {
+    uint16_t freq_hz;           // 0 = silencio
+    uint16_t dur_ms;
+    uint16_t gap_ms;            // silencio tras la nota (articulación)
+} tone_step_t;
+
+// Compila n notas de la partitura en out (>= n pasos) con gap_ms de silencio
+// tras cada una. Devuelve n, o -(i + 1) si la nota i no está en la escala.
+static inline int tone_compile(const tone_note_t *notes, size_t nnotes, const tone_score_note_t *score, size_t n,
+                               uint16_t gap_ms, tone_step_t *out)
+{
+    for (size_t i = 0; i < n; i++) {
+        uint16_t f = 0;
+        if (score[i].name != NULL) {
+            size_t k = 0;
+            while (k < nnotes && strcmp(score[i].name, notes[k].name) != 0) k++;
+            if (k == nnotes) return -(int)(i + 1);
+            f = notes[k].freq_hz;
+        }
+        out[i] = (tone_step_t){ .freq_hz = f, .dur_ms = score[i].dur_ms, .gap_ms = gap_ms };
+    }
+    return (int)n;
+}
+
+// Duración total en ms de una partitura compilada
+static inline uint32_t tone_length_ms(const tone_step_t *steps, size_t n)
+{
+    uint32_t t = 0;
+    for (size_t i = 0; i < n; i++) t += (uint32_t)steps[i].dur_ms + steps[i].gap_ms;
+    return t;
+}
+
+#ifdef ESP_PLATFORM
+#include "driver/ledc.h"
+#include "esp_timer.h"
+#include "esp_check.h"
+
+#define TONE_LEDC_MODE      LEDC_LOW_SPEED_MODE
+#define TONE_LEDC_RES       LEDC_TIMER_10_BIT   // hasta ~78 kHz, desde ~80 Hz con APB
+#define TONE_DUTY_ON        (1u << (TONE_LEDC_RES - 1))
+
+typedef void (*tone_done_cb_t)(void *arg);
+
+typedef struct {
+    ledc_channel_t      ch;
+    ledc_timer_t        timer;
+    esp_timer_handle_t  tick;
+    const tone_step_t  *steps;
+    size_t              n;
+    size_t              i;
+    bool                in_gap;
+    bool                loop;
+    volatile bool       playing;
+    int64_t             deadline_us;    // hora absoluta del siguiente cambio
+    uint16_t            freq_hz;        // frecuencia cargada en el temporizador LEDC
+    tone_done_cb_t      done;           // fin de la partitura (sin loop), desde la tarea esp_timer
+    void               *done_arg;
+} tone_voice_t;
+
+static inline void tone_voice_output(tone_voice_t *v, uint16_t freq_hz)
+{
+    if (freq_hz != 0 && freq_hz != v->freq_hz) {
+        ledc_set_freq(TONE_LEDC_MODE, v->timer, freq_hz);
+        v->freq_hz = freq_hz;
+    }
+    ledc_set_duty(TONE_LEDC_MODE, v->ch, freq_hz ? TONE_DUTY_ON : 0);
+    ledc_update_duty(TONE_LEDC_MODE, v->ch);
+}
+
+static inline void tone_voice_stop(tone_voice_t *v)
+{
+    esp_timer_stop(v->tick);
+    v->playing = false;
+    tone_voice_output(v, 0);
+}
+
+// Callback del esp_timer: aplica el cambio pendiente y programa el siguiente
+static void tone_voice_tick(void *arg)
+{
+    tone_voice_t *v = arg;
+
+    if (v->in_gap) {
+        tone_voice_output(v, 0);
+        v->deadline_us += (int64_t)v->steps[v->i].gap_ms * 1000;
+        v->in_gap = false;
+        v->i++;
+    } else {
+        if (v->i >= v->n) {
+            if (!v->loop || v->n == 0) {
+                v->playing = false;
+                tone_voice_output(v, 0);
+                if (v->done) v->done(v->done_arg);
+                return;
+            }
+            v->i = 0;
+        }
+        const tone_step_t *s = &v->steps[v->i];
+        tone_voice_output(v, s->freq_hz);
+        v->deadline_us += (int64_t)s->dur_ms * 1000;
+        if (s->gap_ms) v->in_gap = true;
+        else v->i++;
+    }
+
+    int64_t wait = v->deadline_us - esp_timer_get_time();
+    esp_timer_start_once(v->tick, wait > 0 ? (uint64_t)wait : 1);
+}
+
+// Configura el temporizador LEDC y el canal de la voz (en silencio)
+static inline esp_err_t tone_voice_init(tone_voice_t *v, int gpio, ledc_channel_t ch, ledc_timer_t timer)
+{
+    static const char *TAG = "tone";
+
+    *v = (tone_voice_t){ .ch = ch, .timer = timer, .freq_hz = 440 };
+    ledc_timer_config_t tc = {
+        .speed_mode = TONE_LEDC_MODE,
+        .duty_resolution = TONE_LEDC_RES,
+        .timer_num = timer,
+        .freq_hz = v->freq_hz,
+        .clk_cfg = LEDC_AUTO_CLK,
+    };
+    ESP_RETURN_ON_ERROR(ledc_timer_config(&tc), TAG, "timer");
+    ledc_channel_config_t cc = {
+        .gpio_num = gpio,
+        .speed_mode = TONE_LEDC_MODE,
+        .channel = ch,
+        .timer_sel = timer,
+        .duty = 0,
+    };
+    ESP_RETURN_ON_ERROR(ledc_channel_config(&cc), TAG, "canal");
+
+    esp_timer_create_args_t ta = { .callback = tone_voice_tick, .arg = v, .name = "tone" };
+    return esp_timer_create(&ta, &v->tick);
+}
+
+// Empieza a tocar en t_start_us (hora de esp_timer; 0 = ya). Varias voces con
+// la misma t_start_us suenan sincronizadas. La partitura debe seguir viva
+// mientras suena.
+static inline esp_err_t tone_voice_play(tone_voice_t *v, const tone_step_t *steps, size_t n, bool loop,
+                                        int64_t t_start_us)
+{
+    tone_voice_stop(v);
+    v->steps = steps;
+    v->n = n;
+    v->i = 0;
+    v->in_gap = false;
+    v->loop = loop;
+    v->playing = true;
+
+    int64_t now = esp_timer_get_time();
+    v->deadline_us = t_start_us > now ? t_start_us : now;
+    return esp_timer_start_once(v->tick, v->deadline_us > now ? (uint64_t)(v->deadline_us - now) : 1);
+}
+#endif
+
+#endif // TONE_SEQ_H
@@ -0,0 +1,192 @@
+// Recorrido GPS comprimido en segmentos binarios
+//
+// Cada segmento empieza con el primer punto en crudo y sigue con las
+// diferencias respecto al anterior guardado, codificadas zigzag + varint:
+// entre fixes consecutivos dt, dlat y dlon son pequeños, así que un paso
+// típico a pie o en coche ocupa 5-7 bytes frente a los 12 del punto en
+// crudo. Opcionalmente se descartan los puntos que no se alejan más de una
+// banda muerta del último guardado (parado o ruido del receptor). La
+// distancia se mide en metros en las dos direcciones: dlon se escala por
+// cos(lat) en Q15, calculado una vez con el primer punto de cada segmento
+// (en un segmento de un minuto la latitud apenas cambia).
+//
+// Formato del segmento (little-endian):
+//   u8 versión | u16 nº puntos | u32 t0 (ms UTC) | i32 lat0 | i32 lon0 (1e-7 grados)
+//   y por cada punto siguiente: varint(zigzag(dt)), varint(zigzag(dlat)), varint(zigzag(dlon))
+//
+// No depende de ESP-IDF: el servidor (web_service/server.js) decodifica el
+// mismo formato y las pruebas de host lo comprueban con track_decode().
+//
+// Uso:
+//     static track_seg_t seg;
+//     track_init(&seg, 3);                     // banda muerta de 3 m
+//     if (!track_add(&seg, t_ms, lat_e7, lon_e7)) { publicar; track_reset; track_add(...); }
+//     uint16_t len = track_close(&seg);        // seg.data[0..len) listo para enviar
+#ifndef TRACK_H
+#define TRACK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#define TRACK_VERSION       1
+#define TRACK_HDR_LEN       15
+#define TRACK_PT_MAX_LEN    15      // 3 varints de hasta 5 bytes
+#define TRACK_SEG_MAX_BYTES 512     // un mensaje MQTT por segmento
+#define TRACK_E7_PER_M      90      // 1 m ~ 90e-7 grados de latitud
+
+typedef struct {
+    uint32_t time_ms;       // hora UTC, ms desde las 00:00
+    int32_t  lat_e7;
+    int32_t  lon_e7;
+} track_point_t;
+
+typedef struct {
+    uint8_t  data[TRACK_SEG_MAX_BYTES];
+    uint16_t len;
+    uint16_t npoints;
+    uint32_t skipped;       // puntos descartados por la banda muerta
+    uint32_t t0;
+    int32_t  deadband_e7;   // 0 = se guardan todos los puntos
+    uint32_t lon_scale_q15; // cos(lat0) en Q15: dlon -> distancia en e7 de latitud
+    track_point_t prev;     // último punto guardado
+} track_seg_t;
+
+static inline uint16_t track_put_varint(uint8_t *out, uint64_t v)
+{
+    uint16_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+static inline uint64_t track_zigzag(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+// cos(lat) en Q15 (32768 = 1). Sólo se evalúa al abrir un segmento.
+static inline uint32_t track_cos_q15(int32_t lat_e7)
+{
+    float c = cosf((float)lat_e7 * (3.14159265f / 1.8e9f));
+    return c > 0.0f ? (uint32_t)(c * 32768.0f + 0.5f) : 0;
+}
+
+static inline void track_reset(track_seg_t *t)
+{
+    t->len = 0;
+    t->npoints = 0;
+    t->skipped = 0;
+}
+
+static inline void track_init(track_seg_t *t, uint32_t deadband_m)
+{
+    t->deadband_e7 = (int32_t)(deadband_m * TRACK_E7_PER_M);
+    track_reset(t);
+}
+
+static inline bool track_full(const track_seg_t *t)
+{
+    return t->len + TRACK_PT_MAX_LEN > TRACK_SEG_MAX_BYTES || t->npoints == UINT16_MAX;
+}
+
+// Añade un fix válido. Devuelve false si el segmento debe cerrarse antes.
+static inline bool track_add(track_seg_t *t, uint32_t time_ms, int32_t lat_e7, int32_t lon_e7)
+{
+    uint8_t *d = t->data;
+
+    if (t->npoints == 0) {
+        d[0] = TRACK_VERSION;
+        memcpy(&d[3],  &time_ms, 4);
+        memcpy(&d[7],  &lat_e7, 4);
+        memcpy(&d[11], &lon_e7, 4);
+        t->len = TRACK_HDR_LEN;
+        t->npoints = 1;
+        t->t0 = time_ms;
+        t->prev = (track_point_t){ time_ms, lat_e7, lon_e7 };
+        if (t->deadband_e7 > 0) t->lon_scale_q15 = track_cos_q15(lat_e7);
+        return true;
+    }
+
+    int64_t dlat = (int64_t)lat_e7 - t->prev.lat_e7;
+    int64_t dlon = (int64_t)lon_e7 - t->prev.lon_e7;
+    int64_t dt   = (int64_t)time_ms - t->prev.time_ms;
+
+    // Banda muerta: se ignoran los puntos a menos de deadband_e7 del último
+    // guardado, con dlon llevado a la escala de la latitud
+    if (t->deadband_e7 > 0) {
+        int64_t dx = dlon * (int64_t)t->lon_scale_q15 / 32768;
+        if (dlat * dlat + dx * dx < (int64_t)t->deadband_e7 * t->deadband_e7) {
+            t->skipped++;
+            return true;
+        }
+    }
+    if (track_full(t)) return false;
+
+    t->len += track_put_varint(&d[t->len], track_zigzag(dt));
+    t->len += track_put_varint(&d[t->len], track_zigzag(dlat));
+    t->len += track_put_varint(&d[t->len], track_zigzag(dlon));
+    t->npoints++;
+    t->prev = (track_point_t){ time_ms, lat_e7, lon_e7 };
+    return true;
+}
+
+// Cierra el segmento: escribe el nº de puntos en la cabecera y devuelve la longitud
+static inline uint16_t track_close(track_seg_t *t)
+{
+    memcpy(&t->data[1], &t->npoints, 2);
+    return t->len;
+}
+
+// --------------------- Decodificación ---------------------
+static inline bool track_get_varint(const uint8_t *d, uint16_t len, uint16_t *pos, uint64_t *v)
+{
+    *v = 0;
+    for (unsigned shift = 0; shift < 64 && *pos < len; shift += 7) {
+        uint8_t b = d[(*pos)++];
+        *v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+static inline int64_t track_unzigzag(uint64_t v)
+{
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+// Reconstruye hasta max puntos de un segmento cerrado. Devuelve el nº de
+// puntos, o -1 si el segmento está truncado o no es de esta versión.
+static inline int track_decode(const uint8_t *d, uint16_t len, track_point_t *out, int max)
+{
+    if (len < TRACK_HDR_LEN || d[0] != TRACK_VERSION) return -1;
+
+    uint16_t n;
+    track_point_t p;
+    memcpy(&n, &d[1], 2);
+    memcpy(&p.time_ms, &d[3], 4);
+    memcpy(&p.lat_e7, &d[7], 4);
+    memcpy(&p.lon_e7, &d[11], 4);
+
+    uint16_t pos = TRACK_HDR_LEN;
+    for (int i = 0; i < n; i++) {
+        if (i > 0) {
+            uint64_t dt, dlat, dlon;
+            if (!track_get_varint(d, len, &pos, &dt) || !track_get_varint(d, len, &pos, &dlat) ||
+                !track_get_varint(d, len, &pos, &dlon)) {
+                return -1;
+            }
+            p.time_ms += (uint32_t)track_unzigzag(dt);
+            p.lat_e7 += (int32_t)track_unzigzag(dlat);
+            p.lon_e7 += (int32_t)track_unzigzag(dlon);
+        }
+        if (i < max) out[i] = p;
+    }
+    return pos == len ? n : -1;
+}
+
+#endif // TRACK_H
@@ -0,0 +1,279 @@
+// Protocolo binario UBX (u-blox) para el receptor NEO-7
+//
+// Decodificador de tramas incremental con checksum Fletcher-8 y constructores
+// de los mensajes de configuración CFG-PRT / CFG-RATE / CFG-MSG. La parte de
+// protocolo no depende de ESP-IDF; ubx_neo7_configure() sólo se compila en el
+// ESP32 (ESP_PLATFORM).
+//
+// Trama: 0xB5 0x62 | class | id | len (LE16) | payload | CK_A CK_B
+// El checksum se calcula sobre class, id, len y payload.
+#ifndef UBX_H
+#define UBX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#define UBX_SYNC1           0xB5
+#define UBX_SYNC2           0x62
+#define UBX_MAX_PAYLOAD     128
+
+#define UBX_CLASS_NAV       0x01
+#define UBX_CLASS_ACK       0x05
+#define UBX_CLASS_CFG       0x06
+
+#define UBX_NAV_PVT         0x07
+#define UBX_ACK_NAK         0x00
+#define UBX_ACK_ACK         0x01
+#define UBX_CFG_PRT         0x00
+#define UBX_CFG_MSG         0x01
+#define UBX_CFG_RATE        0x08
+
+#define UBX_NAV_PVT_LEN     84      // u-blox 7 (protocolo 14); u-blox 8 añade 8 bytes al final
+
+// NAV-PVT decodificado (mismas unidades que el receptor)
+typedef struct {
+    uint32_t itow_ms;
+    uint16_t year;
+    uint8_t  month, day, hour, min, sec;
+    uint8_t  valid;         // bit0 fecha válida, bit1 hora válida
+    uint8_t  fix_type;      // 0 sin fix, 2 = 2D, 3 = 3D
+    bool     fix_ok;        // flags.gnssFixOK
+    uint8_t  num_sv;
+    int32_t  lon_e7;        // grados * 1e7
+    int32_t  lat_e7;
+    int32_t  hmsl_mm;
+    uint32_t hacc_mm;
+    int32_t  gspeed_mms;    // velocidad sobre el suelo, mm/s
+    int32_t  head_e5;       // rumbo de movimiento, grados * 1e5
+    uint16_t pdop_e2;
+} ubx_nav_pvt_t;
+
+typedef enum {
+    UBX_ST_SYNC1 = 0,
+    UBX_ST_SYNC2,
+    UBX_ST_CLASS,
+    UBX_ST_ID,
+    UBX_ST_LEN1,
+    UBX_ST_LEN2,
+    UBX_ST_PAYLOAD,
+    UBX_ST_CK_A,
+    UBX_ST_CK_B,
+} ubx_state_t;
+
+typedef struct {
+    ubx_state_t state;
+    uint8_t  cls;
+    uint8_t  id;
+    uint16_t len;
+    uint16_t idx;
+    uint8_t  ck_a, ck_b;
+    uint8_t  payload[UBX_MAX_PAYLOAD];
+
+    // Contadores
+    uint32_t frames;        // tramas con checksum correcto
+    uint32_t cks_errors;
+    uint32_t overflows;     // payload mayor que UBX_MAX_PAYLOAD
+} ubx_parser_t;
+
+static inline void ubx_init(ubx_parser_t *p)
+{
+    *p = (ubx_parser_t){0};
+}
+
+static inline uint16_t ubx_u16(const uint8_t *b) { return (uint16_t)(b[0] | (b[1] << 8)); }
+static inline uint32_t ubx_u32(const uint8_t *b)
+{
+    return (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+static inline int32_t ubx_i32(const uint8_t *b) { return (int32_t)ubx_u32(b); }
+
+static inline void ubx_ck(ubx_parser_t *p, uint8_t b)
+{
+    p->ck_a += b;
+    p->ck_b += p->ck_a;
+}
+
+// Procesa un byte. Devuelve true cuando se completa una trama con checksum
+// correcto; la trama queda en p->cls, p->id, p->len y p->payload.
+static inline bool ubx_feed(ubx_parser_t *p, uint8_t b)
+{
+    switch (p->state) {
+    case UBX_ST_SYNC1:
+        if (b == UBX_SYNC1) p->state = UBX_ST_SYNC2;
+        return false;
+
+    case UBX_ST_SYNC2:
+        p->state = (b == UBX_SYNC2) ? UBX_ST_CLASS : (b == UBX_SYNC1 ? UBX_ST_SYNC2 : UBX_ST_SYNC1);
+        p->ck_a = p->ck_b = 0;
+        return false;
+
+    case UBX_ST_CLASS:
+        p->cls = b;
+        ubx_ck(p, b);
+        p->state = UBX_ST_ID;
+        return false;
+
+    case UBX_ST_ID:
+        p->id = b;
+        ubx_ck(p, b);
+        p->state = UBX_ST_LEN1;
+        return false;
+
+    case UBX_ST_LEN1:
+        p->len = b;
+        ubx_ck(p, b);
+        p->state = UBX_ST_LEN2;
+        return false;
+
+    case UBX_ST_LEN2:
+        p->len |= (uint16_t)(b << 8);
+        ubx_ck(p, b);
+        p->idx = 0;
+        if (p->len > UBX_MAX_PAYLOAD) {
+            p->overflows++;
+            p->state = UBX_ST_SYNC1;
+        } else {
+            p->state = p->len ? UBX_ST_PAYLOAD : UBX_ST_CK_A;
+        }
+        return false;
+
+    case UBX_ST_PAYLOAD:
+        p->payload[p->idx++] = b;
+        ubx_ck(p, b);
+        if (p->idx >= p->len) p->state = UBX_ST_CK_A;
+        return false;
+
+    case UBX_ST_CK_A:
+        if (b != p->ck_a) {
+            p->cks_errors++;
+            p->state = (b == UBX_SYNC1) ? UBX_ST_SYNC2 : UBX_ST_SYNC1;
+            return false;
+        }
+        p->state = UBX_ST_CK_B;
+        return false;
+
+    case UBX_ST_CK_B:
+        p->state = UBX_ST_SYNC1;
+        if (b != p->ck_b) {
+            p->cks_errors++;
+            return false;
+        }
+        p->frames++;
+        return true;
+    }
+    return false;
+}
+
+static inline bool ubx_is(const ubx_parser_t *p, uint8_t cls, uint8_t id)
+{
+    return p->cls == cls && p->id == id;
+}
+
+static inline bool ubx_decode_nav_pvt(const ubx_parser_t *p, ubx_nav_pvt_t *m)
+{
+    if (!ubx_is(p, UBX_CLASS_NAV, UBX_NAV_PVT) || p->len < UBX_NAV_PVT_LEN) return false;
+    const uint8_t *b = p->payload;
+
+    m->itow_ms    = ubx_u32(&b[0]);
+    m->year       = ubx_u16(&b[4]);
+    m->month      = b[6];
+    m->day        = b[7];
+    m->hour       = b[8];
+    m->min        = b[9];
+    m->sec        = b[10];
+    m->valid      = b[11];
+    m->fix_type   = b[20];
+    m->fix_ok     = (b[21] & 0x01) != 0;
+    m->num_sv     = b[23];
+    m->lon_e7     = ubx_i32(&b[24]);
+    m->lat_e7     = ubx_i32(&b[28]);
+    m->hmsl_mm    = ubx_i32(&b[36]);
+    m->hacc_mm    = ubx_u32(&b[40]);
+    m->gspeed_mms = ubx_i32(&b[60]);
+    m->head_e5    = ubx_i32(&b[64]);
+    m->pdop_e2    = ubx_u16(&b[76]);
+    return true;
+}
+
+// --------------------- Construcción de tramas ---------------------
+// Escribe la trama completa en out (len + 8 bytes) y devuelve su longitud
+static inline size_t ubx_build(uint8_t *out, uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len)
+{
+    uint8_t ck_a = 0, ck_b = 0;
+    out[0] = UBX_SYNC1;
+    out[1] = UBX_SYNC2;
+    out[2] = cls;
+    out[3] = id;
+    out[4] = (uint8_t)(len & 0xFF);
+    out[5] = (uint8_t)(len >> 8);
+    if (len) memcpy(&out[6], payload, len);
+    for (size_t i = 2; i < 6 + (size_t)len; i++) {
+        ck_a += out[i];
+        ck_b += ck_a;
+    }
+    out[6 + len] = ck_a;
+    out[7 + len] = ck_b;
+    return 8 + (size_t)len;
+}
+
+// CFG-PRT: UART1, 8N1, entrada UBX+NMEA, salida sólo UBX
+static inline size_t ubx_cfg_prt_uart(uint8_t *out, uint32_t baud)
+{
+    uint8_t pl[20] = {0};
+    pl[0] = 1;                                  // portID = UART1
+    pl[4] = 0xD0; pl[5] = 0x08;                 // mode: 8 bits, sin paridad, 1 stop
+    pl[8]  = (uint8_t)(baud);
+    pl[9]  = (uint8_t)(baud >> 8);
+    pl[10] = (uint8_t)(baud >> 16);
+    pl[11] = (uint8_t)(baud >> 24);
+    pl[12] = 0x03;                              // inProtoMask: UBX | NMEA
+    pl[14] = 0x01;                              // outProtoMask: UBX
+    return ubx_build(out, UBX_CLASS_CFG, UBX_CFG_PRT, pl, sizeof(pl));
+}
+
+// CFG-RATE: periodo de medida en ms, una solución por medida, referencia GPS
+static inline size_t ubx_cfg_rate(uint8_t *out, uint16_t meas_ms)
+{
+    uint8_t pl[6] = { (uint8_t)meas_ms, (uint8_t)(meas_ms >> 8), 1, 0, 1, 0 };
+    return ubx_build(out, UBX_CLASS_CFG, UBX_CFG_RATE, pl, sizeof(pl));
+}
+
+// CFG-MSG: activa cls/id con la tasa indicada en el puerto actual
+static inline size_t ubx_cfg_msg(uint8_t *out, uint8_t cls, uint8_t id, uint8_t rate)
+{
+    uint8_t pl[3] = { cls, id, rate };
+    return ubx_build(out, UBX_CLASS_CFG, UBX_CFG_MSG, pl, sizeof(pl));
+}
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/uart.h"
+
+// Pasa el NEO-7 de NMEA a 9600 baudios a UBX NAV-PVT a `baud` y `rate_hz`.
+// La UART ya debe estar instalada a la velocidad por defecto del módulo.
+static inline void ubx_neo7_configure(uart_port_t uart, uint32_t baud, uint32_t rate_hz)
+{
+    uint8_t frame[32];
+    size_t n;
+
+    // CFG-PRT se envía a la velocidad antigua; el ACK llega ya a la nueva
+    n = ubx_cfg_prt_uart(frame, baud);
+    uart_write_bytes(uart, frame, n);
+    uart_wait_tx_done(uart, pdMS_TO_TICKS(100));
+    vTaskDelay(pdMS_TO_TICKS(100));
+    uart_set_baudrate(uart, baud);
+    uart_flush_input(uart);
+
+    n = ubx_cfg_rate(frame, (uint16_t)(1000 / rate_hz));
+    uart_write_bytes(uart, frame, n);
+
+    n = ubx_cfg_msg(frame, UBX_CLASS_NAV, UBX_NAV_PVT, 1);
+    uart_write_bytes(uart, frame, n);
+    uart_wait_tx_done(uart, pdMS_TO_TICKS(100));
+}
+#endif
+
+#endif // UBX_H
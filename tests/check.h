@@ -0,0 +1,90 @@
+// Mínimo necesario para las pruebas de host de common/
+//
+// Cada prueba es un ejecutable C11 que incluye este fichero (el primero,
+// por _POSIX_C_SOURCE) y la cabecera de common/ que prueba (la parte
+// portable, sin ESP_PLATFORM). CHECK cuenta
+// los fallos sin abortar, para ver todos de una vez; check_done() imprime el
+// resumen y da el código de salida. tests/run.sh compila y ejecuta todas.
+//
+// Las medidas de tiempo (bench) son del host: sirven para comparar
+// variantes y detectar regresiones, no como cifra del ESP32-C3.
+#ifndef CHECK_H
+#define CHECK_H
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L     // clock_gettime con -std=c11
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#ifndef TEST_DATA
+#define TEST_DATA "tests/data"      // run.sh pasa la ruta absoluta
+#endif
+
+static int check_run, check_failed;
+
+#define CHECK(cond) do {                                                        \
+        check_run++;                                                            \
+        if (!(cond)) {                                                          \
+            check_failed++;                                                     \
+            fprintf(stderr, "%s:%d: falla: %s\n", __FILE__, __LINE__, #cond);   \
+        }                                                                       \
+    } while (0)
+
+#define CHECK_EQ(a, b) do {                                                     \
+        long long va_ = (long long)(a), vb_ = (long long)(b);                   \
+        check_run++;                                                            \
+        if (va_ != vb_) {                                                       \
+            check_failed++;                                                     \
+            fprintf(stderr, "%s:%d: falla: %s == %s (%lld != %lld)\n",          \
+                    __FILE__, __LINE__, #a, #b, va_, vb_);                      \
+        }                                                                       \
+    } while (0)
+
+static inline int check_done(const char *name)
+{
+    printf("%-12s %d comprobaciones, %d fallos\n", name, check_run, check_failed);
+    return check_failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// Reloj monotónico en ns
+static inline uint64_t check_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// Evita que el compilador elimine el trabajo medido
+static volatile uint32_t check_sink;
+
+// Carga un fichero de tests/data entero en memoria (NULL si no está)
+static inline uint8_t *check_load(const char *name, size_t *len)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", TEST_DATA, name);
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "no se puede abrir %s\n", path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *buf = malloc((size_t)n + 1);
+    if (buf != NULL && fread(buf, 1, (size_t)n, f) != (size_t)n) {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    if (buf != NULL) {
+        buf[n] = 0;
+        *len = (size_t)n;
+    }
+    return buf;
+}
+
+#endif // CHECK_H
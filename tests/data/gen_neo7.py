@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+# Genera los registros NMEA de prueba (formato y cadencia del NEO-7) con un
+# trayecto simulado: posición real + ruido gaussiano de ~1 m, velocidad y
+# rumbo coherentes. Los ficheros .nmea de este directorio salen de aquí:
+#
+#     python3 tests/data/gen_neo7.py
+#
+# No son capturas de un receptor real; sirven para reproducir la carga
+# (tramas por época, longitud de línea, tasa) y para tener trayectos con la
+# estadística de un paseo y de un coche.
+import math
+import os
+import random
+
+
+def cks(body):
+    c = 0
+    for ch in body:
+        c ^= ord(ch)
+    return "$%s*%02X\r\n" % (body, c)
+
+
+def coord(v, deg_digits, pos, neg):
+    h = pos if v >= 0 else neg
+    v = abs(v)
+    d = int(v)
+    m = (v - d) * 60.0
+    return "%0*d%08.5f" % (deg_digits, d, m), h
+
+
+def hms(t):
+    t = round(t, 2)
+    h = int(t // 3600) % 24
+    m = int(t // 60) % 60
+    s = t - math.floor(t / 60) * 60
+    return "%02d%02d%05.2f" % (h, m, s)
+
+
+def track(name, hz, seconds, speed_ms, turn_dps, seed, t0=36000.0):
+    rnd = random.Random(seed)
+    lat, lon = 40.4523, -3.7266           # Ciudad Universitaria, Madrid
+    course = 35.0
+    alt = 650.0
+    out = []
+    dt = 1.0 / hz
+    for k in range(int(seconds * hz)):
+        t = t0 + k * dt
+        course = (course + rnd.gauss(turn_dps, 4.0) * dt) % 360.0
+        v = max(0.0, speed_ms + rnd.gauss(0.0, speed_ms * 0.05))
+        dn = v * dt * math.cos(math.radians(course))
+        de = v * dt * math.sin(math.radians(course))
+        lat += dn / 111320.0
+        lon += de / (111320.0 * math.cos(math.radians(lat)))
+        nlat = lat + rnd.gauss(0.0, 1.0) / 111320.0
+        nlon = lon + rnd.gauss(0.0, 1.0) / (111320.0 * math.cos(math.radians(lat)))
+        la, ns = coord(nlat, 2, "N", "S")
+        lo, ew = coord(nlon, 3, "E", "W")
+        kn = v / 0.514444
+        ts = hms(t)
+        sats = 8 + rnd.randint(-1, 1)
+        hdop = 0.9 + rnd.random() * 0.3
+        out.append(cks("GPRMC,%s,A,%s,%s,%s,%s,%.3f,%.2f,171026,,,A" % (ts, la, ns, lo, ew, kn, course)))
+        out.append(cks("GPVTG,%.2f,T,,M,%.3f,N,%.3f,K,A" % (course, kn, v * 3.6)))
+        out.append(cks("GPGGA,%s,%s,%s,%s,%s,1,%02d,%.2f,%.1f,M,51.2,M,," % (ts, la, ns, lo, ew, sats, hdop, alt)))
+        out.append(cks("GPGSA,A,3,02,05,07,13,15,20,24,30,,,,,%.2f,%.2f,%.2f" % (hdop * 1.7, hdop, hdop * 1.4)))
+        out.append(cks("GPGLL,%s,%s,%s,%s,%s,A,A" % (la, ns, lo, ew, ts)))
+    path = os.path.join(os.path.dirname(os.path.abspath(__file__)), name)
+    with open(path, "w", newline="") as f:
+        f.write("".join(out))
+
+
+if __name__ == "__main__":
+    track("neo7_paseo_10hz.nmea", 10, 60, 1.4, 0.0, 1)
+    track("neo7_coche_1hz.nmea", 1, 600, 12.0, 1.5, 2)
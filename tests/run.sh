@@ -0,0 +1,32 @@
+#!/bin/sh
+# Pruebas de host de common/: compila cada tests/test_*.c con gcc en C11
+# estricto (sin ESP-IDF) y lo ejecuta. Sale con error si alguna falla.
+#
+#     sh tests/run.sh            # todas
+#     sh tests/run.sh nmea ubx   # sólo test_nmea.c y test_ubx.c
+set -u
+root=$(cd "$(dirname "$0")/.." && pwd)
+out=$(mktemp -d)
+trap 'rm -rf "$out"' EXIT
+CC=${CC:-gcc}
+CFLAGS=${CFLAGS:--O2}
+
+if [ $# -gt 0 ]; then
+    tests=""
+    for t in "$@"; do tests="$tests $root/tests/test_$t.c"; done
+else
+    tests=$(ls "$root"/tests/test_*.c)
+fi
+
+fail=0
+for src in $tests; do
+    name=$(basename "$src" .c)
+    if ! $CC -std=c11 $CFLAGS -Wall -Wextra -Werror -I"$root/common" -I"$root/tests" \
+            -DTEST_DATA="\"$root/tests/data\"" -o "$out/$name" "$src" -lm; then
+        echo "$name: no compila"
+        fail=1
+        continue
+    fi
+    "$out/$name" || fail=1
+done
+exit $fail
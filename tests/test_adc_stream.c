@@ -0,0 +1,107 @@
+// Anillo de muestras del ADC (common/adc_stream.h): índices de bloque que
+// siguen contando con el anillo lleno, bloques que no cruzan un hueco y la
+// conversión a mV por tabla
+#include "check.h"
+
+#include "adc_stream.h"
+
+static adc_ring_t ring;
+
+static void test_contiguous(void)
+{
+    uint16_t out[64];
+    uint32_t first = 0;
+
+    ring = (adc_ring_t){ 0 };
+    for (uint32_t i = 0; i < 100; i++) CHECK(adc_ring_push(&ring, (uint16_t)(i * 3), i));
+    CHECK_EQ(adc_ring_pop(&ring, out, 25, &first), 25);
+    CHECK_EQ(first, 0);
+    CHECK_EQ(out[24], 72);
+    CHECK_EQ(adc_ring_pop(&ring, out, 64, &first), 64);
+    CHECK_EQ(first, 25);
+    CHECK_EQ(adc_ring_pop(&ring, out, 64, &first), 11);
+    CHECK_EQ(first, 89);
+    CHECK_EQ(adc_ring_pop(&ring, out, 64, &first), 0);
+    CHECK_EQ(adc_ring_count(&ring), 0);
+}
+
+// Con el anillo lleno las muestras se pierden pero consumen índice: el
+// bloque que empieza tras el hueco lleva el índice real de su primera muestra
+static void test_overrun(void)
+{
+    uint16_t out[ADC_STREAM_RING];
+    uint32_t first = 0, idx = 0;
+
+    ring = (adc_ring_t){ 0 };
+    for (; idx < ADC_STREAM_RING; idx++) CHECK(adc_ring_push(&ring, (uint16_t)idx, idx));
+    for (int i = 0; i < 37; i++, idx++) CHECK(!adc_ring_push(&ring, (uint16_t)idx, idx));
+    CHECK_EQ(ring.overruns, 37);
+
+    // El consumidor libera 10 huecos; el productor sigue en su índice
+    CHECK_EQ(adc_ring_pop(&ring, out, 10, &first), 10);
+    CHECK_EQ(first, 0);
+    for (int i = 0; i < 10; i++, idx++) CHECK(adc_ring_push(&ring, (uint16_t)idx, idx));
+
+    // Un bloque grande se corta justo antes del hueco
+    CHECK_EQ(adc_ring_pop(&ring, out, ADC_STREAM_RING, &first), ADC_STREAM_RING - 10);
+    CHECK_EQ(first, 10);
+    CHECK_EQ(adc_ring_pop(&ring, out, ADC_STREAM_RING, &first), 10);
+    CHECK_EQ(first, ADC_STREAM_RING + 37);
+    CHECK_EQ(out[0], (uint16_t)(ADC_STREAM_RING + 37));
+}
+
+// Huecos arbitrarios (p. ej. tramas del DMA descartadas) y contadores que
+// dan la vuelta a los 32 bits: out[i] siempre es la muestra first + i
+static void test_gaps_wrap(void)
+{
+    uint16_t out[40];
+    uint32_t first, idx = 0xFFFFFF00u, expect = idx;
+    uint64_t x = 12345;
+    int bad = 0, got = 0;
+
+    ring = (adc_ring_t){ .head = 0xFFFFFFF0u, .tail = 0xFFFFFFF0u };
+    for (int round = 0; round < 2000; round++) {
+        x = x * 6364136223846793005ull + 1442695040888963407ull;
+        int npush = (int)((x >> 40) % 50);
+        if ((x >> 20) % 8 == 0) idx += (uint32_t)((x >> 10) % 200);     // hueco
+        for (int i = 0; i < npush; i++, idx++) adc_ring_push(&ring, (uint16_t)(idx * 7), idx);
+
+        size_t n = adc_ring_pop(&ring, out, 1 + (x >> 50) % 40, &first);
+        for (size_t i = 0; i < n; i++) {
+            if (out[i] != (uint16_t)((first + (uint32_t)i) * 7)) bad++;
+        }
+        if (n > 0) {
+            if ((int32_t)(first - expect) < 0) bad++;   // nunca hacia atrás
+            expect = first + (uint32_t)n;
+            got += (int)n;
+        }
+    }
+    CHECK_EQ(bad, 0);
+    CHECK(got > 10000);
+}
+
+static void test_mv(void)
+{
+    adc_mv_lut_t l;
+    int bad = 0;
+
+    adc_mv_lut_linear(&l, 2500);
+    for (uint32_t raw = 0; raw <= 4095; raw++) {
+        int32_t exact = (int32_t)((raw * 2500 + 2047) / 4095);
+        int32_t d = (int32_t)adc_mv_from_raw(&l, raw) - exact;
+        if (d > 1 || d < -1) bad++;
+    }
+    CHECK_EQ(bad, 0);
+    CHECK_EQ(adc_mv_from_raw(&l, 0), 0);
+    CHECK(adc_mv_from_raw(&l, 4095) >= 2499);      // 1 LSB en la última cuenta
+    CHECK_EQ(adc_mv_from_raw(&l, 9999), adc_mv_from_raw(&l, 4095));
+}
+
+int main(void)
+{
+    test_contiguous();
+    test_overrun();
+    test_gaps_wrap();
+    test_mv();
+    return check_done("adc_stream");
+}
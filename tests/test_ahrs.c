@@ -0,0 +1,286 @@
+// Filtro Mahony Q30 (common/ahrs.h) frente al complementario en float de
+// p3_LSM6DS33.c sobre una traza de IMU a 416 Hz con orientación conocida:
+// error de roll/pitch y tiempo por actualización.
+//
+// La traza se sintetiza aquí y no se lee de una captura: hace falta la
+// orientación verdadera para medir el error, y una captura del LSM6DS33 no
+// la tiene. Se integra un perfil de velocidades angulares en double y se
+// cuantiza como el sensor (8.75 mdps/LSB, 0.061 mg/LSB) con ruido, sesgo
+// residual del giroscopio y aceleraciones lineales.
+//
+// El tiempo es del host y sirve para comparar los dos filtros; los ciclos en
+// la ESP32-C3 (sin FPU, donde el complementario emula atan2f y sqrtf) los
+// registra el propio p3 en fusion_cycles.
+#include "check.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "ahrs.h"
+
+#define FS_HZ           416
+#define SECONDS         70
+#define N_SAMPLES       (FS_HZ * SECONDS)
+#define GYRO_DPS_LSB    (8.75 / 1000.0)
+#define ACC_G_LSB       (0.061 / 1000.0)
+#define GYRO_DEADZONE   1.0         // dps, como en p3
+#define DEG             (3.14159265358979 / 180.0)
+
+typedef struct {
+    int16_t g[3], a[3];             // LSB, ya sin offset de calibración
+    float   roll, pitch;            // verdad, grados
+} imu_sample_t;
+
+static imu_sample_t trace[N_SAMPLES];
+
+static double gauss(uint64_t *s)
+{
+    double u = 0;
+    for (int i = 0; i < 12; i++) {
+        *s = *s * 6364136223846793005u + 1442695040888963407u;
+        u += (double)(*s >> 11) / 9007199254740992.0;
+    }
+    return u - 6.0;
+}
+
+static int16_t sat16(double v)
+{
+    v = floor(v + 0.5);
+    return (int16_t)(v > 32767 ? 32767 : v < -32768 ? -32768 : v);
+}
+
+// Velocidad angular en ejes del sensor (dps) y aceleración lineal en ejes
+// del mundo (g) del perfil de prueba
+static void profile(double t, double w[3], double lin[3])
+{
+    const double pi2 = 2 * 3.14159265358979;
+    w[0] = w[1] = w[2] = 0;
+    lin[0] = lin[1] = lin[2] = 0;
+
+    if (t >= 10 && t < 30) {                    // balanceo: ±30° roll, ±20° pitch
+        double u = t - 10;
+        w[0] = 30 * pi2 * 0.5 * cos(pi2 * 0.5 * u);
+        w[1] = 20 * pi2 * 0.3 * cos(pi2 * 0.3 * u);
+    } else if (t >= 30 && t < 32) {             // se inclina 20° en roll
+        w[0] = 10;
+    } else if (t >= 32 && t < 44) {             // tres vueltas a 90 dps sobre su eje Z inclinado
+        w[2] = 90;
+    } else if (t >= 44 && t < 46) {             // vuelve a horizontal
+        w[0] = -10;
+    } else if (t >= 50 && t < 65) {             // arrancadas de 0.3 g cada 3 s, quieto
+        if (fmod(t - 50, 3) < 1) lin[0] = 0.3;
+    }
+}
+
+static void build_trace(void)
+{
+    double q[4] = { 1, 0, 0, 0 };
+    const int sub = 20;
+    const double dt = 1.0 / FS_HZ / sub;
+    uint64_t seed = 42;
+    // Sesgo residual tras la calibración, por debajo de la zona muerta
+    const double bias[3] = { 0.4, -0.3, 0.2 };
+
+    for (int i = 0; i < N_SAMPLES; i++) {
+        double w[3], lin[3];
+        for (int k = 0; k < sub; k++) {
+            profile((i * sub + k) * dt, w, lin);
+            double hx = w[0] * DEG * dt / 2, hy = w[1] * DEG * dt / 2, hz = w[2] * DEG * dt / 2;
+            double q0 = q[0] - q[1] * hx - q[2] * hy - q[3] * hz;
+            double q1 = q[1] + q[0] * hx + q[2] * hz - q[3] * hy;
+            double q2 = q[2] + q[0] * hy - q[1] * hz + q[3] * hx;
+            double q3 = q[3] + q[0] * hz + q[1] * hy - q[2] * hx;
+            double n = sqrt(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+            q[0] = q0 / n; q[1] = q1 / n; q[2] = q2 / n; q[3] = q3 / n;
+        }
+        profile((double)i / FS_HZ, w, lin);
+
+        // Lo que mide el acelerómetro: R^T * ((0, 0, 1) + lin)
+        double f[3] = { lin[0], lin[1], 1 + lin[2] };
+        double r[3][3] = {
+            { 1 - 2 * (q[2] * q[2] + q[3] * q[3]), 2 * (q[1] * q[2] - q[0] * q[3]), 2 * (q[1] * q[3] + q[0] * q[2]) },
+            { 2 * (q[1] * q[2] + q[0] * q[3]), 1 - 2 * (q[1] * q[1] + q[3] * q[3]), 2 * (q[2] * q[3] - q[0] * q[1]) },
+            { 2 * (q[1] * q[3] - q[0] * q[2]), 2 * (q[2] * q[3] + q[0] * q[1]), 1 - 2 * (q[1] * q[1] + q[2] * q[2]) },
+        };
+        imu_sample_t *s = &trace[i];
+        for (int k = 0; k < 3; k++) {
+            double ab = r[0][k] * f[0] + r[1][k] * f[1] + r[2][k] * f[2];
+            s->a[k] = sat16(ab / ACC_G_LSB + gauss(&seed) * 60);          // ~4 mg rms
+            s->g[k] = sat16((w[k] + bias[k]) / GYRO_DPS_LSB + gauss(&seed) * 10);
+        }
+        s->roll = (float)(atan2(2 * (q[0] * q[1] + q[2] * q[3]), 1 - 2 * (q[1] * q[1] + q[2] * q[2])) / DEG);
+        s->pitch = (float)(asin(2 * (q[0] * q[2] - q[3] * q[1])) / DEG);
+    }
+}
+
+typedef struct {
+    double sum2, max;
+    int n;
+} err_t;
+
+static void err_add(err_t *e, float est, float truth)
+{
+    double d = fabs(fmod(est - truth + 540.0, 360.0) - 180.0);
+    e->sum2 += d * d;
+    if (d > e->max) e->max = d;
+    e->n++;
+}
+
+static double err_rms(const err_t *e)
+{
+    return sqrt(e->sum2 / e->n);
+}
+
+// Fases del perfil en las que se mide el error: en movimiento (balanceo,
+// inclinación y giro) y quieto con arrancadas, donde el acelerómetro no
+// distingue la aceleración lineal de una inclinación
+enum { PH_MOTION, PH_LINEAR, PH_N };
+
+static int phase(int i)
+{
+    double t = (double)i / FS_HZ;
+    if (t >= 10 && t < 48) return PH_MOTION;
+    if (t >= 50 && t < 66) return PH_LINEAR;
+    return -1;
+}
+
+typedef struct {
+    err_t roll[PH_N], pitch[PH_N];
+    double ns;
+} result_t;
+
+// Mahony Q30 tal como lo alimenta p3 (zona muerta en LSB, rad/s Q16)
+static result_t run_mahony(int reps)
+{
+    const float dt = 1.0f / FS_HZ;
+    const int32_t dt_q30 = AHRS_Q30(dt);
+    const int32_t gyro_rad_q30 = AHRS_Q30((float)GYRO_DPS_LSB * AHRS_PI / 180.0f);
+    const int32_t dead_lsb = (int32_t)lround(GYRO_DEADZONE / GYRO_DPS_LSB);
+    result_t res = {0};
+    ahrs_mahony_t f;
+
+    uint64_t t0 = check_ns();
+    for (int r = 0; r < reps; r++) {
+        ahrs_mahony_init(&f, AHRS_Q16(0.5f), AHRS_Q16(0.0f));
+        for (int i = 0; i < N_SAMPLES; i++) {
+            int32_t g_q16[3], a[3];
+            for (int k = 0; k < 3; k++) {
+                int32_t g = trace[i].g[k];
+                if (g > -dead_lsb && g < dead_lsb) g = 0;
+                g_q16[k] = (int32_t)(((int64_t)g * gyro_rad_q30) >> 14);
+                a[k] = trace[i].a[k];
+            }
+            ahrs_mahony_update(&f, g_q16, a, dt_q30);
+        }
+        check_sink += (uint32_t)f.q[0];
+    }
+    res.ns = (double)(check_ns() - t0) / ((double)N_SAMPLES * reps);
+
+    // Pasada aparte para el error: los ángulos en float no entran en el tiempo
+    ahrs_mahony_init(&f, AHRS_Q16(0.5f), AHRS_Q16(0.0f));
+    for (int i = 0; i < N_SAMPLES; i++) {
+        int32_t g_q16[3], a[3];
+        for (int k = 0; k < 3; k++) {
+            int32_t g = trace[i].g[k];
+            if (g > -dead_lsb && g < dead_lsb) g = 0;
+            g_q16[k] = (int32_t)(((int64_t)g * gyro_rad_q30) >> 14);
+            a[k] = trace[i].a[k];
+        }
+        ahrs_mahony_update(&f, g_q16, a, dt_q30);
+        int ph = phase(i);
+        if (ph < 0) continue;
+        float roll, pitch, yaw;
+        ahrs_mahony_euler_deg(&f, &roll, &pitch, &yaw);
+        err_add(&res.roll[ph], roll, trace[i].roll);
+        err_add(&res.pitch[ph], pitch, trace[i].pitch);
+    }
+    return res;
+}
+
+// Complementario de p3_LSM6DS33.c (AHRS_COMPLEMENTARY), con sus constantes
+static void complementary_step(const imu_sample_t *s, float dt, float alpha_lp, float beta_cf, float st[4])
+{
+    float ax = s->a[0] * (float)ACC_G_LSB, ay = s->a[1] * (float)ACC_G_LSB, az = s->a[2] * (float)ACC_G_LSB;
+    float gx = s->g[0] * (float)GYRO_DPS_LSB, gy = s->g[1] * (float)GYRO_DPS_LSB;
+    if (fabsf(gx) < GYRO_DEADZONE) gx = 0;
+    if (fabsf(gy) < GYRO_DEADZONE) gy = 0;
+
+    float roll_acc  = atan2f(ay, az) * 180.0f / AHRS_PI;
+    float pitch_acc = atan2f(-ax, sqrtf(ay * ay + az * az)) * 180.0f / AHRS_PI;
+    st[2] = alpha_lp * roll_acc  + (1.0f - alpha_lp) * st[2];
+    st[3] = alpha_lp * pitch_acc + (1.0f - alpha_lp) * st[3];
+    st[0] = beta_cf * (st[0] + gx * dt) + (1.0f - beta_cf) * st[2];
+    st[1] = beta_cf * (st[1] + gy * dt) + (1.0f - beta_cf) * st[3];
+}
+
+static result_t run_complementary(int reps)
+{
+    const float dt = 1.0f / FS_HZ;
+    const float alpha_lp = dt / (0.9f + dt);
+    const float beta_cf  = 4.9f / (4.9f + dt);
+    result_t res = {0};
+    float st[4];
+
+    uint64_t t0 = check_ns();
+    for (int r = 0; r < reps; r++) {
+        memset(st, 0, sizeof(st));
+        for (int i = 0; i < N_SAMPLES; i++) complementary_step(&trace[i], dt, alpha_lp, beta_cf, st);
+        check_sink += (uint32_t)st[0];
+    }
+    res.ns = (double)(check_ns() - t0) / ((double)N_SAMPLES * reps);
+
+    memset(st, 0, sizeof(st));
+    for (int i = 0; i < N_SAMPLES; i++) {
+        complementary_step(&trace[i], dt, alpha_lp, beta_cf, st);
+        int ph = phase(i);
+        if (ph < 0) continue;
+        err_add(&res.roll[ph], st[0], trace[i].roll);
+        err_add(&res.pitch[ph], st[1], trace[i].pitch);
+    }
+    return res;
+}
+
+static void test_inv_sqrt(void)
+{
+    // 1/sqrt en todo el rango que usa el filtro (acelerómetro crudo y |q|^2 Q60)
+    double worst = 0;
+    for (double m = 1; m < 1.8e19; m *= 1.37) {
+        int s;
+        int32_t r = ahrs_inv_sqrt((uint64_t)m, &s);
+        double got = r * pow(2, -(45 + s / 2.0)), want = 1 / sqrt(floor(m));
+        double rel = fabs(got / want - 1);
+        if (rel > worst) worst = rel;
+    }
+    CHECK(worst < 4e-9);
+}
+
+static void print(const char *name, const result_t *r)
+{
+    static const char *const ph_name[PH_N] = { "movimiento", "arrancadas" };
+    printf("ahrs %-15s %.0f ns/actualización\n", name, r->ns);
+    for (int p = 0; p < PH_N; p++) {
+        printf("     %-15s roll rms %5.2f° max %5.2f°, pitch rms %5.2f° max %5.2f°\n", ph_name[p],
+               err_rms(&r->roll[p]), r->roll[p].max, err_rms(&r->pitch[p]), r->pitch[p].max);
+    }
+}
+
+int main(void)
+{
+    test_inv_sqrt();
+    build_trace();
+
+    result_t m = run_mahony(20), c = run_complementary(20);
+    print("Mahony Q30", &m);
+    print("complementario", &c);
+
+    // En movimiento el complementario (ejes desacoplados) se aleja decenas de
+    // grados al girar inclinado; el Mahony debe quedarse en pocas décimas
+    CHECK(err_rms(&m.roll[PH_MOTION]) < 1.0 && err_rms(&m.pitch[PH_MOTION]) < 1.0);
+    CHECK(m.roll[PH_MOTION].max < 3.0 && m.pitch[PH_MOTION].max < 3.0);
+    CHECK(err_rms(&m.roll[PH_MOTION]) < err_rms(&c.roll[PH_MOTION]) / 4);
+    CHECK(err_rms(&m.pitch[PH_MOTION]) < err_rms(&c.pitch[PH_MOTION]) / 4);
+    // Con arrancadas de 0.3 g (16.7° aparentes durante 1 s) Kp = 0.5 deja
+    // seguir parte del falso tilt
+    CHECK(m.pitch[PH_LINEAR].max < 10.0 && m.roll[PH_LINEAR].max < 1.0);
+    return check_done("ahrs");
+}
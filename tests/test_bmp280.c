@@ -0,0 +1,195 @@
+// Compensación del BMP280 (common/bmp280.h): la variante de 32 bits frente a
+// la referencia de 64 bits del datasheet en todo el rango de medida, la caché
+// de la fase de temperatura y banco de ns por muestra de cada camino
+#include "check.h"
+
+#include "bmp280.h"
+
+#define T_MIN_C100      -4000       // rango de medida del datasheet
+#define T_MAX_C100      8500
+#define P_MIN_PA        30000
+#define P_MAX_PA        110000
+#define MAX_ERR_PA      9           // |p32 - p64 / 256| < 0.1 hPa
+
+#define ADC_MAX         0xFFFFF     // 20 bits
+#define T_STEP          1024
+#define P_STEP          16
+
+// Ejemplo del datasheet (apartado 8.2) y dos variaciones con coeficientes
+// del mismo orden (dig_P4, P5, P7-P9 y dig_T1 distintos)
+static const bmp280_calib_t calibs[] = {
+    { 27504, 26435, -1000, 36477, -10685, 3024, 2855, 140, -7, 15500, -14600, 6000 },
+    { 28009, 25654, 50,    38040, -10426, 3024, 3986, -58, -7, 9900,  -10230, 4285 },
+    { 27199, 26513, 50,    36811, -10635, 3024, 6436, 22,  -7, 15500, -14600, 6000 },
+};
+#define N_CALIBS (sizeof(calibs) / sizeof(calibs[0]))
+
+// Valores del ejemplo del datasheet
+static void test_datasheet(void)
+{
+    bmp280_comp_t k;
+    int32_t t100, t_fine;
+    uint32_t pa;
+
+    bmp280_comp_init(&k, &calibs[0]);
+    bmp280_comp(&k, 519888, 415148, &t100, &pa);
+    CHECK_EQ(t100, 2508);
+    bmp280_comp_temp(&k, 519888, &t_fine);
+    CHECK_EQ(t_fine, 128422);
+    CHECK_EQ(bmp280_comp_press64(&calibs[0], t_fine, 415148) / 256, 100653);
+    CHECK(pa >= 100653 - MAX_ERR_PA && pa <= 100653 + MAX_ERR_PA);
+}
+
+// Calibración con dig_P1 = 0: presión 0 en lugar de dividir por cero
+static void test_invalid_calib(void)
+{
+    bmp280_calib_t c = calibs[0];
+    bmp280_comp_t k;
+    int32_t t100;
+    uint32_t pa;
+
+    c.dig_P1 = 0;
+    bmp280_comp_init(&k, &c);
+    bmp280_comp(&k, 519888, 415148, &t100, &pa);
+    CHECK_EQ(pa, 0);
+    CHECK_EQ(t100, 2508);
+}
+
+// Barrido de adc_T y adc_P: en todos los puntos con temperatura y presión
+// dentro del rango de medida, |p32 - p64/256| <= MAX_ERR_PA
+static void test_sweep(void)
+{
+    for (size_t ci = 0; ci < N_CALIBS; ci++) {
+        bmp280_comp_t k;
+        uint32_t points = 0, max_err = 0;
+
+        bmp280_comp_init(&k, &calibs[ci]);
+        for (int32_t adc_T = 0; adc_T <= ADC_MAX; adc_T += T_STEP) {
+            int32_t t_fine;
+            int32_t t100 = bmp280_comp_temp(&k, adc_T, &t_fine);
+            if (t100 < T_MIN_C100 || t100 > T_MAX_C100) continue;
+
+            bmp280_press_prep_t pp;
+            bmp280_press_prep(&k, t_fine, &pp);
+            for (int32_t adc_P = 0; adc_P <= ADC_MAX; adc_P += P_STEP) {
+                uint32_t ref = bmp280_comp_press64(&calibs[ci], t_fine, adc_P);
+                if (ref < P_MIN_PA * 256u || ref > P_MAX_PA * 256u) continue;
+
+                int32_t err = (int32_t)bmp280_press_apply(&k, &pp, adc_P) - (int32_t)((ref + 128) / 256);
+                uint32_t a = (uint32_t)(err < 0 ? -err : err);
+                if (a > max_err) max_err = a;
+                points++;
+            }
+        }
+        CHECK(points > 1000000);
+        CHECK(max_err <= MAX_ERR_PA);
+        printf("bmp280 calibración %zu: %u puntos en rango, error máximo %u Pa\n", ci, points, max_err);
+    }
+}
+
+// bmp280_comp() y bmp280_comp_batch() con la caché dan lo mismo que las
+// fases por separado, cambie o no adc_T entre muestras
+static void test_cache(void)
+{
+    enum { N = 256 };
+    static int32_t adc_T[N], adc_P[N], t100[N];
+    static uint32_t pa[N];
+    bmp280_comp_t k;
+    int bad = 0;
+
+    for (int i = 0; i < N; i++) {
+        adc_T[i] = 519888 + (i / 7) * 37;       // tramos con adc_T repetido
+        adc_P[i] = 415148 + i * 101;
+    }
+    bmp280_comp_init(&k, &calibs[1]);
+    bmp280_comp_batch(&k, adc_T, adc_P, N, t100, pa);
+
+    for (int i = 0; i < N; i++) {
+        bmp280_press_prep_t pp;
+        int32_t t_fine, t, tc;
+        uint32_t p;
+        t = bmp280_comp_temp(&k, adc_T[i], &t_fine);
+        bmp280_press_prep(&k, t_fine, &pp);
+        bmp280_comp(&k, adc_T[i], adc_P[i], &tc, &p);
+        if (t100[i] != t || pa[i] != bmp280_press_apply(&k, &pp, adc_P[i])) bad++;
+        if (tc != t || p != pa[i]) bad++;
+    }
+    CHECK_EQ(bad, 0);
+
+    // Otra calibración: init olvida la fase guardada
+    bmp280_comp_init(&k, &calibs[0]);
+    bmp280_comp(&k, 519888, 415148, &t100[0], &pa[0]);
+    CHECK_EQ(t100[0], 2508);
+}
+
+// ns por muestra: adc_T distinto en cada una (fases 1-3), adc_T repetido
+// (sólo fase 3, lo normal en lecturas seguidas), lote y la referencia de 64 bits
+static void bench(void)
+{
+    enum { N = 4096, REPS = 400 };
+    static int32_t adc_T[N], adc_P[N], t100[N];
+    static uint32_t pa[N];
+    bmp280_comp_t k;
+    uint64_t t0;
+    uint32_t acc = 0;
+
+    for (int i = 0; i < N; i++) {
+        adc_T[i] = 500000 + i * 5;
+        adc_P[i] = 415148 + (i * 7919) % 20000;
+    }
+    bmp280_comp_init(&k, &calibs[0]);
+
+    t0 = check_ns();
+    for (int r = 0; r < REPS; r++) {
+        for (int i = 0; i < N; i++) {
+            int32_t t;
+            uint32_t p;
+            bmp280_comp(&k, adc_T[i] + (r & 1), adc_P[i], &t, &p);
+            acc += p + (uint32_t)t;
+        }
+    }
+    double ns_full = (double)(check_ns() - t0) / ((double)N * REPS);
+
+    t0 = check_ns();
+    for (int r = 0; r < REPS; r++) {
+        for (int i = 0; i < N; i++) {
+            int32_t t;
+            uint32_t p;
+            bmp280_comp(&k, adc_T[0], adc_P[i], &t, &p);
+            acc += p + (uint32_t)t;
+        }
+    }
+    double ns_cached = (double)(check_ns() - t0) / ((double)N * REPS);
+
+    for (int i = 0; i < N; i++) adc_T[i] = 519888 + (i / 32) * 5;     // lotes de 32 a la misma temperatura
+    t0 = check_ns();
+    for (int r = 0; r < REPS; r++) {
+        bmp280_comp_batch(&k, adc_T, adc_P, N, t100, pa);
+        acc += pa[r % N];
+    }
+    double ns_batch = (double)(check_ns() - t0) / ((double)N * REPS);
+
+    int32_t t_fine;
+    bmp280_comp_temp(&k, 519888, &t_fine);
+    t0 = check_ns();
+    for (int r = 0; r < REPS; r++) {
+        for (int i = 0; i < N; i++) acc += bmp280_comp_press64(&calibs[0], t_fine + (r & 1), adc_P[i]);
+    }
+    double ns_64 = (double)(check_ns() - t0) / ((double)N * REPS);
+
+    check_sink = acc;
+    printf("bmp280 comp completa   %.1f ns/muestra\n", ns_full);
+    printf("bmp280 comp con caché  %.1f ns/muestra\n", ns_cached);
+    printf("bmp280 lote de 32      %.1f ns/muestra\n", ns_batch);
+    printf("bmp280 referencia 64b  %.1f ns/muestra (sólo presión)\n", ns_64);
+}
+
+int main(void)
+{
+    test_datasheet();
+    test_invalid_calib();
+    test_sweep();
+    test_cache();
+    bench();
+    return check_done("bmp280");
+}
@@ -0,0 +1,367 @@
+// Registro en flash (common/flash_log.h) sobre una flash NOR simulada en RAM:
+// append/peek/ack, remontaje, cortes a mitad de cabecera y de datos, vuelta
+// del anillo con pendientes pisados y ACK que llega después de una rotación
+#include "check.h"
+
+#include <string.h>
+
+#include "flash_log.h"
+
+#define NSECT       4
+#define RAM_SIZE    (NSECT * FLOG_SECTOR)
+
+// Flash simulada: escribir sólo baja bits, borrar deja 0xFF. budget limita
+// los bytes que se escriben antes de un "corte de corriente" (-1 = sin límite).
+typedef struct {
+    uint8_t mem[RAM_SIZE];
+    long    budget;
+    int     erases;
+} ram_flash_t;
+
+static int ram_read(void *ctx, uint32_t off, void *buf, size_t len)
+{
+    ram_flash_t *r = ctx;
+    if (off + len > RAM_SIZE) return -1;
+    memcpy(buf, &r->mem[off], len);
+    return 0;
+}
+
+static int ram_write(void *ctx, uint32_t off, const void *buf, size_t len)
+{
+    ram_flash_t *r = ctx;
+    const uint8_t *d = buf;
+    if (off + len > RAM_SIZE) return -1;
+    for (size_t i = 0; i < len; i++) {
+        if (r->budget == 0) return -1;
+        if (r->budget > 0) r->budget--;
+        r->mem[off + i] &= d[i];
+    }
+    return 0;
+}
+
+static int ram_erase(void *ctx, uint32_t off, size_t len)
+{
+    ram_flash_t *r = ctx;
+    if (off % FLOG_SECTOR || len % FLOG_SECTOR || off + len > RAM_SIZE) return -1;
+    memset(&r->mem[off], 0xFF, len);
+    r->erases++;
+    return 0;
+}
+
+static ram_flash_t ram;
+
+static flog_io_t ram_io(void)
+{
+    return (flog_io_t){ .ctx = &ram, .read = ram_read, .write = ram_write, .erase = ram_erase, .size = RAM_SIZE };
+}
+
+static void ram_blank(void)
+{
+    memset(ram.mem, 0xFF, sizeof(ram.mem));
+    ram.budget = -1;
+    ram.erases = 0;
+}
+
+// Registro i: len bytes que dependen de i (sin 0xFF, para que un corte a
+// mitad de datos no coincida con flash borrada)
+static size_t rec_make(uint32_t i, size_t len, uint8_t *out)
+{
+    for (size_t k = 0; k < len; k++) out[k] = (uint8_t)((i * 31 + k * 7) % 251);
+    memcpy(out, &i, sizeof(i) < len ? sizeof(i) : len);
+    return len;
+}
+
+// Id del registro en la cola (-1 si no hay o no se puede leer)
+static long peek_id(flog_t *f)
+{
+    uint8_t buf[FLOG_MAX_REC];
+    size_t len;
+    uint32_t id;
+    if (flog_peek(f, buf, sizeof(buf), &len) != FLOG_OK || len < sizeof(id)) return -1;
+    memcpy(&id, buf, sizeof(id));
+    return id;
+}
+
+static void append_n(flog_t *f, uint32_t first, uint32_t n, size_t len)
+{
+    uint8_t buf[FLOG_MAX_REC];
+    for (uint32_t i = first; i < first + n; i++) CHECK_EQ(flog_append(f, buf, rec_make(i, len, buf)), FLOG_OK);
+}
+
+static void test_basic(void)
+{
+    flog_t f;
+    flog_io_t io = ram_io();
+    uint8_t buf[FLOG_MAX_REC], rd[FLOG_MAX_REC];
+    size_t len;
+
+    ram_blank();
+    CHECK_EQ(flog_mount(&f, &io), FLOG_OK);
+    CHECK_EQ(f.pending, 0);
+    CHECK_EQ(flog_peek(&f, rd, sizeof(rd), &len), FLOG_EMPTY);
+    CHECK_EQ(flog_ack(&f), FLOG_STALE);                     // ack sin peek
+
+    CHECK_EQ(flog_append(&f, buf, 0), FLOG_ERR_SIZE);
+    CHECK_EQ(flog_append(&f, buf, FLOG_MAX_REC + 1), FLOG_ERR_SIZE);
+
+    for (uint32_t i = 0; i < 10; i++) CHECK_EQ(flog_append(&f, buf, rec_make(i, 40 + i, buf)), FLOG_OK);
+    CHECK_EQ(f.pending, 10);
+
+    // Cada peek devuelve el contenido exacto, en orden; peek repetido no consume
+    int bad = 0;
+    for (uint32_t i = 0; i < 10; i++) {
+        size_t n = rec_make(i, 40 + i, buf);
+        if (flog_peek(&f, rd, sizeof(rd), &len) != FLOG_OK || len != n || memcmp(rd, buf, n) != 0) bad++;
+        if (flog_peek(&f, rd, sizeof(rd), &len) != FLOG_OK || len != n) bad++;
+        if (flog_ack(&f) != FLOG_OK) bad++;
+        if (flog_ack(&f) != FLOG_STALE) bad++;             // un peek, un ack
+    }
+    CHECK_EQ(bad, 0);
+    CHECK_EQ(f.pending, 0);
+    CHECK_EQ(f.acked, 10);
+
+    // Buffer pequeño: error sin consumir
+    append_n(&f, 100, 1, 64);
+    CHECK_EQ(flog_peek(&f, rd, 16, &len), FLOG_ERR_SIZE);
+    CHECK_EQ(peek_id(&f), 100);
+}
+
+// Remontar reconstruye cabeza, cola y pendientes, y se sigue escribiendo detrás
+static void test_remount(void)
+{
+    flog_t f;
+    flog_io_t io = ram_io();
+
+    ram_blank();
+    flog_mount(&f, &io);
+    append_n(&f, 0, 30, 200);               // más de un sector
+    for (int i = 0; i < 12; i++) {
+        CHECK_EQ(peek_id(&f), i);
+        CHECK_EQ(flog_ack(&f), FLOG_OK);
+    }
+    uint32_t head_sect = f.head_sect, head_off = f.head_off;
+
+    CHECK_EQ(flog_mount(&f, &io), FLOG_OK);
+    CHECK_EQ(f.pending, 18);
+    CHECK_EQ(f.head_sect, head_sect);
+    CHECK_EQ(f.head_off, head_off);
+    CHECK_EQ(peek_id(&f), 12);
+
+    append_n(&f, 30, 5, 200);
+    CHECK_EQ(flog_mount(&f, &io), FLOG_OK);
+    CHECK_EQ(f.pending, 23);
+    int bad = 0;
+    for (long i = 12; i < 35; i++) {
+        if (peek_id(&f) != i || flog_ack(&f) != FLOG_OK) bad++;
+    }
+    CHECK_EQ(bad, 0);
+    CHECK_EQ(f.pending, 0);
+    CHECK_EQ(flog_mount(&f, &io), FLOG_OK);
+    CHECK_EQ(f.pending, 0);
+}
+
+// Corte de corriente tras `cut` bytes del siguiente append: ese registro no
+// cuenta, los anteriores siguen y la próxima escritura abre otro sector
+static void torn_case(long cut)
+{
+    flog_t f;
+    flog_io_t io = ram_io();
+    uint8_t buf[FLOG_MAX_REC];
+
+    ram_blank();
+    flog_mount(&f, &io);
+    append_n(&f, 0, 5, 100);
+    uint32_t sect = f.head_sect;
+
+    ram.budget = cut;
+    CHECK_EQ(flog_append(&f, buf, rec_make(5, 100, buf)), FLOG_ERR_IO);
+    ram.budget = -1;
+
+    CHECK_EQ(flog_mount(&f, &io), FLOG_OK);
+    CHECK_EQ(f.pending, 5);
+    CHECK_EQ(f.head_off, FLOG_SECTOR);      // sector cerrado: no se reescribe encima
+
+    append_n(&f, 6, 2, 100);
+    CHECK(f.head_sect != sect);
+    CHECK_EQ(flog_mount(&f, &io), FLOG_OK);
+    CHECK_EQ(f.pending, 7);
+    int bad = 0;
+    static const long order[] = { 0, 1, 2, 3, 4, 6, 7 };
+    for (int i = 0; i < 7; i++) {
+        if (peek_id(&f) != order[i] || flog_ack(&f) != FLOG_OK) bad++;
+    }
+    CHECK_EQ(bad, 0);
+}
+
+static void test_torn(void)
+{
+    torn_case(1);                           // sólo parte de len
+    torn_case(3);                           // len entero, CRC a medias
+    torn_case(FLOG_REC_HDR);                // cabecera completa, sin datos
+    torn_case(FLOG_REC_HDR + 50);           // datos a medias
+    torn_case(FLOG_REC_HDR + 99);           // falta el último byte
+}
+
+// Sin ACK el anillo da la vuelta: el sector reciclado se cuenta en dropped
+// y la cola pasa al registro más antiguo que sobrevive
+static void test_wrap(void)
+{
+    flog_t f;
+    flog_io_t io = ram_io();
+    const size_t len = 1000;                // 4 registros por sector
+    const uint32_t per_sect = (FLOG_SECTOR - FLOG_HDR_LEN) / (FLOG_REC_HDR + FLOG_ALIGN(len));
+
+    ram_blank();
+    flog_mount(&f, &io);
+    append_n(&f, 0, per_sect * NSECT, len);
+    CHECK_EQ(f.pending, per_sect * NSECT);
+    CHECK_EQ(f.dropped, 0);
+
+    append_n(&f, per_sect * NSECT, 1, len); // recicla el sector 0
+    CHECK_EQ(f.dropped, per_sect);
+    CHECK_EQ(f.pending, per_sect * (NSECT - 1) + 1);
+    CHECK_EQ(peek_id(&f), per_sect);
+
+    // Un ACK a mitad: la cola avanza; tras dos vueltas más, todo coherente
+    CHECK_EQ(flog_ack(&f), FLOG_OK);
+    append_n(&f, per_sect * NSECT + 1, per_sect * NSECT * 2, len);
+    uint32_t total = per_sect * NSECT * 3 + 1;
+    CHECK_EQ(f.appended, total);
+    CHECK_EQ(f.pending + f.dropped + f.acked, total);
+    long oldest = peek_id(&f);
+    CHECK_EQ(oldest, total - f.pending);
+
+    // Remontar tras la vuelta encuentra los mismos pendientes y el mismo orden
+    uint32_t pending = f.pending;
+    CHECK_EQ(flog_mount(&f, &io), FLOG_OK);
+    CHECK_EQ(f.pending, pending);
+    CHECK_EQ(peek_id(&f), oldest);
+
+    // Desgaste uniforme: cada sector borrado las mismas veces (+-1)
+    uint32_t emin = UINT32_MAX, emax = 0;
+    for (uint32_t s = 0; s < NSECT; s++) {
+        flog_sect_hdr_t h;
+        CHECK(flog_read_sect(&f, s, &h));
+        if (h.erases < emin) emin = h.erases;
+        if (h.erases > emax) emax = h.erases;
+    }
+    CHECK(emax - emin <= 1);
+}
+
+// El PUBACK del registro visto con peek llega después de que un append haya
+// reciclado su sector: el ACK no debe marcar el registro que ahora es cola
+static void test_ack_after_rotation(void)
+{
+    flog_t f;
+    flog_io_t io = ram_io();
+    const size_t len = 1000;
+    const uint32_t per_sect = (FLOG_SECTOR - FLOG_HDR_LEN) / (FLOG_REC_HDR + FLOG_ALIGN(len));
+
+    ram_blank();
+    flog_mount(&f, &io);
+    append_n(&f, 0, per_sect * NSECT, len);
+    CHECK_EQ(peek_id(&f), 0);                       // en vuelo
+    append_n(&f, per_sect * NSECT, 1, len);         // pisa el sector 0
+    CHECK_EQ(f.dropped, per_sect);
+
+    uint32_t pending = f.pending;
+    CHECK_EQ(flog_ack(&f), FLOG_STALE);
+    CHECK_EQ(f.pending, pending);
+    CHECK_EQ(f.acked, 0);
+    CHECK_EQ(ram.mem[flog_addr(f.tail_sect, f.tail_off) + offsetof(flog_rec_hdr_t, state)], FLOG_STATE_PENDING);
+    CHECK_EQ(peek_id(&f), per_sect);
+
+    // Mismo sector y desplazamiento pero otra seq: el sector se reabrió
+    // y el registro de la cola es otro
+    ram_blank();
+    flog_mount(&f, &io);
+    append_n(&f, 0, 1, len);
+    CHECK_EQ(peek_id(&f), 0);
+    uint32_t sect = f.tail_sect, off = f.tail_off;
+    CHECK_EQ(flog_ack(&f), FLOG_OK);
+    CHECK_EQ(peek_id(&f), -1);
+    append_n(&f, 1, per_sect * NSECT, len);         // la cabeza vuelve al sector 0
+    while (f.tail_sect != sect || f.tail_off != off) {
+        CHECK_EQ(peek_id(&f) >= 0, 1);
+        CHECK_EQ(flog_ack(&f), FLOG_OK);
+    }
+    f.peeked = true;                                // ACK tardío de la vuelta anterior
+    f.peek_sect = sect;
+    f.peek_off = off;
+    f.peek_seq = 1;
+    CHECK_EQ(flog_ack(&f), FLOG_STALE);
+    CHECK_EQ(ram.mem[flog_addr(sect, off) + offsetof(flog_rec_hdr_t, state)], FLOG_STATE_PENDING);
+}
+
+// Secuencia aleatoria de append/peek/ack/remontaje frente a una cola de
+// referencia (sin pisados: la cola nunca pasa de la capacidad)
+static void test_random(void)
+{
+    enum { OPS = 20000, CAP = 24 };
+    static uint32_t model[1 << 16];
+    uint32_t mh = 0, mt = 0, next = 0;
+    uint64_t x = 0x2545F4914F6CDD1Dull;
+    flog_t f;
+    flog_io_t io = ram_io();
+    int bad = 0;
+
+    ram_blank();
+    flog_mount(&f, &io);
+    for (int op = 0; op < OPS; op++) {
+        x = x * 6364136223846793005ull + 1442695040888963407ull;
+        uint32_t r = (uint32_t)(x >> 33);
+        if (r % 100 < 50 && mh - mt < CAP) {
+            uint8_t buf[FLOG_MAX_REC];
+            if (flog_append(&f, buf, rec_make(next, 4 + r % 300, buf)) != FLOG_OK) bad++;
+            model[mh++ % (1 << 16)] = next++;
+        } else if (r % 100 < 95) {
+            long id = peek_id(&f);
+            if (mh == mt) {
+                if (id != -1) bad++;
+            } else {
+                if (id != (long)model[mt % (1 << 16)]) bad++;
+                if (flog_ack(&f) != FLOG_OK) bad++;
+                mt++;
+            }
+        } else {
+            if (flog_mount(&f, &io) != FLOG_OK) bad++;
+        }
+        if (f.pending != mh - mt) bad++;
+    }
+    CHECK_EQ(bad, 0);
+    CHECK_EQ(f.dropped, 0);
+    CHECK(ram.erases > NSECT);              // el anillo ha dado vueltas
+}
+
+// Coste de append+peek+ack con registros de tamaño de lote típico
+static void bench(void)
+{
+    enum { N = 20000, LEN = 384 };
+    flog_t f;
+    flog_io_t io = ram_io();
+    uint8_t buf[LEN];
+
+    ram_blank();
+    flog_mount(&f, &io);
+    rec_make(1, LEN, buf);
+    uint64_t t0 = check_ns();
+    for (int i = 0; i < N; i++) {
+        flog_append(&f, buf, LEN);
+        check_sink += (uint32_t)peek_id(&f);
+        flog_ack(&f);
+    }
+    double ns = (double)(check_ns() - t0) / N;
+    printf("flash_log append+peek+ack de %d bytes: %.0f ns (%d borrados de sector)\n", LEN, ns, ram.erases);
+}
+
+int main(void)
+{
+    test_basic();
+    test_remount();
+    test_torn();
+    test_wrap();
+    test_ack_after_rotation();
+    test_random();
+    bench();
+    return check_done("flash_log");
+}
@@ -0,0 +1,159 @@
+// Escrituras GPIO por registro (common/gpio_fast.h) sobre los registros
+// simulados (gpio_fast_mock): orden de la tabla de medio paso, patrones
+// construidos en marcha frente a los constantes y, paso a paso del motor,
+// W1TC antes que W1TS y exactamente dos escrituras por paso
+#include "check.h"
+
+#include "gpio_fast.h"
+#include "stepper.h"
+
+static const int pins[4] = { 6, 7, 8, 9 };     // IN1..IN4 de la práctica
+#define COILS_MASK  GPIO_FAST_MASK4(6, 7, 8, 9)
+
+static int popcount(uint32_t v)
+{
+    int n = 0;
+    for (; v; v &= v - 1) n++;
+    return n;
+}
+
+// Bobinas (bits 0..3) que tendría activas OUT
+static uint8_t coils_of(uint32_t out)
+{
+    uint8_t b = 0;
+    for (int k = 0; k < 4; k++) if (out & GPIO_FAST_BIT(pins[k])) b |= (uint8_t)(1u << k);
+    return b;
+}
+
+// Medio paso: IN4+IN1, IN1, IN1+IN2, IN2, ... alternando dos y una bobina;
+// entre estados consecutivos (también del último al primero) cambia una sola
+static void test_half_step_table(void)
+{
+    static const uint8_t expect[8] = { 0x9, 0x1, 0x3, 0x2, 0x6, 0x4, 0xC, 0x8 };
+    int bad = 0;
+
+    for (int i = 0; i < 8; i++) {
+        uint8_t s = stepper_half_step[i], n = stepper_half_step[(i + 1) & 7];
+        CHECK_EQ(s, expect[i]);
+        if (popcount(s) != (i & 1 ? 1 : 2)) bad++;
+        if (popcount((uint32_t)(s ^ n)) != 1) bad++;
+        // dos bobinas: contiguas en el anillo IN1-IN2-IN3-IN4-IN1
+        if (popcount(s) == 2 && s != 0x3 && s != 0x6 && s != 0xC && s != 0x9) bad++;
+        for (int j = 0; j < i; j++) if (stepper_half_step[j] == s) bad++;
+    }
+    CHECK_EQ(bad, 0);
+}
+
+// gpio_fast_pattern_build da lo mismo que GPIO_FAST_PATTERN4 y cada entrada
+// reparte los cuatro pines entre set y clr sin solaparlos
+static void test_pattern_build(void)
+{
+    gpio_fast_pattern_t tab[8];
+    int bad = 0;
+
+    gpio_fast_pattern_build(tab, stepper_half_step, 8, pins, 4);
+    for (int i = 0; i < 8; i++) {
+        gpio_fast_pattern_t c = GPIO_FAST_PATTERN4(stepper_half_step[i], 6, 7, 8, 9);
+        if (tab[i].set != c.set || tab[i].clr != c.clr) bad++;
+        if ((tab[i].set | tab[i].clr) != COILS_MASK || (tab[i].set & tab[i].clr) != 0) bad++;
+        if (coils_of(tab[i].set) != stepper_half_step[i]) bad++;
+    }
+    CHECK_EQ(bad, 0);
+}
+
+static void test_basic_writes(void)
+{
+    gpio_fast_mock_reset();
+    gpio_fast_output_enable(COILS_MASK | GPIO_FAST_BIT(2));
+    CHECK_EQ(gpio_fast_mock.enable, COILS_MASK | GPIO_FAST_BIT(2));
+
+    gpio_fast_mock.out = GPIO_FAST_BIT(2);
+    gpio_fast_set(GPIO_FAST_BIT(6));
+    CHECK_EQ(gpio_fast_out(), GPIO_FAST_BIT(2) | GPIO_FAST_BIT(6));
+    gpio_fast_clear(GPIO_FAST_BIT(2));
+    CHECK_EQ(gpio_fast_out(), GPIO_FAST_BIT(6));
+    CHECK_EQ(gpio_fast_mock.log[1].reg, GPIO_FAST_OUT_W1TS);
+    CHECK_EQ(gpio_fast_mock.log[2].reg, GPIO_FAST_OUT_W1TC);
+
+    // Patrón sin nada que apagar (o encender): una sola escritura
+    uint32_t w = gpio_fast_mock.writes;
+    gpio_fast_write((gpio_fast_pattern_t){ .set = GPIO_FAST_BIT(7), .clr = 0 });
+    CHECK_EQ(gpio_fast_mock.writes - w, 1);
+    gpio_fast_write((gpio_fast_pattern_t){ .set = 0, .clr = GPIO_FAST_BIT(7) });
+    CHECK_EQ(gpio_fast_mock.writes - w, 2);
+    CHECK_EQ(gpio_fast_out(), GPIO_FAST_BIT(6));
+}
+
+// Mueve el motor como lo haría stepper_on_alarm: por cada paso, dos
+// escrituras (W1TC y luego W1TS). Tras apagar sólo quedan las bobinas comunes
+// a los dos estados, nunca más de dos a la vez, y al final OUT es el estado
+// de stepper_half_step[phase]. Las marcas de tiempo siguen a la rampa.
+static int run_steps(stepper_motion_t *m, const gpio_fast_pattern_t *coils, int32_t target, int max_steps)
+{
+    int bad = 0, steps = 0;
+
+    stepper_motion_set_target(m, target, 0);
+    while (steps < max_steps) {
+        uint32_t prev = gpio_fast_mock.out, w = gpio_fast_mock.writes;
+        uint64_t t = gpio_fast_mock.now_us;
+        uint32_t dt = stepper_motion_next(m);
+        if (dt == 0) break;
+
+        gpio_fast_write(coils[m->phase]);
+        steps++;
+        if (gpio_fast_mock.writes - w != 2) {
+            bad++;
+            continue;
+        }
+        const gpio_fast_mock_write_t *c = &gpio_fast_mock.log[w % GPIO_FAST_MOCK_LOG];
+        const gpio_fast_mock_write_t *s = &gpio_fast_mock.log[(w + 1) % GPIO_FAST_MOCK_LOG];
+        if (c->reg != GPIO_FAST_OUT_W1TC || s->reg != GPIO_FAST_OUT_W1TS) bad++;
+        if ((c->out & ~(prev & coils[m->phase].set)) != 0) bad++;
+        if (popcount(c->out) > 2 || popcount(s->out) > 2) bad++;
+        if (coils_of(s->out) != stepper_half_step[m->phase] || s->out != coils[m->phase].set) bad++;
+        if (popcount((uint32_t)(coils_of(prev) ^ coils_of(s->out))) != 1) bad++;
+        if (c->t_us != t || s->t_us != t) bad++;
+        gpio_fast_mock.now_us += dt;
+    }
+    CHECK_EQ(bad, 0);
+    return steps;
+}
+
+static void test_stepper_writes(void)
+{
+    stepper_motion_t m;
+    gpio_fast_pattern_t coils[8];
+
+    gpio_fast_mock_reset();
+    stepper_motion_init(&m, 2038, 200, 800, 2000);
+    gpio_fast_pattern_build(coils, stepper_half_step, 8, pins, 4);
+    gpio_fast_write(coils[m.phase]);                // como stepper_start
+    CHECK_EQ(gpio_fast_out(), coils[0].set);
+
+    // Un cuarto de vuelta hacia delante, media hacia atrás y de vuelta al origen
+    uint32_t w0 = gpio_fast_mock.writes;
+    int n1 = run_steps(&m, coils, 2038 / 4, 4000);
+    CHECK_EQ(n1, 2038 / 4);
+    CHECK_EQ(m.pos, 2038 / 4);
+    int n2 = run_steps(&m, coils, 2038 - 2038 / 4, 4000);
+    CHECK_EQ(n2, 1018);                             // camino corto: hacia atrás
+    CHECK_EQ(m.pos, 2038 - 2038 / 4);
+    int n3 = run_steps(&m, coils, 0, 4000);
+    CHECK_EQ(m.pos, 0);
+    CHECK_EQ(gpio_fast_mock.writes - w0, 2u * (uint32_t)(n1 + n2 + n3));
+    CHECK_EQ(coils_of(gpio_fast_out()), stepper_half_step[m.phase]);
+
+    // Parado: ninguna escritura más
+    uint32_t w = gpio_fast_mock.writes;
+    CHECK_EQ(stepper_motion_next(&m), 0);
+    CHECK_EQ(gpio_fast_mock.writes, w);
+}
+
+int main(void)
+{
+    test_half_step_table();
+    test_pattern_build();
+    test_basic_writes();
+    test_stepper_writes();
+    return check_done("gpio_fast");
+}
@@ -0,0 +1,93 @@
+// Curvas nivel -> duty y troceado de fundidos (common/led_fade.h, parte
+// portable) con las curvas de PWM_led.c (gamma 2.2) y del PPG (lineal)
+#include "check.h"
+
+#include "led_fade.h"
+
+#define DUTY_13BIT  LED_FADE_DUTY_MAX(13)
+
+// Extremos 0 y duty_max y estrictamente creciente
+static int curve_bad(const uint16_t *tab, size_t n, uint32_t duty_max)
+{
+    int bad = 0;
+    if (tab[0] != 0 || tab[n - 1] != duty_max) bad++;
+    for (size_t i = 1; i < n; i++) if (tab[i] <= tab[i - 1]) bad++;
+    return bad;
+}
+
+static void test_curves(void)
+{
+    static uint16_t gamma[256], lineal[21];
+
+    led_gamma_build(gamma, 256, DUTY_13BIT, 2.2f);
+    CHECK_EQ(curve_bad(gamma, 256, DUTY_13BIT), 0);
+    // Con gamma 2.2 los primeros niveles son pasos mínimos de una unidad
+    CHECK_EQ(gamma[1], 1);
+    CHECK(gamma[128] < DUTY_13BIT / 4);
+
+    // PPG: 21 niveles del 5 % exactos
+    led_gamma_build(lineal, 21, DUTY_13BIT, 1.0f);
+    CHECK_EQ(curve_bad(lineal, 21, DUTY_13BIT), 0);
+    CHECK_EQ(lineal[10], DUTY_13BIT / 2);
+    CHECK_EQ(lineal[1], (DUTY_13BIT * 5 + 50) / 100);
+
+    // Más niveles que duty: no se puede forzar, pero no se sale del rango
+    uint16_t corta[16];
+    led_gamma_build(corta, 16, 8, 2.2f);
+    int bad = 0;
+    for (int i = 1; i < 16; i++) if (corta[i] < corta[i - 1] || corta[i] > 8) bad++;
+    CHECK_EQ(bad, 0);
+    CHECK_EQ(corta[15], 8);
+}
+
+static void test_nseg(void)
+{
+    CHECK_EQ(led_fade_nseg(0, 255, 3300, LED_FADE_SEGMENTS), LED_FADE_SEGMENTS);
+    CHECK_EQ(led_fade_nseg(0, 5, 3300, LED_FADE_SEGMENTS), 5);          // pocos niveles
+    CHECK_EQ(led_fade_nseg(0, 255, 50, LED_FADE_SEGMENTS), 2);          // tramos >= 20 ms
+    CHECK_EQ(led_fade_nseg(255, 0, 3300, 0), 1);
+    CHECK_EQ(led_fade_nseg(7, 7, 1000, LED_FADE_SEGMENTS), 1);          // sin cambio
+    CHECK_EQ(led_fade_nseg(0, 255, 0, LED_FADE_SEGMENTS), 1);           // salto inmediato
+}
+
+// Los tramos suman el tiempo pedido, ninguno baja de LED_FADE_MIN_SEG_MS
+// (si hay más de uno), los niveles avanzan sin retroceder y el último es to
+static void check_plan(uint16_t from, uint16_t to, uint32_t ms)
+{
+    uint8_t n = led_fade_nseg(from, to, ms, LED_FADE_SEGMENTS);
+    uint32_t total = 0;
+    uint16_t prev = from, lvl = from;
+    int bad = 0;
+
+    for (uint8_t k = 0; k < n; k++) {
+        uint32_t seg_ms;
+        lvl = led_fade_segment(from, to, ms, n, k, &seg_ms);
+        total += seg_ms;
+        if (n > 1 && seg_ms < LED_FADE_MIN_SEG_MS) bad++;
+        if (to >= from ? (lvl < prev || lvl > to) : (lvl > prev || lvl < to)) bad++;
+        if (n > 1 && lvl == prev) bad++;
+        prev = lvl;
+    }
+    CHECK_EQ(bad, 0);
+    CHECK_EQ(total, ms);
+    CHECK_EQ(lvl, to);
+}
+
+static void test_segments(void)
+{
+    check_plan(0, 255, 3300);           // rampas de PWM_led.c
+    check_plan(255, 0, 3300);
+    check_plan(0, 20, 500);
+    check_plan(3, 200, 77);
+    check_plan(100, 90, 1000);
+    check_plan(10, 10, 200);
+    check_plan(0, 255, 0);
+}
+
+int main(void)
+{
+    test_curves();
+    test_nseg();
+    test_segments();
+    return check_done("led_fade");
+}
@@ -0,0 +1,243 @@
+// Vaciado del FIFO del LSM6DS33 (common/lsm6_fifo.h) contra un FIFO simulado:
+// 4096 palabras en modo continuo, FIFO_STATUS1..4 calculados del contenido y
+// lecturas en ráfaga de FIFO_DATA_OUT
+#include "check.h"
+
+#include <string.h>
+
+#include "lsm6_fifo.h"
+
+#define SIM_WORDS   LSM6_FIFO_MAX_WORDS
+
+typedef struct {
+    uint32_t wr;                    // índice global de la siguiente palabra a escribir
+    uint32_t rd;                    // índice global de la siguiente palabra a leer
+    bool     overrun;
+    int      reads;                 // ráfagas leídas
+    size_t   max_read;              // bytes de la mayor ráfaga
+    int      fail_at;               // número de ráfaga que falla (0 = ninguna)
+} fifo_sim_t;
+
+// Palabra k del patrón de la muestra s: identifica muestra y eje, con signo
+static int16_t word_val(uint32_t w)
+{
+    uint32_t s = w / LSM6_FIFO_WORDS_PER_SAMPLE, k = w % LSM6_FIFO_WORDS_PER_SAMPLE;
+    return (int16_t)(s * 8 + k - 30000);
+}
+
+static void sim_init(fifo_sim_t *f, uint32_t first_word)
+{
+    *f = (fifo_sim_t){ .wr = first_word, .rd = first_word };
+}
+
+// El sensor escribe n palabras; lleno, descarta las más antiguas
+static void sim_push_words(fifo_sim_t *f, uint32_t n)
+{
+    f->wr += n;
+    if (f->wr - f->rd > SIM_WORDS) {
+        f->rd = f->wr - SIM_WORDS;
+        f->overrun = true;
+    }
+}
+
+static void sim_status(const fifo_sim_t *f, uint8_t st[4])
+{
+    uint32_t words = f->wr - f->rd;
+    uint32_t pattern = f->rd % LSM6_FIFO_WORDS_PER_SAMPLE;
+    st[0] = (uint8_t)words;
+    // DIFF_FIFO es de 12 bits: lleno se lee 0 con FIFO_FULL
+    st[1] = (uint8_t)(((words >> 8) & 0x0F) | (f->overrun ? 0x40 : 0) | (words >= SIM_WORDS - 1 ? 0x20 : 0) |
+                      (words >= 64 ? 0x80 : 0));
+    st[2] = (uint8_t)pattern;
+    st[3] = (uint8_t)(pattern >> 8);
+}
+
+static bool sim_read(void *ctx, uint8_t *buf, size_t len)
+{
+    fifo_sim_t *f = ctx;
+    f->reads++;
+    if (f->fail_at == f->reads) return false;
+    if (len > f->max_read) f->max_read = len;
+    for (size_t i = 0; i + 1 < len; i += 2) {
+        int16_t v = f->rd < f->wr ? word_val(f->rd++) : 0;     // vacío: el sensor da ceros
+        buf[i] = (uint8_t)v;
+        buf[i + 1] = (uint8_t)((uint16_t)v >> 8);
+    }
+    f->overrun = false;             // se limpia al leer
+    return true;
+}
+
+static bool sample_is(const lsm6_sample_t *smp, uint32_t s)
+{
+    uint32_t w = s * LSM6_FIFO_WORDS_PER_SAMPLE;
+    return smp->g[0] == word_val(w) && smp->g[1] == word_val(w + 1) && smp->g[2] == word_val(w + 2) &&
+           smp->a[0] == word_val(w + 3) && smp->a[1] == word_val(w + 4) && smp->a[2] == word_val(w + 5);
+}
+
+static uint8_t scratch[32 * LSM6_FIFO_SAMPLE_BYTES];
+static lsm6_sample_t out[SIM_WORDS / LSM6_FIFO_WORDS_PER_SAMPLE + 1];
+
+static int drain(fifo_sim_t *f, int max, bool *overrun)
+{
+    uint8_t st[4];
+    sim_status(f, st);
+    return lsm6_fifo_drain(st, sim_read, f, scratch, 32, out, max, overrun);
+}
+
+static void test_status(void)
+{
+    static const uint8_t st[4] = { 0x34, 0xC2, 0x05, 0x00 };
+    lsm6_fifo_status_t s = lsm6_fifo_parse_status(st);
+    CHECK_EQ(s.words, 0x234);
+    CHECK_EQ(s.pattern, 5);
+    CHECK(s.overrun);
+    CHECK(s.wtm);
+    CHECK_EQ(lsm6_fifo_skip_words(&s), 1);
+    s.words = 0;
+    CHECK_EQ(lsm6_fifo_skip_words(&s), 0);
+
+    // Lleno: DIFF_FIFO = 0 con FIFO_FULL u OVER_RUN
+    static const uint8_t full[4] = { 0x00, 0x60, 0x04, 0x00 };
+    s = lsm6_fifo_parse_status(full);
+    CHECK_EQ(s.words, LSM6_FIFO_MAX_WORDS);
+    CHECK_EQ(lsm6_fifo_skip_words(&s), 2);
+    static const uint8_t empty[4] = { 0x00, 0x00, 0x00, 0x00 };
+    s = lsm6_fifo_parse_status(empty);
+    CHECK_EQ(s.words, 0);
+}
+
+static void test_aligned(void)
+{
+    fifo_sim_t f;
+    bool ovr;
+
+    sim_init(&f, 0);
+    sim_push_words(&f, 100 * LSM6_FIFO_WORDS_PER_SAMPLE);
+    CHECK_EQ(drain(&f, 1000, &ovr), 100);
+    CHECK(!ovr);
+    CHECK_EQ(f.reads, 4);                           // 32 + 32 + 32 + 4, sin descartes
+    CHECK_EQ(f.max_read, sizeof(scratch));
+    int bad = 0;
+    for (int i = 0; i < 100; i++) bad += !sample_is(&out[i], (uint32_t)i);
+    CHECK_EQ(bad, 0);
+    CHECK_EQ(f.rd, f.wr);
+}
+
+// La lectura anterior se quedó en la palabra p de una muestra
+static void test_mid_pattern(void)
+{
+    for (uint32_t p = 1; p < LSM6_FIFO_WORDS_PER_SAMPLE; p++) {
+        fifo_sim_t f;
+        bool ovr;
+        sim_init(&f, 10 * LSM6_FIFO_WORDS_PER_SAMPLE + p);
+        sim_push_words(&f, 50 * LSM6_FIFO_WORDS_PER_SAMPLE - p);
+        CHECK_EQ(drain(&f, 1000, &ovr), 49);
+        CHECK(sample_is(&out[0], 11));
+        CHECK(sample_is(&out[48], 59));
+        CHECK_EQ(f.rd, f.wr);
+        CHECK_EQ(f.reads, 1 + 2);                   // descarte + 32 + 17
+    }
+
+    // Menos palabras que las que faltan para alinear: se descartan todas
+    fifo_sim_t f;
+    bool ovr;
+    sim_init(&f, 3);
+    sim_push_words(&f, 2);
+    CHECK_EQ(drain(&f, 1000, &ovr), 0);
+    CHECK_EQ(f.rd, 5);
+    sim_push_words(&f, 1 + 2 * LSM6_FIFO_WORDS_PER_SAMPLE);
+    CHECK_EQ(drain(&f, 1000, &ovr), 2);
+    CHECK(sample_is(&out[0], 1));
+
+    // Muestra a medio escribir: se queda en el FIFO hasta completarse
+    sim_init(&f, 0);
+    sim_push_words(&f, 3 * LSM6_FIFO_WORDS_PER_SAMPLE + 4);
+    CHECK_EQ(drain(&f, 1000, &ovr), 3);
+    CHECK_EQ(f.wr - f.rd, 4);
+    sim_push_words(&f, 2);
+    CHECK_EQ(drain(&f, 1000, &ovr), 1);
+    CHECK(sample_is(&out[0], 3));
+}
+
+static void test_limits(void)
+{
+    fifo_sim_t f;
+    bool ovr;
+
+    // max menor que lo disponible: el resto queda para la siguiente
+    sim_init(&f, 0);
+    sim_push_words(&f, 100 * LSM6_FIFO_WORDS_PER_SAMPLE);
+    CHECK_EQ(drain(&f, 40, &ovr), 40);
+    CHECK(sample_is(&out[39], 39));
+    CHECK_EQ(drain(&f, 1000, &ovr), 60);
+    CHECK(sample_is(&out[0], 40));
+
+    // Desbordamiento: 4096 no es múltiplo de 6, el FIFO queda a mitad de patrón
+    sim_init(&f, 0);
+    sim_push_words(&f, 800 * LSM6_FIFO_WORDS_PER_SAMPLE);
+    CHECK(f.rd % LSM6_FIFO_WORDS_PER_SAMPLE != 0);
+    uint32_t skip = LSM6_FIFO_WORDS_PER_SAMPLE - f.rd % LSM6_FIFO_WORDS_PER_SAMPLE;
+    int n = drain(&f, 1000, &ovr);
+    CHECK(ovr);
+    CHECK_EQ(n, (SIM_WORDS - skip) / LSM6_FIFO_WORDS_PER_SAMPLE);
+    uint32_t first = (f.wr / LSM6_FIFO_WORDS_PER_SAMPLE) - (uint32_t)n;
+    int bad = 0;
+    for (int i = 0; i < n; i++) bad += !sample_is(&out[i], first + (uint32_t)i);
+    CHECK_EQ(bad, 0);
+
+    // Fallo del bus en el descarte o a mitad de las ráfagas
+    for (int fail = 1; fail <= 3; fail++) {
+        sim_init(&f, 2);
+        sim_push_words(&f, 100 * LSM6_FIFO_WORDS_PER_SAMPLE);
+        f.fail_at = fail;
+        CHECK_EQ(drain(&f, 1000, &ovr), -1);
+    }
+}
+
+// Escrituras y vaciados de tamaños arbitrarios: la secuencia de muestras
+// entregadas es continua salvo donde hubo desbordamiento
+static void test_random(void)
+{
+    fifo_sim_t f;
+    uint32_t seed = 5, expect = 0, total = 0, gaps = 0, overruns = 0;
+    int bad = 0;
+
+    sim_init(&f, 0);
+    for (int it = 0; it < 20000; it++) {
+        seed = seed * 1664525u + 1013904223u;
+        sim_push_words(&f, (seed >> 8) % 1500);
+        seed = seed * 1664525u + 1013904223u;
+        bool ovr;
+        int n = drain(&f, 1 + (int)((seed >> 8) % 200), &ovr);
+        if (n < 0) { bad++; continue; }
+        if (ovr) overruns++;
+        for (int i = 0; i < n; i++) {
+            // word_val sólo distingue 8192 muestras: el salto se deduce módulo 8192
+            uint32_t id = (uint32_t)(out[i].g[0] + 30000) / 8;
+            uint32_t s = expect + ((id - expect) & 8191);
+            if (!sample_is(&out[i], s)) bad++;
+            if (i == 0 && s != expect) {
+                if (!ovr || s < expect) bad++;
+                gaps++;
+            } else if (i > 0 && s != expect) {
+                bad++;
+            }
+            expect = s + 1;
+        }
+        total += (uint32_t)n;
+    }
+    CHECK_EQ(bad, 0);
+    CHECK(gaps <= overruns);
+    CHECK(overruns > 0);
+    printf("lsm6_fifo: %u muestras en 20000 vaciados, %u desbordamientos\n", total, overruns);
+}
+
+int main(void)
+{
+    test_status();
+    test_aligned();
+    test_mid_pattern();
+    test_limits();
+    test_random();
+    return check_done("lsm6_fifo");
+}
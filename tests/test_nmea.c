@@ -0,0 +1,314 @@
+// Pruebas del parser NMEA (common/nmea.h) y repetición de un registro del
+// NEO-7 a 10 Hz (tests/data/neo7_paseo_10hz.nmea, ver gen_neo7.py)
+#include "check.h"
+
+#include <string.h>
+
+#include "nmea.h"
+
+// "$<body>*hh\r\n" con el checksum correcto (o alterado en xor)
+static size_t sentence(char *out, const char *body, uint8_t xor)
+{
+    uint8_t c = 0;
+    for (const char *s = body; *s; s++) c ^= (uint8_t)*s;
+    return (size_t)sprintf(out, "$%s*%02X\r\n", body, c ^ xor);
+}
+
+// Alimenta n bytes; devuelve cuántas tramas soportadas se completaron y deja
+// la última en msg
+static int feed(nmea_parser_t *p, const char *s, size_t n, nmea_msg_t *msg)
+{
+    int k = 0;
+    nmea_msg_t m;
+    for (size_t i = 0; i < n; i++) {
+        if (nmea_feed(p, (uint8_t)s[i], &m)) {
+            *msg = m;
+            k++;
+        }
+    }
+    return k;
+}
+
+static int feed_str(nmea_parser_t *p, const char *s, nmea_msg_t *msg)
+{
+    return feed(p, s, strlen(s), msg);
+}
+
+static void test_rmc(void)
+{
+    nmea_parser_t p;
+    nmea_msg_t m;
+    char s[128];
+
+    nmea_init(&p);
+    sentence(s, "GPRMC,123519.25,A,4807.03800,N,01131.00000,W,22.400,84.45,230394,,,A", 0);
+    CHECK_EQ(feed_str(&p, s, &m), 1);
+    CHECK_EQ(m.type, NMEA_RMC);
+    CHECK(strcmp(m.talker, "GP") == 0);
+    CHECK(m.rmc.valid);
+    CHECK_EQ(m.rmc.time_ms, ((12 * 60 + 35) * 60 + 19) * 1000 + 250);
+    CHECK_EQ(m.rmc.lat_e7, 481173000);      // 48 + 7.038/60
+    CHECK_EQ(m.rmc.lon_e7, -115166667);     // -(11 + 31/60)
+    CHECK_EQ(m.rmc.speed_mms, 11524);       // 22.4 kn
+    CHECK(m.rmc.has_course);
+    CHECK_EQ(m.rmc.course_cdeg, 8445);
+    CHECK_EQ(m.rmc.date, 230394);
+    CHECK_EQ(p.sentences, 1);
+}
+
+static void test_checksum(void)
+{
+    nmea_parser_t p;
+    nmea_msg_t m;
+    char s[128], ok[128];
+    const char *body = "GPVTG,84.45,T,,M,22.400,N,41.485,K,A";
+
+    sentence(ok, body, 0);
+
+    // Checksum incorrecto: se cuenta y no se entrega, la siguiente sí
+    nmea_init(&p);
+    sentence(s, body, 0x01);
+    CHECK_EQ(feed_str(&p, s, &m), 0);
+    CHECK_EQ(p.cks_errors, 1);
+    CHECK_EQ(p.sentences, 0);
+    CHECK_EQ(feed_str(&p, ok, &m), 1);
+    CHECK_EQ(m.type, NMEA_VTG);
+
+    // Un byte del cuerpo cambiado en tránsito
+    nmea_init(&p);
+    strcpy(s, ok);
+    s[8] = '5';
+    CHECK_EQ(feed_str(&p, s, &m), 0);
+    CHECK_EQ(p.cks_errors, 1);
+
+    // Hexadecimal en minúsculas: válido
+    nmea_init(&p);
+    strcpy(s, ok);
+    for (char *c = strchr(s, '*'); *c; c++) if (*c >= 'A' && *c <= 'F') *c = (char)(*c - 'A' + 'a');
+    CHECK_EQ(feed_str(&p, s, &m), 1);
+
+    // Carácter no hexadecimal en cualquiera de las dos cifras
+    nmea_init(&p);
+    CHECK_EQ(feed_str(&p, "$GPVTG,,T,,M,,N,,K,N*G2\r\n", &m), 0);
+    CHECK_EQ(feed_str(&p, "$GPVTG,,T,,M,,N,,K,N*2G\r\n", &m), 0);
+    CHECK_EQ(p.cks_errors, 2);
+
+    // Sin checksum: el fin de línea llega en el cuerpo
+    nmea_init(&p);
+    CHECK_EQ(feed_str(&p, "$GPVTG,84.45,T,,M,22.400,N,41.485,K,A\r\n", &m), 0);
+    CHECK_EQ(p.cks_errors, 1);
+    CHECK_EQ(feed_str(&p, ok, &m), 1);
+}
+
+static void test_overflow(void)
+{
+    nmea_parser_t p;
+    nmea_msg_t m;
+    char body[256], s[300], ok[128];
+
+    sentence(ok, "GPGGA,123519.00,4807.03800,N,01131.00000,E,1,08,0.90,545.4,M,46.9,M,,", 0);
+
+    // "$" + cuerpo + "*hh" = NMEA_MAX_LEN cabe justo; un carácter más, no
+    for (int extra = 0; extra <= 1; extra++) {
+        size_t n = NMEA_MAX_LEN - 4 + (size_t)extra;
+        memset(body, 'X', n);
+        memcpy(body, "GPXXX,", 6);
+        body[n] = '\0';
+        nmea_init(&p);
+        sentence(s, body, 0);
+        feed_str(&p, s, &m);
+        CHECK_EQ(p.overflows, (uint32_t)extra);
+        CHECK_EQ(p.sentences, (uint32_t)(1 - extra));
+        CHECK_EQ(p.unknown, (uint32_t)(1 - extra));
+        // Lo que sigue al desbordamiento se ignora hasta el próximo '$'
+        CHECK_EQ(feed_str(&p, ok, &m), 1);
+        CHECK_EQ(m.type, NMEA_GGA);
+        CHECK_EQ(m.gga.num_sats, 8);
+    }
+
+    // Línea sin fin (basura larga sin '$'): un único desbordamiento
+    nmea_init(&p);
+    memset(s, 'Z', 250);
+    s[0] = '$';
+    CHECK_EQ(feed(&p, s, 250, &m), 0);
+    CHECK_EQ(p.overflows, 1);
+    CHECK_EQ(feed_str(&p, ok, &m), 1);
+
+    // NMEA_MAX_FIELDS campos caben; uno más es desbordamiento
+    for (int extra = 0; extra <= 1; extra++) {
+        char *b = body;
+        b += sprintf(b, "GPXXX");
+        for (int i = 1; i < NMEA_MAX_FIELDS + extra; i++) b += sprintf(b, ",%d", i % 10);
+        nmea_init(&p);
+        sentence(s, body, 0);
+        feed_str(&p, s, &m);
+        CHECK_EQ(p.overflows, (uint32_t)extra);
+        CHECK_EQ(p.sentences, (uint32_t)(1 - extra));
+    }
+}
+
+static void test_empty_fields(void)
+{
+    nmea_parser_t p;
+    nmea_msg_t m;
+    char s[128];
+
+    // RMC sin fix (lo que manda el NEO-7 al arrancar)
+    nmea_init(&p);
+    sentence(s, "GPRMC,,V,,,,,,,,,,N", 0);
+    CHECK_EQ(feed_str(&p, s, &m), 1);
+    CHECK(!m.rmc.valid);
+    CHECK(!m.rmc.has_course);
+    CHECK_EQ(m.rmc.time_ms, 0);
+    CHECK_EQ(m.rmc.lat_e7, 0);
+    CHECK_EQ(m.rmc.lon_e7, 0);
+    CHECK_EQ(m.rmc.speed_mms, 0);
+    CHECK_EQ(m.rmc.date, 0);
+
+    // Con hora y posición pero sin rumbo (parado)
+    sentence(s, "GPRMC,083559.00,A,4027.13810,N,00343.59648,W,0.004,,171026,,,A", 0);
+    CHECK_EQ(feed_str(&p, s, &m), 1);
+    CHECK(m.rmc.valid);
+    CHECK(!m.rmc.has_course);
+    CHECK_EQ(m.rmc.speed_mms, 2);
+    CHECK(m.rmc.lat_e7 > 0 && m.rmc.lon_e7 < 0);
+
+    sentence(s, "GPGGA,,,,,,0,00,99.99,,,,,,", 0);
+    CHECK_EQ(feed_str(&p, s, &m), 1);
+    CHECK_EQ(m.gga.quality, 0);
+    CHECK_EQ(m.gga.num_sats, 0);
+    CHECK_EQ(m.gga.lat_e7, 0);
+    CHECK(m.gga.alt_m == 0.0f);
+
+    sentence(s, "GPVTG,,,,,,,,,N", 0);
+    CHECK_EQ(feed_str(&p, s, &m), 1);
+    CHECK(!m.vtg.has_course);
+    CHECK_EQ(m.vtg.speed_mms, 0);
+
+    // GSA con huecos entre satélites
+    sentence(s, "GPGSA,A,3,02,,07,,,20,,,,,,30,1.85,1.01,1.55", 0);
+    CHECK_EQ(feed_str(&p, s, &m), 1);
+    CHECK_EQ(m.gsa.num_sv, 4);
+    CHECK_EQ(m.gsa.sv[0], 2);
+    CHECK_EQ(m.gsa.sv[3], 30);
+    CHECK_EQ(m.gsa.fix_type, 3);
+
+    // Trama truncada al final ("$GPRMC,123519.00,A*hh"): los campos que
+    // faltan se leen vacíos
+    sentence(s, "GPRMC,123519.00,A", 0);
+    CHECK_EQ(feed_str(&p, s, &m), 1);
+    CHECK(m.rmc.valid);
+    CHECK_EQ(m.rmc.lat_e7, 0);
+    CHECK(!m.rmc.has_course);
+}
+
+static void test_split(void)
+{
+    nmea_parser_t p;
+    nmea_msg_t m;
+    char a[128], b[128], s[512];
+
+    sentence(a, "GPRMC,123519.00,A,4807.03800,N,01131.00000,E,0.500,10.00,230394,,,A", 0);
+    sentence(b, "GPGGA,123519.00,4807.03800,N,01131.00000,E,1,09,0.90,545.4,M,46.9,M,,", 0);
+
+    // La trama llega partida en dos lecturas de la UART, en cualquier punto
+    size_t n = strlen(a);
+    for (size_t cut = 1; cut < n; cut++) {
+        nmea_init(&p);
+        int k = feed(&p, a, cut, &m);
+        k += feed(&p, a + cut, n - cut, &m);
+        CHECK_EQ(k, 1);
+        CHECK_EQ(m.rmc.course_cdeg, 1000);
+    }
+
+    // Bytes perdidos: trama cortada seguida de otra completa
+    nmea_init(&p);
+    size_t len = (size_t)sprintf(s, "%.*s%s", 30, a, b);
+    CHECK_EQ(feed(&p, s, len, &m), 1);
+    CHECK_EQ(m.type, NMEA_GGA);
+    CHECK_EQ(m.gga.num_sats, 9);
+    CHECK_EQ(p.cks_errors, 0);
+
+    // Cortada justo tras el '*' o a mitad de checksum
+    nmea_init(&p);
+    len = (size_t)sprintf(s, "%.*s%s", (int)(strchr(a, '*') - a + 2), a, b);
+    CHECK_EQ(feed(&p, s, len, &m), 1);
+    CHECK_EQ(m.type, NMEA_GGA);
+
+    // Basura y ruido de línea entre tramas
+    nmea_init(&p);
+    len = (size_t)sprintf(s, "\xff\x01garbage\r\n%s**\n%s", a, b);
+    CHECK_EQ(feed(&p, s, len, &m), 2);
+    CHECK_EQ(p.sentences, 2);
+}
+
+// Repite el registro troceado como las lecturas de la UART
+static void test_replay(void)
+{
+    size_t len;
+    uint8_t *log = check_load("neo7_paseo_10hz.nmea", &len);
+    CHECK(log != NULL);
+    if (log == NULL) return;
+
+    nmea_parser_t p;
+    nmea_msg_t m;
+    uint32_t rmc = 0, gga = 0, vtg = 0, gsa = 0, last_ms = 0, bad_step = 0;
+    uint32_t chunk = 1, seed = 1;
+
+    nmea_init(&p);
+    for (size_t i = 0; i < len; i += chunk) {
+        seed = seed * 1103515245u + 12345u;
+        chunk = 1 + (seed >> 16) % 120;         // lecturas de 1..120 bytes
+        if (i + chunk > len) chunk = (uint32_t)(len - i);
+        for (uint32_t j = 0; j < chunk; j++) {
+            if (!nmea_feed(&p, log[i + j], &m)) continue;
+            switch (m.type) {
+            case NMEA_RMC:
+                if (rmc > 0 && m.rmc.time_ms - last_ms != 100) bad_step++;
+                last_ms = m.rmc.time_ms;
+                rmc += m.rmc.valid;
+                break;
+            case NMEA_GGA: gga += m.gga.quality == 1; break;
+            case NMEA_VTG: vtg += m.vtg.has_course; break;
+            case NMEA_GSA: gsa += m.gsa.num_sv == 8; break;
+            default: break;
+            }
+        }
+    }
+    CHECK_EQ(rmc, 600);
+    CHECK_EQ(gga, 600);
+    CHECK_EQ(vtg, 600);
+    CHECK_EQ(gsa, 600);
+    CHECK_EQ(bad_step, 0);
+    CHECK_EQ(p.unknown, 600);                   // GLL
+    CHECK_EQ(p.cks_errors, 0);
+    CHECK_EQ(p.overflows, 0);
+
+    // Banco: el registro entero (60 s a 10 Hz) muchas veces
+    const int reps = 50;
+    uint64_t t0 = check_ns();
+    for (int r = 0; r < reps; r++) {
+        nmea_init(&p);
+        for (size_t i = 0; i < len; i++) {
+            if (nmea_feed(&p, log[i], &m)) check_sink += (uint32_t)m.type;
+        }
+    }
+    uint64_t ns = check_ns() - t0;
+    double epochs = 600.0 * reps, sentences = 3000.0 * reps;
+    printf("nmea: %.1f MB/s, %.0f ns/trama, %.0f ns/época de 5 tramas, %.0fx tiempo real a 10 Hz\n",
+           (double)len * reps / ((double)ns / 1e9) / 1e6, (double)ns / sentences, (double)ns / epochs,
+           60.0 * reps / ((double)ns / 1e9));
+    CHECK((double)ns / epochs < 100e6);         // ni de lejos debe acercarse a 100 ms por época
+    free(log);
+}
+
+int main(void)
+{
+    test_rmc();
+    test_checksum();
+    test_overflow();
+    test_empty_fields();
+    test_split();
+    test_replay();
+    return check_done("nmea");
+}
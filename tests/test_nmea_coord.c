@@ -0,0 +1,212 @@
+// Conversión a punto fijo de common/nmea.h (nmea_field_coord y
+// nmea_field_knots_mms) comparada bit a bit con una referencia en double
+#include "check.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "nmea.h"
+
+// Deja en p una trama "$GPXXX,<a>,<b>*hh" ya validada: campos 1 y 2
+static void load(nmea_parser_t *p, const char *a, const char *b)
+{
+    char s[128];
+    nmea_msg_t m;
+    uint8_t c = 0;
+    int n = sprintf(s, "GPXXX,%s,%s", a, b);
+    for (int i = 0; i < n; i++) c ^= (uint8_t)s[i];
+    n = sprintf(s, "$GPXXX,%s,%s*%02X\r\n", a, b, c);
+    nmea_init(p);
+    for (int i = 0; i < n; i++) nmea_feed(p, (uint8_t)s[i], &m);
+}
+
+// Referencia: ddmm.mmm... -> grados * 1e7 redondeando al más cercano (mitades
+// hacia arriba). Los minutos se llevan a unidades de 1e-7 min dividiendo por
+// una potencia de 10 exacta, así el empate x.5 es exacto en double.
+static int32_t coord_ref(const char *s, char hemi)
+{
+    const char *dot = strchr(s, '.');
+    size_t ni = dot ? (size_t)(dot - s) : strlen(s);
+    double deg = 0, mant = 0;
+    int frac = 0;
+    for (size_t i = 0; i + 2 < ni; i++) deg = deg * 10 + (s[i] - '0');
+    for (size_t i = ni >= 2 ? ni - 2 : 0; i < ni; i++) mant = mant * 10 + (s[i] - '0');
+    if (dot) {
+        for (const char *c = dot + 1; *c; c++, frac++) mant = mant * 10 + (*c - '0');
+    }
+    double min_e7 = frac <= 7 ? mant * pow(10, 7 - frac) : mant / pow(10, frac - 7);
+    double v = deg * 1e7 + floor(min_e7 / 60.0 + 0.5);
+    return (int32_t)((hemi == 'S' || hemi == 'W') ? -v : v);
+}
+
+// Referencia: nudos -> mm/s, primero a milésimas de nudo (como da el NEO-7)
+// y luego a mm/s, ambos redondeando al más cercano
+static uint32_t knots_ref(const char *s)
+{
+    double mkn = 0;
+    int frac = -1;
+    for (const char *c = s; *c; c++) {
+        if (*c == '.') { frac = 0; continue; }
+        if (frac == 3) {
+            if (*c >= '5') mkn += 1;
+            break;
+        }
+        mkn = mkn * 10 + (*c - '0');
+        if (frac >= 0) frac++;
+    }
+    for (frac = frac < 0 ? 0 : frac; frac < 3; frac++) mkn *= 10;
+    return (uint32_t)floor(mkn * 1852.0 / 3600.0 + 0.5);
+}
+
+static int coord_case(const char *s, char hemi)
+{
+    nmea_parser_t p;
+    char h[2] = { hemi, '\0' };
+    load(&p, s, h);
+    int32_t got = nmea_field_coord(&p, 1, 2), want = coord_ref(s, hemi);
+    if (got != want) fprintf(stderr, "coord %s,%c: %d != %d\n", s, hemi ? hemi : '-', got, want);
+    return got == want;
+}
+
+static int knots_case(const char *s)
+{
+    nmea_parser_t p;
+    load(&p, s, "N");
+    uint32_t got = nmea_field_knots_mms(&p, 1), want = knots_ref(s);
+    if (got != want) fprintf(stderr, "knots %s: %u != %u\n", s, got, want);
+    return got == want;
+}
+
+static void test_coord_fixed_cases(void)
+{
+    nmea_parser_t p;
+
+    // Valores exactos a mano
+    load(&p, "4807.038", "N");
+    CHECK_EQ(nmea_field_coord(&p, 1, 2), 481173000);
+    load(&p, "01131.000", "W");
+    CHECK_EQ(nmea_field_coord(&p, 1, 2), -115166667);
+
+    // Hemisferios: S y W negativos, N, E y vacío positivos
+    static const char hemis[] = { 'N', 'S', 'E', 'W', '\0' };
+    for (size_t i = 0; i < sizeof(hemis); i++) {
+        char h[2] = { hemis[i], '\0' };
+        load(&p, "4027.13810", h);
+        int32_t v = nmea_field_coord(&p, 1, 2);
+        CHECK_EQ(v, (hemis[i] == 'S' || hemis[i] == 'W') ? -404523017 : 404523017);
+        CHECK(coord_case("4027.13810", hemis[i]));
+        CHECK(coord_case("00343.59648", hemis[i]));
+    }
+
+    // Borde de minuto: el redondeo arrastra al grado siguiente
+    CHECK(coord_case("4059.9999999", 'N'));
+    load(&p, "4059.9999999", "N");
+    CHECK_EQ(nmea_field_coord(&p, 1, 2), 410000000);
+    load(&p, "4059.9999969", "N");
+    CHECK_EQ(nmea_field_coord(&p, 1, 2), 409999999);
+    CHECK(coord_case("4059.99999", 'N'));
+    CHECK(coord_case("4100.00000", 'N'));
+    CHECK(coord_case("4100.0000003", 'N'));
+    CHECK(coord_case("4100.0000029", 'S'));
+    CHECK(coord_case("4100.0000030", 'S'));     // empate: x.5 hacia arriba en módulo
+
+    // Máximo de dígitos: 3 de grado, 7 decimales y más de los que se usan
+    CHECK(coord_case("17959.9999999", 'W'));
+    load(&p, "17959.9999999", "W");
+    CHECK_EQ(nmea_field_coord(&p, 1, 2), -1800000000);
+    CHECK(coord_case("18000.0000000", 'E'));
+    CHECK(coord_case("9000.0000000", 'S'));
+    CHECK(coord_case("00000.0000001", 'W'));
+    CHECK(coord_case("00000.0000000", 'W'));
+    CHECK(coord_case("4807.03800004999", 'N'));
+    CHECK(coord_case("4807.03800029999", 'N'));
+    CHECK(coord_case("4807.03800030000", 'N'));
+    CHECK(coord_case("4807.0380003", 'N'));
+    CHECK(coord_case("4807", 'N'));
+    CHECK(coord_case("4807.", 'N'));
+}
+
+// Todos los restos módulo 60 en unidades de 1e-7 min, con 5 y 7 decimales
+// (formatos del NEO-7 en NMEA estándar y en alta precisión). mm * 1e7 sólo
+// aporta 0, 40 o 20 al resto, así que basta con mm = 0, 1, 2 y el borde 59.
+static void test_coord_sweep(void)
+{
+    char s[32];
+    int bad = 0, n = 0;
+
+    static const int mms[] = { 0, 1, 2, 59 };
+    for (size_t k = 0; k < sizeof(mms) / sizeof(mms[0]); k++) {
+        int mm = mms[k];
+        for (int f = 0; f < 100000; f++, n++) {
+            sprintf(s, "40%02d.%05d", mm, f);
+            bad += !coord_case(s, (f & 1) ? 'S' : 'N');
+            if (bad > 10) break;
+        }
+    }
+    uint64_t seed = 11;
+    for (int i = 0; i < 400000; i++, n++) {
+        seed = seed * 6364136223846793005u + 1442695040888963407u;
+        uint32_t r = (uint32_t)(seed >> 32);
+        uint32_t d = r % 180, m = (uint32_t)((seed >> 8) % 600000000u);
+        sprintf(s, "%03u%02u.%07u", d, m / 10000000u, m % 10000000u);
+        bad += !coord_case(s, (r & 1) ? 'W' : 'E');
+        if (bad > 20) break;
+    }
+    // Los bordes de segundo de arco: minutos = s/60, que en decimal no son
+    // exactos y caen siempre entre dos valores representables
+    for (int sec = 0; sec < 3600; sec++, n++) {
+        double min = sec / 60.0;
+        sprintf(s, "12%08.5f", min);
+        bad += !coord_case(s, 'N');
+        sprintf(s, "12%010.7f", min);
+        bad += !coord_case(s, 'S');
+    }
+    CHECK_EQ(bad, 0);
+    printf("coord: %d valores comparados\n", n);
+}
+
+static void test_knots(void)
+{
+    nmea_parser_t p;
+    char s[32];
+    int bad = 0;
+
+    load(&p, "22.400", "N");
+    CHECK_EQ(nmea_field_knots_mms(&p, 1), 11524);
+    load(&p, "", "N");
+    CHECK_EQ(nmea_field_knots_mms(&p, 1), 0);
+
+    // Barrido exhaustivo de 0 a 2000 nudos en milésimas (el NEO-7 da 3 decimales)
+    for (uint32_t mkn = 0; mkn <= 2000000; mkn++) {
+        sprintf(s, "%u.%03u", mkn / 1000, mkn % 1000);
+        bad += !knots_case(s);
+        if (bad > 10) break;
+    }
+    CHECK_EQ(bad, 0);
+
+    // Empates en mm/s: mkn * 463 = 450 (mod 900)
+    CHECK(knots_case("0.150"));
+    CHECK(knots_case("1.050"));
+
+    // Menos decimales, más decimales y redondeo en la milésima
+    CHECK(knots_case("7"));
+    CHECK(knots_case("7."));
+    CHECK(knots_case("0.5"));
+    CHECK(knots_case("0.0004999"));
+    CHECK(knots_case("0.0005"));
+    CHECK(knots_case("0.9995"));
+    CHECK(knots_case("12.34549999"));
+
+    // Máximo representable: 4294967.295 nudos en milésimas de 32 bits
+    CHECK(knots_case("4294967.295"));
+    load(&p, "4294967.295", "N");
+    CHECK_EQ(nmea_field_knots_mms(&p, 1), 2209522064u);
+}
+
+int main(void)
+{
+    test_coord_fixed_cases();
+    test_coord_sweep();
+    test_knots();
+    return check_done("nmea_coord");
+}
@@ -0,0 +1,185 @@
+// Planificador del motor paso a paso (common/stepper.h, parte portable):
+// rampa precalculada, camino más corto, frenada antes de invertir el sentido
+// y coste por paso de stepper_motion_next (lo que hace la ISR de la alarma)
+#include "check.h"
+
+#include "stepper.h"
+
+#define SPR         2038        // 28BYJ-48 en medio paso
+#define V_START     200
+#define V_MAX       800
+#define ACCEL       2000
+
+// Lleva el motor al objetivo y comprueba el perfil: ningún intervalo fuera
+// de la rampa, el índice sube o baja de uno en uno y el último paso se da a
+// v_start. Devuelve los pasos dados (-1 si no para en max_steps).
+static int run_to(stepper_motion_t *m, int32_t target, int max_steps)
+{
+    int steps = 0, bad = 0;
+    int prev_k = -1;
+
+    stepper_motion_set_target(m, target, 0);
+    for (;;) {
+        uint8_t phase = m->phase;
+        int32_t pos = m->pos;
+        uint32_t dt = stepper_motion_next(m);
+        if (dt == 0) break;
+        if (++steps > max_steps) return -1;
+
+        if (dt != m->ramp_us[m->k]) bad++;
+        if (prev_k >= 0 && (m->k > prev_k + 1 || m->k + 1 < prev_k)) bad++;
+        if (((phase + m->dir) & 7) != m->phase) bad++;
+        if ((pos + m->dir + SPR) % SPR != m->pos) bad++;
+        prev_k = m->k;
+    }
+    CHECK_EQ(bad, 0);
+    CHECK_EQ(m->dir, 0);
+    if (steps > 0) CHECK_EQ(m->k, 0);
+    return steps;
+}
+
+static void test_ramp(void)
+{
+    stepper_motion_t m;
+    int bad = 0;
+
+    stepper_motion_init(&m, SPR, V_START, V_MAX, ACCEL);
+    CHECK_EQ(m.ramp_us[0], 1000000 / V_START);
+    CHECK_EQ(m.ramp_us[m.nramp - 1], 1000000 / V_MAX);
+    CHECK(m.nramp > 1 && m.nramp <= STEPPER_RAMP_MAX);
+    for (int k = 1; k < m.nramp; k++) {
+        if (m.ramp_us[k] > m.ramp_us[k - 1]) bad++;
+    }
+    CHECK_EQ(bad, 0);
+
+    // Sin aceleración o con v_max <= v_start: velocidad constante
+    stepper_motion_init(&m, SPR, V_START, V_MAX, 0);
+    CHECK_EQ(m.nramp, 1);
+    stepper_motion_init(&m, SPR, V_MAX, V_START, ACCEL);
+    CHECK_EQ(m.nramp, 1);
+    CHECK_EQ(m.ramp_us[0], 1000000 / V_MAX);
+}
+
+static void test_shortest_path(void)
+{
+    stepper_motion_t m;
+
+    stepper_motion_init(&m, SPR, V_START, V_MAX, ACCEL);
+    CHECK_EQ(stepper_motion_cdeg_to_step(&m, 0), 0);
+    CHECK_EQ(stepper_motion_cdeg_to_step(&m, 36000), 0);
+    CHECK_EQ(stepper_motion_cdeg_to_step(&m, 18000), SPR / 2);
+
+    // De 359° a 1°: 12 pasos hacia delante, no casi una vuelta hacia atrás
+    int32_t from = stepper_motion_cdeg_to_step(&m, 35900);
+    int32_t to = stepper_motion_cdeg_to_step(&m, 100);
+    CHECK_EQ(run_to(&m, from, 4 * SPR), SPR - from);
+    CHECK_EQ(stepper_motion_delta(&m, to), 12);
+    CHECK_EQ(run_to(&m, to, 4 * SPR), 12);
+    CHECK_EQ(m.pos, to);
+
+    // Y de vuelta, hacia atrás
+    CHECK_EQ(stepper_motion_delta(&m, from), -12);
+    CHECK_EQ(run_to(&m, from, 4 * SPR), 12);
+    CHECK_EQ(m.pos, from);
+
+    // Media vuelta exacta: hacia delante
+    stepper_motion_init(&m, SPR, V_START, V_MAX, ACCEL);
+    CHECK_EQ(run_to(&m, SPR / 2, 4 * SPR), SPR / 2);
+    CHECK_EQ(m.pos, SPR / 2);
+    CHECK_EQ(m.steps, SPR / 2);
+    CHECK_EQ(m.reversals, 0);
+}
+
+// Con el motor parado, los cambios dentro de la banda muerta no lo arrancan
+static void test_deadband(void)
+{
+    stepper_motion_t m;
+
+    stepper_motion_init(&m, SPR, V_START, V_MAX, ACCEL);
+    CHECK(!stepper_motion_set_target(&m, 3, 3));
+    CHECK(!stepper_motion_set_target(&m, SPR - 3, 3));
+    CHECK_EQ(stepper_motion_next(&m), 0);
+    CHECK(stepper_motion_set_target(&m, 4, 3));
+    CHECK_EQ(m.target, 4);
+}
+
+// El objetivo salta al otro lado a mitad de movimiento: el motor frena hasta
+// v_start (k = 0) antes de invertir, sin pasos a más velocidad de la que da
+// la rampa, y acaba en el nuevo objetivo
+static void test_reversal(void)
+{
+    stepper_motion_t m;
+    int bad = 0, turned_at_k = -1;
+
+    stepper_motion_init(&m, SPR, V_START, V_MAX, ACCEL);
+    stepper_motion_set_target(&m, SPR / 4, 0);
+    for (int i = 0; i < 200; i++) stepper_motion_next(&m);
+    CHECK(m.k > 0);
+    CHECK_EQ(m.dir, 1);
+
+    int32_t at = m.pos;
+    stepper_motion_set_target(&m, (at - 100 + SPR) % SPR, 0);
+    int8_t dir = m.dir;
+    for (int i = 0; i < 4 * SPR; i++) {
+        uint16_t k = m.k;
+        if (stepper_motion_next(&m) == 0) break;
+        if (m.dir != dir) {
+            turned_at_k = k;
+            dir = m.dir;
+        }
+        if (m.k >= m.nramp) bad++;
+    }
+    CHECK_EQ(bad, 0);
+    CHECK_EQ(turned_at_k, 0);
+    CHECK_EQ(m.reversals, 1);
+    CHECK_EQ(m.pos, (at - 100 + SPR) % SPR);
+    CHECK_EQ(m.dir, 0);
+}
+
+// Objetivo demasiado cerca para frenar a tiempo: se pasa y vuelve
+static void test_overshoot(void)
+{
+    stepper_motion_t m;
+
+    stepper_motion_init(&m, SPR, V_START, V_MAX, ACCEL);
+    stepper_motion_set_target(&m, SPR / 4, 0);
+    for (int i = 0; i < 300; i++) stepper_motion_next(&m);
+    int32_t target = (m.pos + 2) % SPR;
+    CHECK(m.k > 2);
+    int n = run_to(&m, target, 4 * SPR);
+    CHECK(n > 2);
+    CHECK_EQ(m.pos, target);
+}
+
+// Lo que cuesta un paso en la ISR (host): vueltas completas ida y vuelta
+static void bench(void)
+{
+    stepper_motion_t m;
+    const int reps = 2000;
+    uint32_t steps = 0;
+
+    stepper_motion_init(&m, SPR, V_START, V_MAX, ACCEL);
+    uint64_t t0 = check_ns();
+    for (int r = 0; r < reps; r++) {
+        stepper_motion_set_target(&m, r & 1 ? 0 : SPR / 2, 0);
+        uint32_t dt;
+        while ((dt = stepper_motion_next(&m)) != 0) {
+            check_sink += dt;
+            steps++;
+        }
+    }
+    double ns = (double)(check_ns() - t0) / steps;
+    CHECK_EQ(steps, (uint32_t)reps * (SPR / 2));
+    printf("stepper: %.1f ns/paso en stepper_motion_next, rampa de %u pasos\n", ns, m.nramp);
+}
+
+int main(void)
+{
+    test_ramp();
+    test_shortest_path();
+    test_deadband();
+    test_reversal();
+    test_overshoot();
+    bench();
+    return check_done("stepper");
+}
@@ -0,0 +1,70 @@
+// Compilación de partituras (common/tone_seq.h, parte portable) con la
+// escala y la canción de practica_final_1.c
+#include "check.h"
+
+#include "tone_seq.h"
+
+static const tone_note_t notas[] = {
+    {"DO", 261}, {"RE", 294}, {"MI", 329}, {"FA", 349},
+    {"SOL", 392}, {"LA", 440}, {"SI", 493}, {"DO5", 523},
+};
+#define NUM_NOTAS   (sizeof(notas) / sizeof(notas[0]))
+
+static const tone_score_note_t partitura[] = {
+    {"DO", 400}, {"DO", 400}, {"SOL", 400}, {"SOL", 400},
+    {"LA", 400}, {"LA", 400}, {"SOL", 800},
+    {"FA", 400}, {"FA", 400}, {"MI", 400}, {"MI", 400},
+    {"RE", 400}, {"MI", 400}, {"DO", 800},
+};
+#define LONG_PARTITURA  (sizeof(partitura) / sizeof(partitura[0]))
+
+static void test_song(void)
+{
+    static const uint16_t freq[LONG_PARTITURA] = {
+        261, 261, 392, 392, 440, 440, 392, 349, 349, 329, 329, 294, 329, 261,
+    };
+    tone_step_t pasos[LONG_PARTITURA];
+    int bad = 0;
+
+    CHECK_EQ(tone_compile(notas, NUM_NOTAS, partitura, LONG_PARTITURA, 50, pasos), LONG_PARTITURA);
+    for (size_t i = 0; i < LONG_PARTITURA; i++) {
+        if (pasos[i].freq_hz != freq[i] || pasos[i].dur_ms != partitura[i].dur_ms || pasos[i].gap_ms != 50) bad++;
+    }
+    CHECK_EQ(bad, 0);
+    // 12 negras, 2 blancas y una pausa de 50 ms tras cada nota
+    CHECK_EQ(tone_length_ms(pasos, LONG_PARTITURA), 12 * 400 + 2 * 800 + LONG_PARTITURA * 50);
+}
+
+// Silencios (name NULL) y notas que no están en la escala
+static void test_rest_and_unknown(void)
+{
+    const tone_score_note_t con_silencio[] = { {"SI", 200}, {NULL, 300}, {"DO5", 100} };
+    tone_step_t out[3];
+
+    CHECK_EQ(tone_compile(notas, NUM_NOTAS, con_silencio, 3, 0, out), 3);
+    CHECK_EQ(out[0].freq_hz, 493);
+    CHECK_EQ(out[1].freq_hz, 0);
+    CHECK_EQ(out[1].dur_ms, 300);
+    CHECK_EQ(out[2].freq_hz, 523);
+    CHECK_EQ(tone_length_ms(out, 3), 600);
+
+    // La primera desconocida se indica como -(índice + 1): ni DO# ni "do"
+    const tone_score_note_t mala[] = { {"DO", 100}, {"RE", 100}, {"DO#", 100}, {"do", 100} };
+    CHECK_EQ(tone_compile(notas, NUM_NOTAS, mala, 4, 50, out), -3);
+    const tone_score_note_t primera[] = { {"do", 100} };
+    CHECK_EQ(tone_compile(notas, NUM_NOTAS, primera, 1, 50, out), -1);
+
+    // Prefijo de otra nota: "DO" no debe casar con "DO5" ni al revés
+    const tone_note_t solo_do5[] = { {"DO5", 523} };
+    CHECK_EQ(tone_compile(solo_do5, 1, partitura, 1, 0, out), -1);
+
+    CHECK_EQ(tone_compile(notas, NUM_NOTAS, partitura, 0, 50, out), 0);
+    CHECK_EQ(tone_length_ms(out, 0), 0);
+}
+
+int main(void)
+{
+    test_song();
+    test_rest_and_unknown();
+    return check_done("tone_seq");
+}
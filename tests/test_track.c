@@ -0,0 +1,204 @@
+// Recorrido comprimido (common/track.h): ida y vuelta sin pérdidas, banda
+// muerta y banco de compresión/tiempo por punto sobre los registros NMEA de
+// tests/data, troceados en segmentos como hace publisher_task
+#include "check.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "nmea.h"
+#include "track.h"
+
+#define SEG_MAX_MS  60000           // TRACK_SEG_MAX_MS de p4_mqtt_gps.c
+#define MAX_POINTS  8192
+#define RAD_PER_E7  (3.14159265358979 / 1.8e9)
+
+typedef struct {
+    track_point_t pt[MAX_POINTS];
+    int n;
+} points_t;
+
+// Fixes válidos (RMC) del registro
+static int load_track(const char *name, points_t *out)
+{
+    size_t len;
+    uint8_t *log = check_load(name, &len);
+    if (log == NULL) return -1;
+
+    nmea_parser_t p;
+    nmea_msg_t m;
+    nmea_init(&p);
+    out->n = 0;
+    for (size_t i = 0; i < len && out->n < MAX_POINTS; i++) {
+        if (nmea_feed(&p, log[i], &m) && m.type == NMEA_RMC && m.rmc.valid) {
+            out->pt[out->n++] = (track_point_t){ m.rmc.time_ms, m.rmc.lat_e7, m.rmc.lon_e7 };
+        }
+    }
+    free(log);
+    return out->n;
+}
+
+typedef struct {
+    uint32_t segments, points, kept, bytes;
+    int bad;                        // segmentos que no decodifican a lo guardado
+    int far;                        // descartados a más de la banda del anterior guardado
+} stats_t;
+
+// Distancia en metros con cos(lat) en doble precisión, no con la Q15 del
+// segmento (1 cm de margen por la diferencia entre las dos)
+static bool within(const track_point_t *a, const track_point_t *b, uint32_t band_m)
+{
+    double dy = (a->lat_e7 - b->lat_e7) / (double)TRACK_E7_PER_M;
+    double dx = (a->lon_e7 - b->lon_e7) / (double)TRACK_E7_PER_M * cos(b->lat_e7 * RAD_PER_E7);
+    return dx * dx + dy * dy < (band_m + 0.01) * (band_m + 0.01);
+}
+
+// Cierra el segmento, lo decodifica y lo compara con los puntos guardados
+static void close_seg(track_seg_t *t, const track_point_t *kept, int nkept, stats_t *st)
+{
+    static track_point_t dec[TRACK_SEG_MAX_BYTES];
+    if (t->npoints == 0) return;
+    uint16_t len = track_close(t);
+    int n = track_decode(t->data, len, dec, TRACK_SEG_MAX_BYTES);
+    if (n != nkept || memcmp(dec, kept, (size_t)n * sizeof(*dec)) != 0) st->bad++;
+    st->segments++;
+    st->kept += t->npoints;
+    st->bytes += len;
+    track_reset(t);
+}
+
+static stats_t encode(const points_t *in, uint32_t deadband_m)
+{
+    static track_seg_t t;
+    static track_point_t kept[TRACK_SEG_MAX_BYTES];
+    stats_t st = {0};
+    int nkept = 0;
+
+    track_init(&t, deadband_m);
+    for (int i = 0; i < in->n; i++) {
+        const track_point_t *p = &in->pt[i];
+        if (t.npoints > 0 && (p->time_ms < t.t0 || p->time_ms - t.t0 >= SEG_MAX_MS)) {
+            close_seg(&t, kept, nkept, &st);
+            nkept = 0;
+        }
+        uint16_t before = t.npoints;
+        if (!track_add(&t, p->time_ms, p->lat_e7, p->lon_e7)) {
+            close_seg(&t, kept, nkept, &st);
+            nkept = 0;
+            before = 0;
+            track_add(&t, p->time_ms, p->lat_e7, p->lon_e7);
+        }
+        if (t.npoints != before) kept[nkept++] = *p;
+        else if (!within(p, &kept[nkept - 1], deadband_m)) st.far++;
+        st.points++;
+    }
+    close_seg(&t, kept, nkept, &st);
+    return st;
+}
+
+static void test_format(void)
+{
+    track_seg_t t;
+    track_point_t d[4];
+    uint8_t v[10];
+
+    // Varint/zigzag en los extremos
+    static const int64_t vals[] = { 0, -1, 1, 63, -64, 64, INT32_MAX, INT32_MIN, (int64_t)UINT32_MAX };
+    for (size_t i = 0; i < sizeof(vals) / sizeof(vals[0]); i++) {
+        uint16_t n = track_put_varint(v, track_zigzag(vals[i])), pos = 0;
+        uint64_t r;
+        CHECK(track_get_varint(v, n, &pos, &r));
+        CHECK_EQ(pos, n);
+        CHECK_EQ(track_unzigzag(r), vals[i]);
+        CHECK(n <= 5);
+    }
+    CHECK_EQ(track_put_varint(v, track_zigzag(-64)), 1);
+    CHECK_EQ(track_put_varint(v, track_zigzag(64)), 2);
+
+    // Cabecera y un paso de 100 ms, +1 m al norte
+    track_init(&t, 0);
+    CHECK(track_add(&t, 36000000, 404523000, -37266000));
+    CHECK(track_add(&t, 36000100, 404523090, -37266000));
+    uint16_t len = track_close(&t);
+    CHECK_EQ(len, TRACK_HDR_LEN + 2 + 2 + 1);     // zigzag: 200, 180 y 0
+    CHECK_EQ(t.data[0], TRACK_VERSION);
+    CHECK_EQ(t.data[1] | (t.data[2] << 8), 2);
+    CHECK_EQ(track_decode(t.data, len, d, 4), 2);
+    CHECK_EQ(d[1].time_ms, 36000100);
+    CHECK_EQ(d[1].lat_e7, 404523090);
+    CHECK_EQ(d[1].lon_e7, -37266000);
+
+    // Segmento truncado o de otra versión
+    CHECK_EQ(track_decode(t.data, len - 1, d, 4), -1);
+    t.data[0] = TRACK_VERSION + 1;
+    CHECK_EQ(track_decode(t.data, len, d, 4), -1);
+
+    // Banda muerta de 3 m: 2 m no se guarda, 4 m sí
+    track_init(&t, 3);
+    track_add(&t, 0, 0, 0);
+    track_add(&t, 100, 2 * TRACK_E7_PER_M, 0);
+    CHECK_EQ(t.npoints, 1);
+    CHECK_EQ(t.skipped, 1);
+    track_add(&t, 200, 4 * TRACK_E7_PER_M, 0);
+    CHECK_EQ(t.npoints, 2);
+
+    // A 60° N un grado de longitud mide la mitad: 2 m al este son 360e-7
+    // grados y no se guardan; 4 m (720e-7) sí
+    CHECK(abs((int)track_cos_q15(600000000) - 16384) <= 1);
+    CHECK_EQ(track_cos_q15(0), 32768);
+    CHECK_EQ(track_cos_q15(-900000000), 0);
+    track_init(&t, 3);
+    track_add(&t, 0, 600000000, 100000000);
+    track_add(&t, 100, 600000000, 100000000 + 2 * 2 * TRACK_E7_PER_M);
+    CHECK_EQ(t.npoints, 1);
+    track_add(&t, 200, 600000000, 100000000 + 4 * 2 * TRACK_E7_PER_M);
+    CHECK_EQ(t.npoints, 2);
+    // Tras track_reset la escala se toma del primer punto del nuevo segmento
+    track_reset(&t);
+    track_add(&t, 300, 0, 0);
+    track_add(&t, 400, 0, 2 * 2 * TRACK_E7_PER_M);
+    CHECK_EQ(t.npoints, 2);
+
+    // Lleno: track_add pide cerrar sin escribir nada
+    track_init(&t, 0);
+    int added = 0;
+    while (track_add(&t, (uint32_t)added * 1000, added * 1000000, -added * 1000000)) added++;
+    CHECK(t.len <= TRACK_SEG_MAX_BYTES);
+    CHECK_EQ(t.npoints, added);
+    CHECK_EQ(track_decode(t.data, track_close(&t), d, 0), added);
+}
+
+static void bench(const char *name, int expect)
+{
+    static points_t in;
+    int n = load_track(name, &in);
+    CHECK_EQ(n, expect);
+    if (n <= 0) return;
+
+    for (uint32_t band = 0; band <= 3; band += 3) {
+        stats_t st = encode(&in, band);
+        CHECK_EQ(st.points, (uint32_t)n);
+        CHECK_EQ(st.bad, 0);
+        CHECK_EQ(st.far, 0);
+        CHECK(band > 0 || st.kept == (uint32_t)n);
+
+        const int reps = 200;
+        uint64_t t0 = check_ns();
+        for (int r = 0; r < reps; r++) check_sink += encode(&in, band).bytes;
+        uint64_t ns = check_ns() - t0;
+
+        // El banco incluye la verificación por decodificación de cada segmento
+        printf("track %-22s banda %u m: %u/%u puntos en %u segmentos, %u bytes (%.2f B/punto), "
+               "%.1fx frente a 12 B/punto, %.0f ns/punto\n",
+               name, band, st.kept, st.points, st.segments, st.bytes, (double)st.bytes / st.kept,
+               12.0 * st.points / st.bytes, (double)ns / ((double)n * reps));
+    }
+}
+
+int main(void)
+{
+    test_format();
+    bench("neo7_paseo_10hz.nmea", 600);
+    bench("neo7_coche_1hz.nmea", 600);
+    return check_done("track");
+}
@@ -0,0 +1,271 @@
+// Pruebas del protocolo UBX (common/ubx.h): checksum Fletcher-8, resincronización,
+// NAV-PVT y rendimiento sobre un flujo de NAV-PVT a 10 Hz generado aquí
+#include "check.h"
+
+#include <string.h>
+
+#include "ubx.h"
+
+// Fletcher-8 de referencia (RFC 1145, módulo 256) sobre class..payload
+static void fletcher_ref(const uint8_t *b, size_t n, uint8_t *a, uint8_t *c)
+{
+    unsigned sa = 0, sb = 0;
+    for (size_t i = 0; i < n; i++) {
+        sa = (sa + b[i]) % 256;
+        sb = (sb + sa) % 256;
+    }
+    *a = (uint8_t)sa;
+    *c = (uint8_t)sb;
+}
+
+static void put32(uint8_t *b, uint32_t v)
+{
+    b[0] = (uint8_t)v; b[1] = (uint8_t)(v >> 8); b[2] = (uint8_t)(v >> 16); b[3] = (uint8_t)(v >> 24);
+}
+
+// NAV-PVT con los campos que decodifica ubx_decode_nav_pvt
+static size_t nav_pvt(uint8_t *out, uint32_t itow, int32_t lat, int32_t lon, int32_t gspeed, int32_t head)
+{
+    uint8_t pl[UBX_NAV_PVT_LEN] = {0};
+    put32(&pl[0], itow);
+    pl[4] = 0xEA; pl[5] = 0x07;                 // 2026
+    pl[6] = 10; pl[7] = 17; pl[8] = 9; pl[9] = 59; pl[10] = 58;
+    pl[11] = 0x07;
+    pl[20] = 3;
+    pl[21] = 0x01;
+    pl[23] = 9;
+    put32(&pl[24], (uint32_t)lon);
+    put32(&pl[28], (uint32_t)lat);
+    put32(&pl[36], (uint32_t)-12345);           // hMSL bajo el nivel del mar
+    put32(&pl[40], 2500);
+    put32(&pl[60], (uint32_t)gspeed);
+    put32(&pl[64], (uint32_t)head);
+    pl[76] = 0x9A; pl[77] = 0x01;               // pDOP 4.10
+    return ubx_build(out, UBX_CLASS_NAV, UBX_NAV_PVT, pl, sizeof(pl));
+}
+
+static int feed(ubx_parser_t *p, const uint8_t *b, size_t n)
+{
+    int k = 0;
+    for (size_t i = 0; i < n; i++) k += ubx_feed(p, b[i]);
+    return k;
+}
+
+static void test_checksum(void)
+{
+    uint8_t f[UBX_MAX_PAYLOAD + 8];
+
+    // Tramas de configuración conocidas (documentación de u-blox)
+    static const uint8_t rate10[] = { 0xB5, 0x62, 0x06, 0x08, 0x06, 0x00, 0x64, 0x00, 0x01, 0x00, 0x01, 0x00,
+                                      0x7A, 0x12 };
+    static const uint8_t msg_pvt[] = { 0xB5, 0x62, 0x06, 0x01, 0x03, 0x00, 0x01, 0x07, 0x01, 0x13, 0x51 };
+    CHECK_EQ(ubx_cfg_rate(f, 100), sizeof(rate10));
+    CHECK(memcmp(f, rate10, sizeof(rate10)) == 0);
+    CHECK_EQ(ubx_cfg_msg(f, UBX_CLASS_NAV, UBX_NAV_PVT, 1), sizeof(msg_pvt));
+    CHECK(memcmp(f, msg_pvt, sizeof(msg_pvt)) == 0);
+
+    // Contra la referencia con payloads pseudoaleatorios de todas las longitudes
+    uint8_t pl[UBX_MAX_PAYLOAD];
+    uint32_t seed = 7;
+    for (uint16_t len = 0; len <= UBX_MAX_PAYLOAD; len++) {
+        for (uint16_t i = 0; i < len; i++) {
+            seed = seed * 1664525u + 1013904223u;
+            pl[i] = (uint8_t)(seed >> 24);
+        }
+        size_t n = ubx_build(f, (uint8_t)len, (uint8_t)(len * 3), pl, len);
+        uint8_t a, c;
+        fletcher_ref(&f[2], n - 4, &a, &c);
+        CHECK_EQ(f[n - 2], a);
+        CHECK_EQ(f[n - 1], c);
+
+        ubx_parser_t p;
+        ubx_init(&p);
+        CHECK_EQ(feed(&p, f, n), 1);
+        CHECK_EQ(p.len, len);
+        CHECK(len == 0 || memcmp(p.payload, pl, len) == 0);
+    }
+
+    // Cualquier bit cambiado tras la sincronía invalida la trama
+    size_t n = nav_pvt(f, 1000, 404523000, -37266000, 1400, 3500000);
+    int missed = 0;
+    for (size_t i = 2; i < n; i++) {
+        for (int bit = 0; bit < 8; bit++) {
+            ubx_parser_t p;
+            ubx_init(&p);
+            f[i] ^= (uint8_t)(1u << bit);
+            if (feed(&p, f, n) != 0) missed++;
+            f[i] ^= (uint8_t)(1u << bit);
+        }
+    }
+    CHECK_EQ(missed, 0);
+}
+
+static void test_nav_pvt(void)
+{
+    uint8_t f[128];
+    ubx_parser_t p;
+    ubx_nav_pvt_t m;
+
+    ubx_init(&p);
+    size_t n = nav_pvt(f, 345678900, -334567891, -1801234567, 27777, 35999999);
+    CHECK_EQ(feed(&p, f, n), 1);
+    CHECK(ubx_is(&p, UBX_CLASS_NAV, UBX_NAV_PVT));
+    CHECK(ubx_decode_nav_pvt(&p, &m));
+    CHECK_EQ(m.itow_ms, 345678900);
+    CHECK_EQ(m.year, 2026);
+    CHECK_EQ(m.month, 10);
+    CHECK_EQ(m.day, 17);
+    CHECK_EQ(m.hour, 9);
+    CHECK_EQ(m.min, 59);
+    CHECK_EQ(m.sec, 58);
+    CHECK_EQ(m.valid, 0x07);
+    CHECK_EQ(m.fix_type, 3);
+    CHECK(m.fix_ok);
+    CHECK_EQ(m.num_sv, 9);
+    CHECK_EQ(m.lat_e7, -334567891);
+    CHECK_EQ(m.lon_e7, -1801234567);
+    CHECK_EQ(m.hmsl_mm, -12345);
+    CHECK_EQ(m.hacc_mm, 2500);
+    CHECK_EQ(m.gspeed_mms, 27777);
+    CHECK_EQ(m.head_e5, 35999999);
+    CHECK_EQ(m.pdop_e2, 410);
+
+    // Otra clase o un NAV-PVT corto no se decodifican
+    uint8_t pl[UBX_NAV_PVT_LEN] = {0};
+    n = ubx_build(f, UBX_CLASS_NAV, UBX_NAV_PVT, pl, UBX_NAV_PVT_LEN - 1);
+    CHECK_EQ(feed(&p, f, n), 1);
+    CHECK(!ubx_decode_nav_pvt(&p, &m));
+    n = ubx_build(f, UBX_CLASS_ACK, UBX_ACK_ACK, pl, 2);
+    CHECK_EQ(feed(&p, f, n), 1);
+    CHECK(!ubx_decode_nav_pvt(&p, &m));
+}
+
+static void test_resync(void)
+{
+    uint8_t a[128], b[128], s[1024];
+    ubx_parser_t p;
+    ubx_nav_pvt_t m;
+    size_t na = nav_pvt(a, 1000, 1, 2, 3, 4);
+    size_t nb = nav_pvt(b, 1100, 5, 6, 7, 8);
+    size_t n;
+
+    // Basura (con falsas sincronías y NMEA) antes y entre tramas
+    static const uint8_t junk[] = { 0x00, 0xB5, 0x00, 0x62, 0xB5, 0xB5, 0xB5, '$', 'G', 'P', 0x62, 0xFF };
+    ubx_init(&p);
+    n = 0;
+    memcpy(&s[n], junk, sizeof(junk)); n += sizeof(junk);
+    memcpy(&s[n], a, na); n += na;
+    memcpy(&s[n], junk, sizeof(junk)); n += sizeof(junk);
+    memcpy(&s[n], b, nb); n += nb;
+    CHECK_EQ(feed(&p, s, n), 2);
+    CHECK(ubx_decode_nav_pvt(&p, &m) && m.itow_ms == 1100);
+    CHECK_EQ(p.cks_errors, 0);
+
+    // "B5 B5 62": la segunda B5 es la buena
+    ubx_init(&p);
+    s[0] = UBX_SYNC1;
+    memcpy(&s[1], a, na);
+    CHECK_EQ(feed(&p, s, na + 1), 1);
+
+    // Longitud imposible (> UBX_MAX_PAYLOAD): se descarta sin leer payload
+    ubx_init(&p);
+    memcpy(s, a, na);
+    s[5] = 0x40;
+    memcpy(&s[na], b, nb);
+    CHECK_EQ(feed(&p, s, na + nb), 1);
+    CHECK_EQ(p.overflows, 1);
+    CHECK(ubx_decode_nav_pvt(&p, &m) && m.itow_ms == 1100);
+
+    // Longitud corrompida a menos: falla el checksum y se recupera en la siguiente
+    ubx_init(&p);
+    memcpy(s, a, na);
+    s[4] = 20;
+    memcpy(&s[na], b, nb);
+    CHECK_EQ(feed(&p, s, na + nb), 1);
+    CHECK_EQ(p.cks_errors, 1);
+    CHECK(ubx_decode_nav_pvt(&p, &m) && m.itow_ms == 1100);
+
+    // Longitud corrompida a más: el payload falso se traga el principio de la
+    // siguiente trama, que se pierde; la de después se recupera
+    ubx_init(&p);
+    n = 0;
+    memcpy(&s[n], a, na); s[4] = UBX_MAX_PAYLOAD; n += na;
+    memcpy(&s[n], b, nb); n += nb;
+    memcpy(&s[n], a, na); n += na;
+    CHECK_EQ(feed(&p, s, n), 1);
+    CHECK_EQ(p.cks_errors, 1);
+    CHECK(ubx_decode_nav_pvt(&p, &m) && m.itow_ms == 1000);
+
+    // Trama cortada a mitad: la siguiente entra como payload, falla el
+    // checksum y se recupera en la tercera
+    ubx_init(&p);
+    n = 0;
+    memcpy(&s[n], a, 40); n += 40;
+    memcpy(&s[n], b, nb); n += nb;
+    memcpy(&s[n], b, nb); n += nb;
+    CHECK_EQ(feed(&p, s, n), 1);
+    CHECK_EQ(p.frames, 1);
+
+    // Trama sin payload (sondeo/ACK vacío)
+    ubx_init(&p);
+    n = ubx_build(s, UBX_CLASS_CFG, UBX_CFG_RATE, NULL, 0);
+    CHECK_EQ(feed(&p, s, n), 1);
+    CHECK_EQ(p.len, 0);
+}
+
+// Flujo NAV-PVT de 10 minutos a 10 Hz con ruido de línea cada ~100 tramas
+static void test_bench(void)
+{
+    enum { FRAMES = 6000 };
+    size_t cap = FRAMES * (UBX_NAV_PVT_LEN + 8 + 4);
+    uint8_t *s = malloc(cap);
+    size_t n = 0;
+    uint32_t seed = 3, noise = 0;
+
+    for (uint32_t i = 0; i < FRAMES; i++) {
+        n += nav_pvt(&s[n], 36000000 + i * 100, 404523000 + (int32_t)i * 12, -37266000 + (int32_t)i * 9,
+                     1400, 3500000);
+        seed = seed * 1664525u + 1013904223u;
+        if ((seed >> 24) < 3) {
+            s[n++] = 0xB5;
+            s[n++] = (uint8_t)(seed >> 8);
+            noise++;
+        }
+    }
+
+    ubx_parser_t p;
+    ubx_nav_pvt_t m;
+    uint32_t good = 0, step = 0, last = 0;
+    ubx_init(&p);
+    for (size_t i = 0; i < n; i++) {
+        if (!ubx_feed(&p, s[i]) || !ubx_decode_nav_pvt(&p, &m)) continue;
+        if (good > 0 && m.itow_ms - last != 100) step++;
+        last = m.itow_ms;
+        good++;
+    }
+    // Una falsa sincronía sólo puede costar la trama que sigue
+    CHECK(good >= FRAMES - noise);
+    CHECK_EQ(good + step, FRAMES);
+
+    const int reps = 20;
+    uint64_t t0 = check_ns();
+    for (int r = 0; r < reps; r++) {
+        ubx_init(&p);
+        for (size_t i = 0; i < n; i++) {
+            if (ubx_feed(&p, s[i]) && ubx_decode_nav_pvt(&p, &m)) check_sink += (uint32_t)m.lat_e7;
+        }
+    }
+    uint64_t ns = check_ns() - t0;
+    printf("ubx: %.1f MB/s, %.0f ns/NAV-PVT, %u/%u tramas con %u ráfagas de ruido\n",
+           (double)n * reps / ((double)ns / 1e9) / 1e6, (double)ns / ((double)FRAMES * reps), good, FRAMES, noise);
+    free(s);
+}
+
+int main(void)
+{
+    test_checksum();
+    test_nav_pvt();
+    test_resync();
+    test_bench();
+    return check_done("ubx");
+}
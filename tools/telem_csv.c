@@ -0,0 +1,163 @@
+// Decodificador de la telemetría binaria (common/telemetry.h) para el host
+//
+// Lee el flujo del USB-Serial-JTAG (fichero capturado o la entrada estándar),
+// separa las tramas por 0x00, valida COBS y CRC y escribe un CSV por tipo de
+// registro: <prefijo>_imu.csv, _att.csv, _adc.csv, _ppg.csv y _gps.csv. Los tiempos de
+// 32 bits se desenrollan a 64 bits. Al final resume tramas válidas, errores
+// de CRC y huecos de secuencia por stderr.
+//
+// Compilación y uso:
+//     gcc -O2 -I common -o telem_csv tools/telem_csv.c
+//     stty -F /dev/ttyACM0 raw && ./telem_csv /dev/ttyACM0 captura
+//     ./telem_csv volcado.bin captura
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "telemetry.h"
+
+typedef struct {
+    FILE    *imu, *att, *adc, *ppg, *gps;
+    int64_t  t_last;
+    bool     t_init;
+    int      seq_prev;
+    uint64_t frames, bad, gaps, unknown;
+} decoder_t;
+
+static int64_t unwrap_us(decoder_t *d, uint32_t t)
+{
+    // Diferencia con signo respecto al último tiempo: admite que los
+    // productores no lleguen en orden estricto y los desbordes de 32 bits
+    if (!d->t_init) {
+        d->t_last = t;
+        d->t_init = true;
+    } else {
+        d->t_last += (int64_t)(int32_t)(t - (uint32_t)d->t_last);
+    }
+    return d->t_last;
+}
+
+static FILE *open_csv(const char *prefix, const char *suffix, const char *header)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s_%s.csv", prefix, suffix);
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        perror(path);
+        exit(1);
+    }
+    fprintf(f, "%s\n", header);
+    return f;
+}
+
+static void handle_record(decoder_t *d, const uint8_t *raw, int len)
+{
+    uint8_t type = raw[0];
+    uint8_t seq = raw[1];
+    const uint8_t *p = raw + 2;
+
+    if (d->seq_prev >= 0 && seq != (uint8_t)(d->seq_prev + 1)) d->gaps++;
+    d->seq_prev = seq;
+    d->frames++;
+
+    switch (type) {
+    case TELEM_IMU_RAW: {
+        if (len < 7) break;
+        int64_t t_last = unwrap_us(d, telem_get_u32(p));
+        uint16_t period = telem_get_u16(p + 4);
+        int n = p[6];
+        if (len < 7 + n * 12) break;
+        for (int i = 0; i < n; i++) {
+            const uint8_t *s = p + 7 + i * 12;
+            fprintf(d->imu, "%lld,%d,%d,%d,%d,%d,%d\n",
+                    (long long)(t_last - (int64_t)(n - 1 - i) * period),
+                    (int16_t)telem_get_u16(s), (int16_t)telem_get_u16(s + 2), (int16_t)telem_get_u16(s + 4),
+                    (int16_t)telem_get_u16(s + 6), (int16_t)telem_get_u16(s + 8), (int16_t)telem_get_u16(s + 10));
+        }
+        break;
+    }
+    case TELEM_ATTITUDE:
+        if (len < 13) break;
+        fprintf(d->att, "%lld,%.2f,%.2f,%.2f,%.2f,%u\n", (long long)unwrap_us(d, telem_get_u32(p)),
+                (int16_t)telem_get_u16(p + 4) / 100.0, (int16_t)telem_get_u16(p + 6) / 100.0,
+                (int16_t)telem_get_u16(p + 8) / 100.0, (int16_t)telem_get_u16(p + 10) / 100.0, p[12]);
+        break;
+    case TELEM_ADC:
+        if (len < 9) break;
+        fprintf(d->adc, "%lld,%u,%.3f,%u\n", (long long)unwrap_us(d, telem_get_u32(p)), p[4],
+                telem_get_u16(p + 5) / 1000.0, telem_get_u16(p + 7));
+        break;
+    case TELEM_ADC_BLOCK: {
+        if (len < 10) break;
+        int64_t t_last = unwrap_us(d, telem_get_u32(p));
+        uint16_t period = telem_get_u16(p + 4);
+        int n = p[9];
+        if (len < 10 + n * 2) break;
+        for (int i = 0; i < n; i++) {
+            fprintf(d->ppg, "%lld,%u,%.3f,%u\n", (long long)(t_last - (int64_t)(n - 1 - i) * period), p[6],
+                    telem_get_u16(p + 7) / 1000.0, telem_get_u16(p + 10 + i * 2));
+        }
+        break;
+    }
+    case TELEM_GPS:
+        if (len < 19) break;
+        fprintf(d->gps, "%lld,%.7f,%.7f,%.3f,%.2f,%u\n", (long long)unwrap_us(d, telem_get_u32(p)),
+                (int32_t)telem_get_u32(p + 4) / 1e7, (int32_t)telem_get_u32(p + 8) / 1e7,
+                telem_get_u32(p + 12) / 1000.0, telem_get_u16(p + 16) / 100.0, p[18]);
+        break;
+    default:
+        d->unknown++;
+        break;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 3) {
+        fprintf(stderr, "uso: %s <entrada|-> <prefijo_csv>\n", argv[0]);
+        return 1;
+    }
+    FILE *in = strcmp(argv[1], "-") == 0 ? stdin : fopen(argv[1], "rb");
+    if (in == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    decoder_t d = { .seq_prev = -1 };
+    d.imu = open_csv(argv[2], "imu", "t_us,gx,gy,gz,ax,ay,az");
+    d.att = open_csv(argv[2], "att", "t_us,roll_deg,pitch_deg,yaw_deg,temp_c,servo");
+    d.adc = open_csv(argv[2], "adc", "t_us,canal,duty,raw");
+    d.ppg = open_csv(argv[2], "ppg", "t_us,canal,duty,mv");
+    d.gps = open_csv(argv[2], "gps", "t_us,lat,lon,speed_ms,course_deg,fix");
+
+    static uint8_t enc[TELEM_MAX_FRAME * 4];
+    uint8_t raw[TELEM_MAX_RAW];
+    size_t len = 0;
+    int c;
+
+    while ((c = fgetc(in)) != EOF) {
+        if (c != 0) {
+            if (len < sizeof(enc)) enc[len] = (uint8_t)c;
+            len++;
+            continue;
+        }
+        if (len == 0) continue;
+        int n = len <= sizeof(enc) ? telem_frame_decode(enc, len, raw, sizeof(raw)) : -1;
+        if (n < 0) d.bad++;
+        else handle_record(&d, raw, n);
+        len = 0;
+    }
+
+    fprintf(stderr, "%llu tramas, %llu invalidas, %llu huecos de secuencia, %llu tipos desconocidos\n",
+            (unsigned long long)d.frames, (unsigned long long)d.bad, (unsigned long long)d.gaps,
+            (unsigned long long)d.unknown);
+    fclose(d.imu);
+    fclose(d.att);
+    fclose(d.adc);
+    fclose(d.ppg);
+    fclose(d.gps);
+    if (in != stdin) fclose(in);
+    return 0;
+}